@@ -9,6 +9,7 @@
 #include <wlr/backend/interface.h>
 #include <wlr/backend/libinput.h>
 #include <wlr/backend/multi.h>
+#include <wlr/backend/replay.h>
 #include <wlr/backend/session.h>
 #include <wlr/backend/wayland.h>
 #include <wlr/backend/x11.h>
@@ -56,22 +57,29 @@ struct wlr_renderer *wlr_backend_get_renderer(struct wlr_backend *backend) {
 	return NULL;
 }
 
+static int get_env_outputs(const char *name) {
+	int outputs = 1;
+	const char *_outputs = getenv(name);
+	if (_outputs) {
+		char *end;
+		outputs = (int)strtol(_outputs, &end, 10);
+		if (*end) {
+			wlr_log(L_ERROR, "%s specified with invalid integer, ignoring",
+				name);
+			outputs = 1;
+		} else if (outputs < 0) {
+			wlr_log(L_ERROR, "%s specified with negative outputs, ignoring",
+				name);
+			outputs = 1;
+		}
+	}
+	return outputs;
+}
+
 static struct wlr_backend *attempt_wl_backend(struct wl_display *display) {
 	struct wlr_backend *backend = wlr_wl_backend_create(display, NULL);
 	if (backend) {
-		int outputs = 1;
-		const char *_outputs = getenv("WLR_WL_OUTPUTS");
-		if (_outputs) {
-			char *end;
-			outputs = (int)strtol(_outputs, &end, 10);
-			if (*end) {
-				wlr_log(L_ERROR, "WLR_WL_OUTPUTS specified with invalid integer, ignoring");
-				outputs = 1;
-			} else if (outputs < 0) {
-				wlr_log(L_ERROR, "WLR_WL_OUTPUTS specified with negative outputs, ignoring");
-				outputs = 1;
-			}
-		}
+		int outputs = get_env_outputs("WLR_WL_OUTPUTS");
 		while (outputs--) {
 			wlr_wl_output_create(backend);
 		}
@@ -79,6 +87,35 @@ static struct wlr_backend *attempt_wl_backend(struct wl_display *display) {
 	return backend;
 }
 
+static struct wlr_backend *attempt_x11_backend(struct wl_display *display,
+		const char *x11_display) {
+	struct wlr_backend *backend = wlr_x11_backend_create(display, x11_display);
+	if (backend) {
+		int outputs = get_env_outputs("WLR_X11_OUTPUTS");
+		while (outputs--) {
+			wlr_x11_output_create(backend);
+		}
+	}
+	return backend;
+}
+
+static struct wlr_backend *attempt_replay_backend(struct wl_display *display,
+		const char *path) {
+	struct wlr_backend *backend = wlr_replay_backend_create(display, path);
+	const char *speed = getenv("WLR_REPLAY_SPEED");
+	if (backend && speed) {
+		char *end;
+		double s = strtod(speed, &end);
+		if (*end || s <= 0) {
+			wlr_log(L_ERROR, "WLR_REPLAY_SPEED specified with invalid speed, "
+				"ignoring");
+		} else {
+			wlr_replay_backend_set_speed(backend, s);
+		}
+	}
+	return backend;
+}
+
 struct wlr_backend *wlr_backend_autocreate(struct wl_display *display) {
 	struct wlr_backend *backend = wlr_multi_backend_create(display);
 	if (!backend) {
@@ -86,6 +123,16 @@ struct wlr_backend *wlr_backend_autocreate(struct wl_display *display) {
 		return NULL;
 	}
 
+	// Recorded input is played back in addition to the regular backends
+	const char *replay = getenv("WLR_REPLAY");
+	if (replay) {
+		struct wlr_backend *replay_backend =
+			attempt_replay_backend(display, replay);
+		if (replay_backend) {
+			wlr_multi_backend_add(backend, replay_backend);
+		}
+	}
+
 	if (getenv("WAYLAND_DISPLAY") || getenv("_WAYLAND_DISPLAY")) {
 		struct wlr_backend *wl_backend = attempt_wl_backend(display);
 		if (wl_backend) {
@@ -97,7 +144,7 @@ struct wlr_backend *wlr_backend_autocreate(struct wl_display *display) {
 	const char *x11_display = getenv("DISPLAY");
 	if (x11_display) {
 		struct wlr_backend *x11_backend =
-			wlr_x11_backend_create(display, x11_display);
+			attempt_x11_backend(display, x11_display);
 		wlr_multi_backend_add(backend, x11_backend);
 		return backend;
 	}
@@ -1,5 +1,6 @@
 #include <gbm.h>
 #include <stdlib.h>
+#include <string.h>
 #include <wlr/util/log.h>
 #include <xf86drm.h>
 #include <xf86drmMode.h>
@@ -7,65 +8,46 @@
 #include "backend/drm/iface.h"
 #include "backend/drm/util.h"
 
+// Rejected cursor changes are retried this many times before giving up on the
+// cursor plane
+#define CURSOR_MAX_FAILURES 3
+
 struct atomic {
 	drmModeAtomicReq *req;
-	int cursor;
 	bool failed;
 };
 
-static void atomic_begin(struct wlr_drm_crtc *crtc, struct atomic *atom) {
-	if (!crtc->atomic) {
-		crtc->atomic = drmModeAtomicAlloc();
-		if (!crtc->atomic) {
-			wlr_log_errno(L_ERROR, "Allocation failed");
-			atom->failed = true;
-			return;
-		}
-	}
-
-	atom->req = crtc->atomic;
-	atom->cursor = drmModeAtomicGetCursor(atom->req);
+static void atomic_begin(struct atomic *atom) {
 	atom->failed = false;
-}
-
-static bool atomic_end(int drm_fd, struct atomic *atom) {
-	if (atom->failed) {
-		return false;
-	}
-
-	uint32_t flags = DRM_MODE_ATOMIC_TEST_ONLY | DRM_MODE_ATOMIC_NONBLOCK;
-	if (drmModeAtomicCommit(drm_fd, atom->req, flags, NULL)) {
-		wlr_log_errno(L_ERROR, "Atomic test failed");
-		drmModeAtomicSetCursor(atom->req, atom->cursor);
-		return false;
+	atom->req = drmModeAtomicAlloc();
+	if (!atom->req) {
+		wlr_log_errno(L_ERROR, "Allocation failed");
+		atom->failed = true;
 	}
+}
 
-	return true;
+static void atomic_finish(struct atomic *atom) {
+	drmModeAtomicFree(atom->req);
+	atom->req = NULL;
 }
 
 static bool atomic_commit(int drm_fd, struct atomic *atom,
-		struct wlr_drm_connector *conn, uint32_t flags, bool modeset) {
+		uint32_t flags, void *user_data) {
 	if (atom->failed) {
 		return false;
 	}
 
-	int ret = drmModeAtomicCommit(drm_fd, atom->req, flags, conn);
-	if (ret) {
-		wlr_log_errno(L_ERROR, "%s: Atomic commit failed (%s)",
-			conn->output.name, modeset ? "modeset" : "pageflip");
-
-		// Try to commit without new changes
-		drmModeAtomicSetCursor(atom->req, atom->cursor);
-		if (drmModeAtomicCommit(drm_fd, atom->req, flags, conn)) {
-			wlr_log_errno(L_ERROR,
-				"%s: Atomic commit without new changes failed (%s)",
-				conn->output.name, modeset ? "modeset" : "pageflip");
+	if ((flags & DRM_MODE_ATOMIC_ALLOW_MODESET)) {
+		// Don't disturb the outputs if the new configuration can't be applied
+		uint32_t test_flags = DRM_MODE_ATOMIC_TEST_ONLY |
+			DRM_MODE_ATOMIC_ALLOW_MODESET;
+		if (drmModeAtomicCommit(drm_fd, atom->req, test_flags, NULL)) {
+			wlr_log_errno(L_ERROR, "Atomic test failed");
+			return false;
 		}
 	}
 
-	drmModeAtomicSetCursor(atom->req, 0);
-
-	return !ret;
+	return !drmModeAtomicCommit(drm_fd, atom->req, flags, user_data);
 }
 
 static inline void atomic_add(struct atomic *atom, uint32_t id, uint32_t prop, uint64_t val) {
@@ -95,21 +77,215 @@ static void set_plane_props(struct atomic *atom, struct wlr_drm_plane *plane,
 	}
 }
 
+/**
+ * Adds the given fields of the pending state of the CRTC to the request.
+ */
+static void atomic_add_crtc(struct atomic *atom, struct wlr_drm_crtc *crtc,
+		uint32_t fields) {
+	struct wlr_drm_crtc_pending *pending = &crtc->pending;
+
+	if ((fields & WLR_DRM_CRTC_MODE)) {
+		uint32_t mode_id = pending->mode_id ? pending->mode_id : crtc->mode_id;
+		struct wlr_drm_connector *conn = pending->conn;
+		atomic_add(atom, conn->id, conn->props.crtc_id,
+			pending->active ? crtc->id : 0);
+		atomic_add(atom, crtc->id, crtc->props.mode_id,
+			pending->active ? mode_id : 0);
+		atomic_add(atom, crtc->id, crtc->props.active, pending->active);
+	}
+	if ((fields & WLR_DRM_CRTC_PRIMARY)) {
+		set_plane_props(atom, crtc->primary, crtc->id, pending->primary_fb_id,
+			true);
+	}
+	if ((fields & WLR_DRM_CRTC_CURSOR) && crtc->cursor) {
+		struct wlr_drm_plane *plane = crtc->cursor;
+		if (pending->cursor_fb_id) {
+			set_plane_props(atom, plane, crtc->id, pending->cursor_fb_id,
+				false);
+		} else {
+			atomic_add(atom, plane->id, plane->props.fb_id, 0);
+			atomic_add(atom, plane->id, plane->props.crtc_id, 0);
+		}
+	}
+	if ((fields & WLR_DRM_CRTC_CURSOR_POS) && crtc->cursor) {
+		struct wlr_drm_plane *plane = crtc->cursor;
+		atomic_add(atom, plane->id, plane->props.crtc_x, pending->cursor_x);
+		atomic_add(atom, plane->id, plane->props.crtc_y, pending->cursor_y);
+	}
+	if ((fields & WLR_DRM_CRTC_GAMMA)) {
+		atomic_add(atom, crtc->id, crtc->props.gamma_lut, pending->gamma_lut);
+	}
+	if ((fields & WLR_DRM_CRTC_VRR)) {
+		atomic_add(atom, crtc->id, crtc->props.vrr_enabled,
+			pending->vrr_enabled);
+	}
+}
+
+static void replace_blob(int drm_fd, uint32_t *current, uint32_t *pending,
+		bool apply) {
+	if (*pending == 0) {
+		return;
+	}
+	if (apply) {
+		if (*current != 0) {
+			drmModeDestroyPropertyBlob(drm_fd, *current);
+		}
+		*current = *pending;
+	} else {
+		drmModeDestroyPropertyBlob(drm_fd, *pending);
+	}
+	*pending = 0;
+}
+
+static void replace_gamma_lut(struct wlr_drm_backend *drm,
+		struct wlr_drm_crtc *crtc, bool apply) {
+	struct wlr_drm_crtc_pending *pending = &crtc->pending;
+	if (pending->gamma_lut == 0) {
+		return;
+	}
+	if (apply) {
+		free(crtc->gamma_lut_data);
+		crtc->gamma_lut_data = pending->gamma_lut_data;
+		crtc->gamma_lut_len = pending->gamma_lut_len;
+	} else {
+		free(pending->gamma_lut_data);
+	}
+	pending->gamma_lut_data = NULL;
+	replace_blob(drm->fd, &crtc->gamma_lut, &pending->gamma_lut, apply);
+}
+
+/**
+ * Drops gamma ramps which couldn't be committed, and lets the output know
+ * they aren't applied so that setting them again isn't skipped.
+ */
+static void drop_gamma_lut(struct wlr_drm_backend *drm,
+		struct wlr_drm_connector *conn, struct wlr_drm_crtc *crtc) {
+	if (crtc->pending.gamma_lut == 0) {
+		return;
+	}
+	wlr_log(L_ERROR, "%s: Failed to set gamma", conn->output.name);
+	replace_gamma_lut(drm, crtc, false);
+	conn->output.gamma.size = 0;
+}
+
+/**
+ * Clears the pending state of the CRTC once it has been committed, or dropped
+ * if `applied` is false.
+ */
+static void crtc_pending_finish(struct wlr_drm_backend *drm,
+		struct wlr_drm_crtc *crtc, bool applied) {
+	struct wlr_drm_crtc_pending *pending = &crtc->pending;
+	replace_blob(drm->fd, &crtc->mode_id, &pending->mode_id, applied);
+	replace_gamma_lut(drm, crtc, applied);
+	if (applied && (pending->committed & WLR_DRM_CRTC_VRR)) {
+		crtc->vrr_enabled = pending->vrr_enabled;
+	}
+	pending->committed = 0;
+}
+
+static bool atomic_crtc_commit(struct wlr_drm_backend *drm,
+		struct wlr_drm_connector *conn, struct wlr_drm_crtc *crtc,
+		uint32_t flags) {
+	uint32_t fields = crtc->pending.committed;
+	bool modeset = (fields & WLR_DRM_CRTC_MODE);
+
+	struct atomic atom;
+	atomic_begin(&atom);
+	atomic_add_crtc(&atom, crtc, fields);
+	bool ok = atomic_commit(drm->fd, &atom, flags, conn);
+	atomic_finish(&atom);
+
+	uint32_t cursor_fields =
+		fields & (WLR_DRM_CRTC_CURSOR | WLR_DRM_CRTC_CURSOR_POS);
+	if (!ok) {
+		wlr_log_errno(L_ERROR, "%s: Atomic commit failed (%s)",
+			conn->output.name, modeset ? "modeset" : "pageflip");
+	} else if (cursor_fields != 0 &&
+			crtc->cursor_failures < CURSOR_MAX_FAILURES) {
+		crtc->cursor_failures = 0;
+	}
+
+	// Try to commit without the cursor, gamma and VRR changes
+	uint32_t essential = fields & (WLR_DRM_CRTC_MODE | WLR_DRM_CRTC_PRIMARY);
+	uint32_t carried = 0;
+	if (!ok && essential != fields) {
+		atomic_begin(&atom);
+		atomic_add_crtc(&atom, crtc, essential);
+		ok = atomic_commit(drm->fd, &atom, flags, conn);
+		atomic_finish(&atom);
+
+		if (ok) {
+			struct wlr_drm_crtc_pending *pending = &crtc->pending;
+			drop_gamma_lut(drm, conn, crtc);
+			// The cursor changes have already been reported as applied, keep
+			// them for the next commit
+			if (cursor_fields != 0 &&
+					++crtc->cursor_failures < CURSOR_MAX_FAILURES) {
+				wlr_log(L_DEBUG, "%s: Cursor update rejected, retrying with "
+					"the next page-flip", conn->output.name);
+				carried = cursor_fields;
+			} else if (cursor_fields != 0 &&
+					crtc->cursor_failures == CURSOR_MAX_FAILURES) {
+				wlr_log(L_ERROR, "%s: Cursor plane keeps being rejected, "
+					"disabling hardware cursors", conn->output.name);
+				// Hide the last cursor which made it to the screen
+				pending->cursor_fb_id = 0;
+				carried = WLR_DRM_CRTC_CURSOR;
+			}
+			if ((pending->committed & WLR_DRM_CRTC_VRR)) {
+				wlr_log(L_ERROR, "%s: Failed to %s adaptive sync",
+					conn->output.name,
+					pending->vrr_enabled ? "enable" : "disable");
+				pending->committed &= ~WLR_DRM_CRTC_VRR;
+				conn->output.adaptive_sync = crtc->vrr_enabled;
+			}
+		} else {
+			wlr_log_errno(L_ERROR,
+				"%s: Atomic commit without new changes failed (%s)",
+				conn->output.name, modeset ? "modeset" : "pageflip");
+		}
+	}
+
+	if (!ok) {
+		drop_gamma_lut(drm, conn, crtc);
+	}
+	crtc_pending_finish(drm, crtc, ok);
+	crtc->pending.committed |= carried;
+	return ok;
+}
+
+static bool atomic_crtc_set_mode(struct wlr_drm_backend *drm,
+		struct wlr_drm_connector *conn, struct wlr_drm_crtc *crtc,
+		drmModeModeInfo *mode) {
+	struct wlr_drm_crtc_pending *pending = &crtc->pending;
+	if (pending->mode_id != 0) {
+		drmModeDestroyPropertyBlob(drm->fd, pending->mode_id);
+		pending->mode_id = 0;
+	}
+
+	if (drmModeCreatePropertyBlob(drm->fd, mode, sizeof(*mode),
+			&pending->mode_id)) {
+		wlr_log_errno(L_ERROR, "Unable to create property blob");
+		return false;
+	}
+
+	pending->conn = conn;
+	pending->active = true;
+	pending->committed |= WLR_DRM_CRTC_MODE;
+	return true;
+}
+
 static bool atomic_crtc_pageflip(struct wlr_drm_backend *drm,
 		struct wlr_drm_connector *conn,
 		struct wlr_drm_crtc *crtc,
 		uint32_t fb_id, drmModeModeInfo *mode) {
-	if (mode != NULL) {
-		if (crtc->mode_id != 0) {
-			drmModeDestroyPropertyBlob(drm->fd, crtc->mode_id);
-		}
-
-		if (drmModeCreatePropertyBlob(drm->fd, mode, sizeof(*mode), &crtc->mode_id)) {
-			wlr_log_errno(L_ERROR, "Unable to create property blob");
-			return false;
-		}
+	if (mode != NULL && !atomic_crtc_set_mode(drm, conn, crtc, mode)) {
+		return false;
 	}
 
+	crtc->pending.primary_fb_id = fb_id;
+	crtc->pending.committed |= WLR_DRM_CRTC_PRIMARY;
+
 	uint32_t flags = DRM_MODE_PAGE_FLIP_EVENT;
 	if (mode != NULL) {
 		flags |= DRM_MODE_ATOMIC_ALLOW_MODESET;
@@ -117,33 +293,57 @@ static bool atomic_crtc_pageflip(struct wlr_drm_backend *drm,
 		flags |= DRM_MODE_ATOMIC_NONBLOCK;
 	}
 
-	struct atomic atom;
-	atomic_begin(crtc, &atom);
-	atomic_add(&atom, conn->id, conn->props.crtc_id, crtc->id);
-	atomic_add(&atom, crtc->id, crtc->props.mode_id, crtc->mode_id);
-	atomic_add(&atom, crtc->id, crtc->props.active, 1);
-	set_plane_props(&atom, crtc->primary, crtc->id, fb_id, true);
-	return atomic_commit(drm->fd, &atom, conn, flags, mode);
+	return atomic_crtc_commit(drm, conn, crtc, flags);
+}
+
+static bool atomic_conn_modeset(struct wlr_drm_backend *drm,
+		struct wlr_drm_connector **conns, const uint32_t *fb_ids, size_t n) {
+	bool ok = true;
+	for (size_t i = 0; i < n && ok; ++i) {
+		struct wlr_drm_connector *conn = conns[i];
+		struct wlr_drm_mode *mode =
+			(struct wlr_drm_mode *)conn->output.current_mode;
+		ok = atomic_crtc_set_mode(drm, conn, conn->crtc, &mode->drm_mode);
+		conn->crtc->pending.primary_fb_id = fb_ids[i];
+		conn->crtc->pending.committed |= WLR_DRM_CRTC_PRIMARY;
+	}
+
+	if (ok) {
+		struct atomic atom;
+		atomic_begin(&atom);
+		for (size_t i = 0; i < n; ++i) {
+			struct wlr_drm_crtc *crtc = conns[i]->crtc;
+			atomic_add_crtc(&atom, crtc, crtc->pending.committed);
+		}
+		// Blocking, page-flip events can't tell CRTCs apart with a single
+		// commit
+		ok = atomic_commit(drm->fd, &atom, DRM_MODE_ATOMIC_ALLOW_MODESET, NULL);
+		if (!ok) {
+			wlr_log_errno(L_ERROR, "Atomic commit failed (modeset of %zu "
+				"outputs)", n);
+		}
+		atomic_finish(&atom);
+	}
+
+	for (size_t i = 0; i < n; ++i) {
+		crtc_pending_finish(drm, conns[i]->crtc, ok);
+	}
+	return ok;
 }
 
 static bool atomic_conn_enable(struct wlr_drm_backend *drm,
 		struct wlr_drm_connector *conn, bool enable) {
 	struct wlr_drm_crtc *crtc = conn->crtc;
 
-	struct atomic atom;
-	atomic_begin(crtc, &atom);
-	atomic_add(&atom, crtc->id, crtc->props.active, enable);
-	if (enable) {
-		atomic_add(&atom, conn->id, conn->props.crtc_id, crtc->id);
-		atomic_add(&atom, crtc->id, crtc->props.mode_id, crtc->mode_id);
-	} else {
-		atomic_add(&atom, conn->id, conn->props.crtc_id, 0);
-		atomic_add(&atom, crtc->id, crtc->props.mode_id, 0);
-	}
-	return atomic_commit(drm->fd, &atom, conn, DRM_MODE_ATOMIC_ALLOW_MODESET,
-		true);
+	crtc->pending.conn = conn;
+	crtc->pending.active = enable;
+	crtc->pending.committed |= WLR_DRM_CRTC_MODE;
+	return atomic_crtc_commit(drm, conn, crtc, DRM_MODE_ATOMIC_ALLOW_MODESET);
 }
 
+bool legacy_conn_set_dpms(struct wlr_drm_backend *drm,
+		struct wlr_drm_connector *conn, enum wlr_output_dpms_mode mode);
+
 bool legacy_crtc_set_cursor(struct wlr_drm_backend *drm,
 		struct wlr_drm_crtc *crtc, struct gbm_bo *bo);
 
@@ -158,19 +358,15 @@ static bool atomic_crtc_set_cursor(struct wlr_drm_backend *drm,
 	if (plane->id == 0) {
 		return legacy_crtc_set_cursor(drm, crtc, bo);
 	}
-
-	struct atomic atom;
-
-	atomic_begin(crtc, &atom);
-
-	if (bo) {
-		set_plane_props(&atom, plane, crtc->id, get_fb_for_bo(bo), false);
-	} else {
-		atomic_add(&atom, plane->id, plane->props.fb_id, 0);
-		atomic_add(&atom, plane->id, plane->props.crtc_id, 0);
+	if (crtc->cursor_failures >= CURSOR_MAX_FAILURES) {
+		// Let the output fall back to a software cursor
+		return false;
 	}
 
-	return atomic_end(drm->fd, &atom);
+	// Applied with the next page-flip
+	crtc->pending.cursor_fb_id = bo ? get_fb_for_bo(bo) : 0;
+	crtc->pending.committed |= WLR_DRM_CRTC_CURSOR;
+	return true;
 }
 
 bool legacy_crtc_move_cursor(struct wlr_drm_backend *drm,
@@ -187,46 +383,73 @@ static bool atomic_crtc_move_cursor(struct wlr_drm_backend *drm,
 	if (plane->id == 0) {
 		return legacy_crtc_move_cursor(drm, crtc, x, y);
 	}
+	if (crtc->cursor_failures >= CURSOR_MAX_FAILURES) {
+		return false;
+	}
 
-	struct atomic atom;
-
-	atomic_begin(crtc, &atom);
-	atomic_add(&atom, plane->id, plane->props.crtc_x, x);
-	atomic_add(&atom, plane->id, plane->props.crtc_y, y);
-	return atomic_end(drm->fd, &atom);
+	// Applied with the next page-flip
+	crtc->pending.cursor_x = x;
+	crtc->pending.cursor_y = y;
+	crtc->pending.committed |= WLR_DRM_CRTC_CURSOR_POS;
+	return true;
 }
 
 static bool atomic_crtc_set_gamma(struct wlr_drm_backend *drm,
 		struct wlr_drm_crtc *crtc, uint16_t *r, uint16_t *g, uint16_t *b,
 		uint32_t size) {
-	struct drm_color_lut gamma[size];
-
 	// Fallback to legacy gamma interface when gamma properties are not available
 	// (can happen on older intel gpu's that support gamma but not degamma)
 	if (crtc->props.gamma_lut == 0) {
 		return legacy_iface.crtc_set_gamma(drm, crtc, r, g, b, size);
 	}
 
+	uint32_t len = sizeof(struct drm_color_lut) * size;
+	struct drm_color_lut *gamma = malloc(len);
+	if (gamma == NULL) {
+		wlr_log(L_ERROR, "Allocation failed");
+		return false;
+	}
 	for (uint32_t i = 0; i < size; i++) {
 		gamma[i].red = r[i];
 		gamma[i].green = g[i];
 		gamma[i].blue = b[i];
 	}
 
-	if (crtc->gamma_lut != 0) {
-		drmModeDestroyPropertyBlob(drm->fd, crtc->gamma_lut);
+	// Drop any ramp which hasn't been committed yet
+	struct wlr_drm_crtc_pending *pending = &crtc->pending;
+	replace_gamma_lut(drm, crtc, false);
+	pending->committed &= ~WLR_DRM_CRTC_GAMMA;
+
+	if (crtc->gamma_lut != 0 && crtc->gamma_lut_len == len &&
+			memcmp(crtc->gamma_lut_data, gamma, len) == 0) {
+		// Already displayed, keep the current blob
+		free(gamma);
+		return true;
 	}
 
-	if (drmModeCreatePropertyBlob(drm->fd, gamma,
-				sizeof(struct drm_color_lut) * size, &crtc->gamma_lut)) {
+	if (drmModeCreatePropertyBlob(drm->fd, gamma, len, &pending->gamma_lut)) {
 		wlr_log_errno(L_ERROR, "Unable to create property blob");
+		free(gamma);
 		return false;
 	}
+	pending->gamma_lut_data = gamma;
+	pending->gamma_lut_len = len;
 
-	struct atomic atom;
-	atomic_begin(crtc, &atom);
-	atomic_add(&atom, crtc->id, crtc->props.gamma_lut, crtc->gamma_lut);
-	return atomic_end(drm->fd, &atom);
+	// Applied with the next page-flip
+	pending->committed |= WLR_DRM_CRTC_GAMMA;
+	return true;
+}
+
+static bool atomic_crtc_set_vrr(struct wlr_drm_backend *drm,
+		struct wlr_drm_crtc *crtc, bool enabled) {
+	if (crtc->props.vrr_enabled == 0) {
+		return false;
+	}
+
+	// Applied with the next page-flip
+	crtc->pending.vrr_enabled = enabled;
+	crtc->pending.committed |= WLR_DRM_CRTC_VRR;
+	return true;
 }
 
 static uint32_t atomic_crtc_get_gamma_size(struct wlr_drm_backend *drm,
@@ -248,9 +471,14 @@ static uint32_t atomic_crtc_get_gamma_size(struct wlr_drm_backend *drm,
 
 const struct wlr_drm_interface atomic_iface = {
 	.conn_enable = atomic_conn_enable,
+	// The kernel turns the legacy DPMS property into an atomic commit which
+	// only toggles the CRTC, keeping its mode and planes
+	.conn_set_dpms = legacy_conn_set_dpms,
 	.crtc_pageflip = atomic_crtc_pageflip,
+	.conn_modeset = atomic_conn_modeset,
 	.crtc_set_cursor = atomic_crtc_set_cursor,
 	.crtc_move_cursor = atomic_crtc_move_cursor,
 	.crtc_set_gamma = atomic_crtc_set_gamma,
+	.crtc_set_vrr = atomic_crtc_set_vrr,
 	.crtc_get_gamma_size = atomic_crtc_get_gamma_size,
 };
@@ -84,6 +84,9 @@ static void session_signal(struct wl_listener *listener, void *data) {
 			if (conn->output.current_mode) {
 				wlr_output_set_mode(&conn->output, conn->output.current_mode);
 			}
+			if (conn->output.dpms_mode != WLR_OUTPUT_DPMS_ON) {
+				drm->iface->conn_set_dpms(drm, conn, conn->output.dpms_mode);
+			}
 
 			if (!conn->crtc) {
 				continue;
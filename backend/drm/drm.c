@@ -167,14 +167,21 @@ void wlr_drm_resources_free(struct wlr_drm_backend *drm) {
 
 	for (size_t i = 0; i < drm->num_crtcs; ++i) {
 		struct wlr_drm_crtc *crtc = &drm->crtcs[i];
-		drmModeAtomicFree(crtc->atomic);
 		drmModeFreeCrtc(crtc->legacy_crtc);
+		if (crtc->pending.mode_id) {
+			drmModeDestroyPropertyBlob(drm->fd, crtc->pending.mode_id);
+		}
+		if (crtc->pending.gamma_lut) {
+			drmModeDestroyPropertyBlob(drm->fd, crtc->pending.gamma_lut);
+		}
+		free(crtc->pending.gamma_lut_data);
 		if (crtc->mode_id) {
 			drmModeDestroyPropertyBlob(drm->fd, crtc->mode_id);
 		}
 		if (crtc->gamma_lut) {
 			drmModeDestroyPropertyBlob(drm->fd, crtc->gamma_lut);
 		}
+		free(crtc->gamma_lut_data);
 	}
 	for (size_t i = 0; i < drm->num_planes; ++i) {
 		struct wlr_drm_plane *plane = &drm->planes[i];
@@ -196,6 +203,33 @@ static bool wlr_drm_connector_make_current(struct wlr_output *output,
 	return wlr_drm_surface_make_current(&conn->crtc->primary->surf, buffer_age);
 }
 
+/**
+ * Returns a framebuffer id on this GPU for a buffer of the plane's surface.
+ * Multi-GPU planes import the buffer if possible and copy it otherwise.
+ */
+static uint32_t drm_plane_get_fb(struct wlr_drm_backend *drm,
+		struct wlr_drm_plane *plane, struct gbm_bo *bo) {
+	if (!drm->parent) {
+		return wlr_drm_surface_get_fb(&plane->surf, bo);
+	}
+
+	if (plane->mgpu_import) {
+		uint32_t fb_id =
+			wlr_drm_surface_import_fb(&plane->surf, &drm->renderer, bo);
+		if (fb_id) {
+			return fb_id;
+		}
+		wlr_log(L_INFO, "Failed to import buffer, falling back to copying");
+		plane->mgpu_import = false;
+	}
+
+	bo = wlr_drm_surface_mgpu_copy(&plane->mgpu_surf, &plane->surf, bo);
+	if (!bo) {
+		return 0;
+	}
+	return wlr_drm_surface_get_fb(&plane->mgpu_surf, bo);
+}
+
 static bool wlr_drm_connector_swap_buffers(struct wlr_output *output,
 		pixman_region32_t *damage) {
 	struct wlr_drm_connector *conn = (struct wlr_drm_connector *)output;
@@ -210,17 +244,30 @@ static bool wlr_drm_connector_swap_buffers(struct wlr_output *output,
 	}
 	struct wlr_drm_plane *plane = crtc->primary;
 
-	struct gbm_bo *bo = wlr_drm_surface_swap_buffers(&plane->surf, damage);
-	if (drm->parent) {
-		bo = wlr_drm_surface_mgpu_copy(&plane->mgpu_surf, bo);
-	}
-	uint32_t fb_id = get_fb_for_bo(bo);
-
 	if (conn->pageflip_pending) {
+		// Keep the frame around and flip to it once the pending page-flip
+		// completes. Copying multi-GPU surfaces can't, the copy's front
+		// buffer is still in use.
+		if (!drm->parent || plane->mgpu_import) {
+			wlr_drm_surface_queue_buffers(&plane->surf, damage);
+			return true;
+		}
 		wlr_log(L_ERROR, "Skipping pageflip");
 		return false;
 	}
 
+	struct gbm_bo *bo = wlr_drm_surface_swap_buffers(&plane->surf, damage);
+	uint32_t fb_id = drm_plane_get_fb(drm, plane, bo);
+	if (!fb_id) {
+		return false;
+	}
+
+	if (output->adaptive_sync != crtc->vrr_enabled &&
+			drm->iface->crtc_set_vrr != NULL) {
+		// The connector may have been moved to another CRTC
+		drm->iface->crtc_set_vrr(drm, crtc, output->adaptive_sync);
+	}
+
 	if (!drm->iface->crtc_pageflip(drm, conn, crtc, fb_id, NULL)) {
 		return false;
 	}
@@ -230,19 +277,16 @@ static bool wlr_drm_connector_swap_buffers(struct wlr_output *output,
 	return true;
 }
 
-static void wlr_drm_connector_set_gamma(struct wlr_output *output,
+static bool wlr_drm_connector_set_gamma(struct wlr_output *output,
 		uint32_t size, uint16_t *r, uint16_t *g, uint16_t *b) {
 	struct wlr_drm_connector *conn = (struct wlr_drm_connector *)output;
 	struct wlr_drm_backend *drm = (struct wlr_drm_backend *)output->backend;
-	bool ok;
-
-	if (conn->crtc) {
-		ok = drm->iface->crtc_set_gamma(drm, conn->crtc, r, g, b, size);
-		if (ok) {
-			wlr_output_update_needs_swap(output);
-		}
+	if (!conn->crtc ||
+			!drm->iface->crtc_set_gamma(drm, conn->crtc, r, g, b, size)) {
+		return false;
 	}
-
+	wlr_output_update_needs_swap(output);
+	return true;
 }
 
 static uint32_t wlr_drm_connector_get_gamma_size(struct wlr_output *output) {
@@ -256,6 +300,39 @@ static uint32_t wlr_drm_connector_get_gamma_size(struct wlr_output *output) {
 	return 0;
 }
 
+static bool wlr_drm_connector_enable_adaptive_sync(struct wlr_output *output,
+		bool enabled) {
+	struct wlr_drm_connector *conn = (struct wlr_drm_connector *)output;
+	struct wlr_drm_backend *drm = (struct wlr_drm_backend *)output->backend;
+	if (!conn->crtc || drm->iface->crtc_set_vrr == NULL) {
+		return false;
+	}
+
+	uint64_t capable = 0;
+	if (enabled && (conn->props.vrr_capable == 0 ||
+			!wlr_drm_get_prop(drm->fd, conn->id, conn->props.vrr_capable,
+				&capable) || !capable)) {
+		wlr_log(L_DEBUG, "%s: Adaptive sync is not supported",
+			conn->output.name);
+		return false;
+	}
+
+	return drm->iface->crtc_set_vrr(drm, conn->crtc, enabled);
+}
+
+static uint32_t drm_connector_get_front_fb(struct wlr_drm_connector *conn) {
+	struct wlr_drm_backend *drm = (struct wlr_drm_backend *)conn->output.backend;
+	struct wlr_drm_plane *plane = conn->crtc->primary;
+
+	if (drm->parent && !plane->mgpu_import) {
+		struct gbm_bo *bo = wlr_drm_surface_get_front(&plane->mgpu_surf);
+		return wlr_drm_surface_get_fb(&plane->mgpu_surf, bo);
+	}
+
+	struct gbm_bo *bo = wlr_drm_surface_get_front(&plane->surf);
+	return drm_plane_get_fb(drm, plane, bo);
+}
+
 void wlr_drm_connector_start_renderer(struct wlr_drm_connector *conn) {
 	if (conn->state != WLR_DRM_CONN_CONNECTED) {
 		return;
@@ -266,11 +343,8 @@ void wlr_drm_connector_start_renderer(struct wlr_drm_connector *conn) {
 	if (!crtc) {
 		return;
 	}
-	struct wlr_drm_plane *plane = crtc->primary;
 
-	struct gbm_bo *bo = wlr_drm_surface_get_front(
-		drm->parent ? &plane->mgpu_surf : &plane->surf);
-	uint32_t fb_id = get_fb_for_bo(bo);
+	uint32_t fb_id = drm_connector_get_front_fb(conn);
 
 	struct wlr_drm_mode *mode = (struct wlr_drm_mode *)conn->output.current_mode;
 	if (drm->iface->crtc_pageflip(drm, conn, crtc, fb_id, &mode->drm_mode)) {
@@ -282,6 +356,40 @@ void wlr_drm_connector_start_renderer(struct wlr_drm_connector *conn) {
 	}
 }
 
+/**
+ * Starts the renderers of several connectors, with a single modeset if the
+ * interface supports it so that all outputs light up at once.
+ */
+static void drm_connectors_start_renderers(struct wlr_drm_backend *drm,
+		struct wlr_drm_connector **conns, size_t n) {
+	if (n > 1 && drm->iface->conn_modeset) {
+		uint32_t fb_ids[n];
+		for (size_t i = 0; i < n; ++i) {
+			fb_ids[i] = drm_connector_get_front_fb(conns[i]);
+		}
+
+		if (drm->iface->conn_modeset(drm, conns, fb_ids, n)) {
+			// Page-flip to the same buffers to get the frame events
+			for (size_t i = 0; i < n; ++i) {
+				struct wlr_drm_connector *conn = conns[i];
+				if (drm->iface->crtc_pageflip(drm, conn, conn->crtc,
+						fb_ids[i], NULL)) {
+					conn->pageflip_pending = true;
+					wlr_output_update_enabled(&conn->output, true);
+				} else {
+					wl_event_source_timer_update(conn->retry_pageflip,
+						1000000.0f / conn->output.current_mode->refresh);
+				}
+			}
+			return;
+		}
+	}
+
+	for (size_t i = 0; i < n; ++i) {
+		wlr_drm_connector_start_renderer(conns[i]);
+	}
+}
+
 static void wlr_drm_connector_enable(struct wlr_output *output, bool enable) {
 	struct wlr_drm_connector *conn = (struct wlr_drm_connector *)output;
 	if (conn->state != WLR_DRM_CONN_CONNECTED) {
@@ -301,6 +409,21 @@ static void wlr_drm_connector_enable(struct wlr_output *output, bool enable) {
 	wlr_output_update_enabled(&conn->output, enable);
 }
 
+static bool wlr_drm_connector_set_dpms(struct wlr_output *output,
+		enum wlr_output_dpms_mode mode) {
+	struct wlr_drm_connector *conn = (struct wlr_drm_connector *)output;
+	if (conn->state != WLR_DRM_CONN_CONNECTED) {
+		return false;
+	}
+
+	struct wlr_drm_backend *drm = (struct wlr_drm_backend *)output->backend;
+	if (!drm->session->active) {
+		// Applied when the session is resumed
+		return true;
+	}
+	return drm->iface->conn_set_dpms(drm, conn, mode);
+}
+
 static void realloc_planes(struct wlr_drm_backend *drm, const uint32_t *crtc_in,
 		bool *changed_outputs) {
 	// overlay, primary, cursor
@@ -469,6 +592,7 @@ static bool wlr_drm_connector_set_mode(struct wlr_output *output,
 	struct wlr_drm_connector *conn = (struct wlr_drm_connector *)output;
 	struct wlr_drm_backend *drm = (struct wlr_drm_backend *)output->backend;
 	bool changed_outputs[wl_list_length(&drm->outputs)];
+	struct wlr_drm_connector *restart[wl_list_length(&drm->outputs)];
 
 	wlr_log(L_INFO, "Modesetting '%s' with '%ux%u@%u mHz'", conn->output.name,
 			mode->width, mode->height, mode->refresh);
@@ -501,6 +625,7 @@ static bool wlr_drm_connector_set_mode(struct wlr_output *output,
 
 	// Since realloc_crtcs can deallocate planes on OTHER outputs,
 	// we actually need to reinitialize any than has changed
+	size_t restart_len = 0;
 	ssize_t output_index = -1;
 	wl_list_for_each(conn, &drm->outputs, link) {
 		output_index += 1;
@@ -518,9 +643,10 @@ static bool wlr_drm_connector_set_mode(struct wlr_output *output,
 			goto error_conn;
 		}
 
-		wlr_drm_connector_start_renderer(conn);
+		restart[restart_len++] = conn;
 	}
 
+	drm_connectors_start_renderers(drm, restart, restart_len);
 	return true;
 
 error_conn:
@@ -726,6 +852,8 @@ static struct wlr_output_impl output_impl = {
 	.swap_buffers = wlr_drm_connector_swap_buffers,
 	.set_gamma = wlr_drm_connector_set_gamma,
 	.get_gamma_size = wlr_drm_connector_get_gamma_size,
+	.set_dpms = wlr_drm_connector_set_dpms,
+	.enable_adaptive_sync = wlr_drm_connector_enable_adaptive_sync,
 };
 
 bool wlr_output_is_drm(struct wlr_output *output) {
@@ -915,9 +1043,33 @@ static void page_flip_handler(int fd, unsigned seq,
 		return;
 	}
 
-	wlr_drm_surface_post(&conn->crtc->primary->surf);
+	struct timespec when = {
+		.tv_sec = tv_sec,
+		.tv_nsec = tv_usec * 1000,
+	};
+	wlr_output_send_present(&conn->output, &when, seq, 0);
+
+	struct wlr_drm_plane *plane = conn->crtc->primary;
+	wlr_drm_surface_post(&plane->surf);
 	if (drm->parent) {
-		wlr_drm_surface_post(&conn->crtc->primary->mgpu_surf);
+		wlr_drm_surface_post(&plane->mgpu_surf);
+	}
+
+	// Only rotate the buffers once the queued one is sure to be displayed,
+	// the front buffer is still scanned out until then
+	struct gbm_bo *queued = plane->surf.queued;
+	if (queued) {
+		uint32_t fb_id = 0;
+		if (drm->session->active) {
+			fb_id = drm_plane_get_fb(drm, plane, queued);
+		}
+		if (fb_id && drm->iface->crtc_pageflip(drm, conn, conn->crtc,
+				fb_id, NULL)) {
+			wlr_drm_surface_flip_queued(&plane->surf);
+			conn->pageflip_pending = true;
+		} else {
+			wlr_drm_surface_drop_queued(&plane->surf);
+		}
 	}
 
 	if (drm->session->active) {
@@ -32,6 +32,29 @@ static bool legacy_conn_enable(struct wlr_drm_backend *drm,
 	return ret >= 0;
 }
 
+bool legacy_conn_set_dpms(struct wlr_drm_backend *drm,
+		struct wlr_drm_connector *conn, enum wlr_output_dpms_mode mode) {
+	uint64_t value;
+	switch (mode) {
+	case WLR_OUTPUT_DPMS_ON:
+		value = DRM_MODE_DPMS_ON;
+		break;
+	case WLR_OUTPUT_DPMS_STANDBY:
+		value = DRM_MODE_DPMS_STANDBY;
+		break;
+	default:
+		value = DRM_MODE_DPMS_OFF;
+		break;
+	}
+
+	if (drmModeConnectorSetProperty(drm->fd, conn->id, conn->props.dpms,
+			value)) {
+		wlr_log_errno(L_ERROR, "%s: Failed to set DPMS", conn->output.name);
+		return false;
+	}
+	return true;
+}
+
 bool legacy_crtc_set_cursor(struct wlr_drm_backend *drm,
 		struct wlr_drm_crtc *crtc, struct gbm_bo *bo) {
 	if (!crtc || !crtc->cursor) {
@@ -72,6 +95,7 @@ uint32_t legacy_crtc_get_gamma_size(struct wlr_drm_backend *drm,
 
 const struct wlr_drm_interface legacy_iface = {
 	.conn_enable = legacy_conn_enable,
+	.conn_set_dpms = legacy_conn_set_dpms,
 	.crtc_pageflip = legacy_crtc_pageflip,
 	.crtc_set_cursor = legacy_crtc_set_cursor,
 	.crtc_move_cursor = legacy_crtc_move_cursor,
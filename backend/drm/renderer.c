@@ -2,8 +2,10 @@
 #include <EGL/eglext.h>
 #include <gbm.h>
 #include <GLES2/gl2.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <wayland-util.h>
 #include <wlr/render.h>
@@ -12,6 +14,7 @@
 #include <wlr/render/matrix.h>
 #include <wlr/util/log.h>
 #include "backend/drm/drm.h"
+#include "backend/drm/util.h"
 #include "glapi.h"
 
 bool wlr_drm_renderer_init(struct wlr_drm_backend *drm,
@@ -53,6 +56,47 @@ void wlr_drm_renderer_finish(struct wlr_drm_renderer *renderer) {
 	gbm_device_destroy(renderer->gbm);
 }
 
+static void drm_buffer_finish(struct wlr_drm_surface *surf,
+		struct wlr_drm_buffer *buf) {
+	if (buf->fb_id) {
+		drmModeRmFB(surf->renderer->fd, buf->fb_id);
+	}
+	if (buf->texture) {
+		wlr_texture_destroy(buf->texture);
+	}
+	if (buf->image) {
+		wlr_egl_destroy_image(&buf->mgpu_renderer->egl, buf->image);
+	}
+	if (buf->mgpu_fb_id) {
+		drmModeRmFB(buf->mgpu_renderer->fd, buf->mgpu_fb_id);
+	}
+	if (buf->mgpu_bo) {
+		gbm_bo_destroy(buf->mgpu_bo);
+	}
+	memset(buf, 0, sizeof(*buf));
+}
+
+static void drm_surface_release_buffers(struct wlr_drm_surface *surf) {
+	for (size_t i = 0; i < WLR_DRM_SURFACE_MAX_BUFFERS; ++i) {
+		if (surf->buffers[i].bo) {
+			drm_buffer_finish(surf, &surf->buffers[i]);
+		}
+	}
+
+	if (surf->front) {
+		gbm_surface_release_buffer(surf->gbm, surf->front);
+		surf->front = NULL;
+	}
+	if (surf->back) {
+		gbm_surface_release_buffer(surf->gbm, surf->back);
+		surf->back = NULL;
+	}
+	if (surf->queued) {
+		gbm_surface_release_buffer(surf->gbm, surf->queued);
+		surf->queued = NULL;
+	}
+}
+
 bool wlr_drm_surface_init(struct wlr_drm_surface *surf,
 		struct wlr_drm_renderer *renderer, uint32_t width, uint32_t height,
 		uint32_t format, uint32_t flags) {
@@ -60,21 +104,15 @@ bool wlr_drm_surface_init(struct wlr_drm_surface *surf,
 		return true;
 	}
 
+	if (surf->gbm) {
+		drm_surface_release_buffers(surf);
+		gbm_surface_destroy(surf->gbm);
+	}
+
 	surf->renderer = renderer;
 	surf->width = width;
 	surf->height = height;
 
-	if (surf->gbm) {
-		if (surf->front) {
-			gbm_surface_release_buffer(surf->gbm, surf->front);
-			surf->front = NULL;
-		}
-		if (surf->back) {
-			gbm_surface_release_buffer(surf->gbm, surf->back);
-			surf->back = NULL;
-		}
-		gbm_surface_destroy(surf->gbm);
-	}
 	if (surf->egl) {
 		eglDestroySurface(surf->renderer->egl.display, surf->egl);
 	}
@@ -109,12 +147,7 @@ void wlr_drm_surface_finish(struct wlr_drm_surface *surf) {
 	eglMakeCurrent(surf->renderer->egl.display, EGL_NO_SURFACE, EGL_NO_SURFACE,
 		EGL_NO_CONTEXT);
 
-	if (surf->front) {
-		gbm_surface_release_buffer(surf->gbm, surf->front);
-	}
-	if (surf->back) {
-		gbm_surface_release_buffer(surf->gbm, surf->back);
-	}
+	drm_surface_release_buffers(surf);
 
 	if (surf->egl) {
 		eglDestroySurface(surf->renderer->egl.display, surf->egl);
@@ -163,33 +196,94 @@ void wlr_drm_surface_post(struct wlr_drm_surface *surf) {
 	}
 }
 
-struct tex {
-	struct wlr_egl *egl;
-	EGLImageKHR img;
-	struct wlr_texture *tex;
-};
+void wlr_drm_surface_queue_buffers(struct wlr_drm_surface *surf,
+		pixman_region32_t *damage) {
+	if (surf->queued) {
+		gbm_surface_release_buffer(surf->gbm, surf->queued);
+	}
 
-static void free_eglimage(struct gbm_bo *bo, void *data) {
-	struct tex *tex = data;
+	wlr_egl_swap_buffers(&surf->renderer->egl, surf->egl, damage);
 
-	wlr_egl_destroy_image(tex->egl, tex->img);
-	wlr_texture_destroy(tex->tex);
-	free(tex);
+	surf->queued = gbm_surface_lock_front_buffer(surf->gbm);
 }
 
-static struct wlr_texture *get_tex_for_bo(struct wlr_drm_renderer *renderer, struct gbm_bo *bo) {
-	struct tex *tex = gbm_bo_get_user_data(bo);
-	if (tex) {
-		return tex->tex;
+void wlr_drm_surface_flip_queued(struct wlr_drm_surface *surf) {
+	if (!surf->queued) {
+		return;
 	}
 
-	tex = malloc(sizeof(*tex));
-	if (!tex) {
-		wlr_log_errno(L_ERROR, "Allocation failed");
+	if (surf->front) {
+		gbm_surface_release_buffer(surf->gbm, surf->front);
+	}
+
+	surf->front = surf->back;
+	surf->back = surf->queued;
+	surf->queued = NULL;
+}
+
+void wlr_drm_surface_drop_queued(struct wlr_drm_surface *surf) {
+	if (surf->queued) {
+		gbm_surface_release_buffer(surf->gbm, surf->queued);
+		surf->queued = NULL;
+	}
+}
+
+static bool drm_surface_buffer_in_use(struct wlr_drm_surface *surf,
+		struct gbm_bo *bo) {
+	return bo == surf->front || bo == surf->back || bo == surf->queued;
+}
+
+/**
+ * Finds the pool entry of a buffer of the surface, or makes a new one.
+ */
+static struct wlr_drm_buffer *drm_surface_get_buffer(
+		struct wlr_drm_surface *surf, struct gbm_bo *bo) {
+	struct wlr_drm_buffer *free_buf = NULL;
+	for (size_t i = 0; i < WLR_DRM_SURFACE_MAX_BUFFERS; ++i) {
+		struct wlr_drm_buffer *buf = &surf->buffers[i];
+		if (buf->bo == bo) {
+			return buf;
+		}
+		if (!free_buf && (!buf->bo ||
+				!drm_surface_buffer_in_use(surf, buf->bo))) {
+			free_buf = buf;
+		}
+	}
+
+	if (!free_buf) {
+		wlr_log(L_ERROR, "No free slot in DRM surface buffer pool");
 		return NULL;
 	}
 
-	tex->egl = &renderer->egl;
+	if (free_buf->bo) {
+		drm_buffer_finish(surf, free_buf);
+	}
+	free_buf->bo = bo;
+	return free_buf;
+}
+
+uint32_t wlr_drm_surface_get_fb(struct wlr_drm_surface *surf,
+		struct gbm_bo *bo) {
+	struct wlr_drm_buffer *buf = drm_surface_get_buffer(surf, bo);
+	if (!buf) {
+		return 0;
+	}
+
+	if (!buf->fb_id) {
+		buf->fb_id = create_fb_for_bo(bo);
+	}
+	return buf->fb_id;
+}
+
+static struct wlr_texture *get_tex_for_bo(struct wlr_drm_surface *surf,
+		struct wlr_drm_renderer *renderer, struct gbm_bo *bo) {
+	struct wlr_drm_buffer *buf = drm_surface_get_buffer(surf, bo);
+	if (!buf) {
+		return NULL;
+	}
+	if (buf->texture) {
+		return buf->texture;
+	}
 
 	int dmabuf_fd = gbm_bo_get_fd(bo);
 	uint32_t width = gbm_bo_get_width(bo);
@@ -206,26 +300,29 @@ static struct wlr_texture *get_tex_for_bo(struct wlr_drm_renderer *renderer, str
 		EGL_NONE,
 	};
 
-	tex->img = eglCreateImageKHR(renderer->egl.display, EGL_NO_CONTEXT,
+	buf->mgpu_renderer = renderer;
+	buf->image = eglCreateImageKHR(renderer->egl.display, EGL_NO_CONTEXT,
 		EGL_LINUX_DMA_BUF_EXT, NULL, attribs);
-	if (!tex->img) {
+	close(dmabuf_fd);
+	if (!buf->image) {
 		wlr_log(L_ERROR, "Failed to create EGL image: %s", egl_error());
 		abort();
 	}
 
-	tex->tex = wlr_render_texture_create(renderer->wlr_rend);
-	wlr_texture_upload_eglimage(tex->tex, tex->img, width, height);
-
-	gbm_bo_set_user_data(bo, tex, free_eglimage);
+	buf->texture = wlr_render_texture_create(renderer->wlr_rend);
+	wlr_texture_upload_eglimage(buf->texture, buf->image, width, height);
 
-	return tex->tex;
+	return buf->texture;
 }
 
 struct gbm_bo *wlr_drm_surface_mgpu_copy(struct wlr_drm_surface *dest,
-		struct gbm_bo *src) {
+		struct wlr_drm_surface *src, struct gbm_bo *bo) {
 	wlr_drm_surface_make_current(dest, NULL);
 
-	struct wlr_texture *tex = get_tex_for_bo(dest->renderer, src);
+	struct wlr_texture *tex = get_tex_for_bo(src, dest->renderer, bo);
+	if (!tex) {
+		return NULL;
+	}
 
 	static const float matrix[16] = {
 		[0] = 2.0f,
@@ -244,6 +341,72 @@ struct gbm_bo *wlr_drm_surface_mgpu_copy(struct wlr_drm_surface *dest,
 	return wlr_drm_surface_swap_buffers(dest, NULL);
 }
 
+static struct gbm_bo *import_bo(struct wlr_drm_renderer *dest,
+		struct gbm_bo *bo) {
+	struct gbm_import_fd_data data = {
+		.fd = gbm_bo_get_fd(bo),
+		.width = gbm_bo_get_width(bo),
+		.height = gbm_bo_get_height(bo),
+		.stride = gbm_bo_get_stride(bo),
+		.format = gbm_bo_get_format(bo),
+	};
+	if (data.fd < 0) {
+		wlr_log(L_ERROR, "Failed to export buffer as dmabuf");
+		return NULL;
+	}
+
+	struct gbm_bo *imported = gbm_bo_import(dest->gbm, GBM_BO_IMPORT_FD,
+		&data, GBM_BO_USE_SCANOUT);
+	close(data.fd);
+	return imported;
+}
+
+uint32_t wlr_drm_surface_import_fb(struct wlr_drm_surface *surf,
+		struct wlr_drm_renderer *dest, struct gbm_bo *bo) {
+	struct wlr_drm_buffer *buf = drm_surface_get_buffer(surf, bo);
+	if (!buf) {
+		return 0;
+	}
+	if (buf->mgpu_fb_id) {
+		return buf->mgpu_fb_id;
+	}
+
+	if (!buf->mgpu_bo) {
+		buf->mgpu_renderer = dest;
+		buf->mgpu_bo = import_bo(dest, bo);
+		if (!buf->mgpu_bo) {
+			return 0;
+		}
+	}
+
+	buf->mgpu_fb_id = create_fb_for_bo(buf->mgpu_bo);
+	return buf->mgpu_fb_id;
+}
+
+bool wlr_drm_renderer_can_import(struct wlr_drm_renderer *src,
+		struct wlr_drm_renderer *dest, uint32_t width, uint32_t height,
+		uint32_t format) {
+	struct gbm_bo *bo = gbm_bo_create(src->gbm, width, height, format,
+		GBM_BO_USE_LINEAR | GBM_BO_USE_RENDERING);
+	if (!bo) {
+		return false;
+	}
+
+	bool ok = false;
+	struct gbm_bo *imported = import_bo(dest, bo);
+	if (imported) {
+		uint32_t fb_id = create_fb_for_bo(imported);
+		if (fb_id) {
+			drmModeRmFB(dest->fd, fb_id);
+			ok = true;
+		}
+		gbm_bo_destroy(imported);
+	}
+
+	gbm_bo_destroy(bo);
+	return ok;
+}
+
 bool wlr_drm_plane_surfaces_init(struct wlr_drm_plane *plane, struct wlr_drm_backend *drm,
 		int32_t width, uint32_t height, uint32_t format) {
 	if (!drm->parent) {
@@ -262,5 +425,12 @@ bool wlr_drm_plane_surfaces_init(struct wlr_drm_plane *plane, struct wlr_drm_bac
 		return false;
 	}
 
+	// Scan out the parent's buffers directly if this GPU can import them, the
+	// copy is only a fallback
+	plane->mgpu_import = wlr_drm_renderer_can_import(&drm->parent->renderer,
+		&drm->renderer, width, height, format);
+	wlr_log(L_DEBUG, "Multi-GPU plane %"PRIu32": %s", plane->id,
+		plane->mgpu_import ? "importing buffers" : "copying buffers");
+
 	return true;
 }
@@ -1,6 +1,7 @@
 #include <drm_mode.h>
 #include <drm.h>
 #include <gbm.h>
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 #include <wlr/util/log.h>
@@ -157,12 +158,7 @@ static void free_fb(struct gbm_bo *bo, void *data) {
 	}
 }
 
-uint32_t get_fb_for_bo(struct gbm_bo *bo) {
-	uint32_t id = (uintptr_t)gbm_bo_get_user_data(bo);
-	if (id) {
-		return id;
-	}
-
+uint32_t create_fb_for_bo(struct gbm_bo *bo) {
 	struct gbm_device *gbm = gbm_bo_get_device(bo);
 
 	int fd = gbm_device_get_fd(gbm);
@@ -173,144 +169,132 @@ uint32_t get_fb_for_bo(struct gbm_bo *bo) {
 	uint32_t offsets[4] = {gbm_bo_get_offset(bo, 0)};
 	uint32_t format = gbm_bo_get_format(bo);
 
+	uint32_t id = 0;
 	if (drmModeAddFB2(fd, width, height, format, handles, pitches, offsets, &id, 0)) {
 		wlr_log_errno(L_ERROR, "Unable to add DRM framebuffer");
+		return 0;
 	}
 
+	return id;
+}
+
+uint32_t get_fb_for_bo(struct gbm_bo *bo) {
+	uint32_t id = (uintptr_t)gbm_bo_get_user_data(bo);
+	if (id) {
+		return id;
+	}
+
+	id = create_fb_for_bo(bo);
 	gbm_bo_set_user_data(bo, (void *)(uintptr_t)id, free_fb);
 
 	return id;
 }
 
-static inline bool is_taken(size_t n, const uint32_t arr[static n], uint32_t key) {
-	for (size_t i = 0; i < n; ++i) {
-		if (arr[i] == key) {
-			return true;
-		}
-	}
-	return false;
+static inline bool match_can_use(const uint32_t *objs, const uint32_t *orig,
+		size_t i, uint32_t j) {
+	// The current solution is always allowed, even if it is not compatible
+	// anymore, so that active outputs don't get disabled
+	return orig[i] == j || (objs[j] & (1 << i));
 }
 
-/*
- * Store all of the non-recursive state in a struct, so we aren't literally
- * passing 12 arguments to a function.
- */
-struct match_state {
-	const size_t num_objs;
-	const uint32_t *restrict objs;
-	const size_t num_res;
-	size_t score;
-	size_t replaced;
-	uint32_t *restrict res;
-	uint32_t *restrict best;
-	const uint32_t *restrict orig;
-	bool exit_early;
-};
+static inline int match_cost(const uint32_t *orig, size_t i, uint32_t j) {
+	// Taking a different object than in the current solution is a change
+	return orig[i] == j ? 0 : 1;
+}
 
 /*
- * skips: The number of SKIP elements encountered so far.
- * score: The number of resources we've matched so far.
- * replaced: The number of changes from the original solution.
- * i: The index of the current element.
- *
- * This tries to match a solution as close to st->orig as it can.
+ * This is a minimum-cost maximum matching, computed with successive shortest
+ * augmenting paths. Each augmentation increases the number of matches by one
+ * and the shortest path keeps the number of changes from the current solution
+ * minimal for that number of matches. Path lengths are computed with
+ * Bellman-Ford, because undoing a match has a negative cost.
  *
- * Returns whether we've set a new best element with this solution.
+ * This is O(n^2 * m^2) in the worst case, with n resources and m objects.
  */
-static bool match_obj_(struct match_state *st, size_t skips, size_t score, size_t replaced, size_t i) {
-	// Finished
-	if (i >= st->num_res) {
-		if (score > st->score || (score == st->score && replaced < st->replaced)) {
-			st->score = score;
-			st->replaced = replaced;
-			memcpy(st->best, st->res, sizeof(st->best[0]) * st->num_res);
-
-			if (st->score == st->num_objs && st->replaced == 0) {
-				st->exit_early = true;
-			}
-			st->exit_early = (st->score == st->num_res - skips
-					|| st->score == st->num_objs)
-					&& st->replaced == 0;
-
-			return true;
-		} else {
-			return false;
-		}
+size_t match_obj(size_t num_objs, const uint32_t objs[static restrict num_objs],
+		size_t num_res, const uint32_t res[static restrict num_res],
+		uint32_t out[static restrict num_res]) {
+	const int inf = INT_MAX / 2;
+	uint32_t obj_match[num_objs];
+	int res_dist[num_res], obj_dist[num_objs];
+	uint32_t obj_prev[num_objs];
+	uint32_t res_orig[num_res];
+
+	for (size_t i = 0; i < num_res; ++i) {
+		out[i] = res[i] == SKIP ? SKIP : UNMATCHED;
+		res_orig[i] = res[i] < num_objs ? res[i] : UNMATCHED;
 	}
-
-	if (st->orig[i] == SKIP) {
-		st->res[i] = SKIP;
-		return match_obj_(st, skips + 1, score, replaced, i + 1);
+	for (size_t j = 0; j < num_objs; ++j) {
+		obj_match[j] = UNMATCHED;
 	}
 
-	/*
-	 * Attempt to use the current solution first, to try and avoid
-	 * recalculating everything
-	 */
-
-	if (st->orig[i] != UNMATCHED && !is_taken(i, st->res, st->orig[i])) {
-		st->res[i] = st->orig[i];
-		if (match_obj_(st, skips, score + 1, replaced, i + 1)) {
-			return true;
+	size_t score = 0;
+	while (true) {
+		for (size_t i = 0; i < num_res; ++i) {
+			res_dist[i] = out[i] == UNMATCHED ? 0 : inf;
 		}
-	}
-
-	if (st->orig[i] != UNMATCHED) {
-		++replaced;
-	}
-
-	bool is_best = false;
-	for (st->res[i] = 0; st->res[i] < st->num_objs; ++st->res[i]) {
-		// We tried this earlier
-		if (st->res[i] == st->orig[i]) {
-			continue;
+		for (size_t j = 0; j < num_objs; ++j) {
+			obj_dist[j] = inf;
+			obj_prev[j] = UNMATCHED;
 		}
 
-		// Not compatable
-		if (!(st->objs[st->res[i]] & (1 << i))) {
-			continue;
-		}
+		bool changed = true;
+		while (changed) {
+			changed = false;
+
+			for (size_t i = 0; i < num_res; ++i) {
+				if (res_dist[i] == inf || out[i] == SKIP) {
+					continue;
+				}
+				for (uint32_t j = 0; j < num_objs; ++j) {
+					if (out[i] == j || !match_can_use(objs, res_orig, i, j)) {
+						continue;
+					}
+					int d = res_dist[i] + match_cost(res_orig, i, j);
+					if (d < obj_dist[j]) {
+						obj_dist[j] = d;
+						obj_prev[j] = i;
+						changed = true;
+					}
+				}
+			}
 
-		// Already taken
-		if (is_taken(i, st->res, st->res[i])) {
-			continue;
+			// Go back through the current matches
+			for (uint32_t j = 0; j < num_objs; ++j) {
+				uint32_t i = obj_match[j];
+				if (obj_dist[j] == inf || i == UNMATCHED) {
+					continue;
+				}
+				int d = obj_dist[j] - match_cost(res_orig, i, j);
+				if (d < res_dist[i]) {
+					res_dist[i] = d;
+					changed = true;
+				}
+			}
 		}
 
-		if (match_obj_(st, skips, score + 1, replaced, i + 1)) {
-			is_best = true;
+		uint32_t best = UNMATCHED;
+		for (uint32_t j = 0; j < num_objs; ++j) {
+			if (obj_match[j] == UNMATCHED && obj_dist[j] != inf &&
+					(best == UNMATCHED || obj_dist[j] < obj_dist[best])) {
+				best = j;
+			}
 		}
-
-		if (st->exit_early) {
-			return true;
+		if (best == UNMATCHED) {
+			break;
 		}
-	}
 
-	if (is_best) {
-		return true;
+		// Flip the matches along the augmenting path
+		uint32_t j = best;
+		while (j != UNMATCHED) {
+			uint32_t i = obj_prev[j];
+			uint32_t next = out[i];
+			out[i] = j;
+			obj_match[j] = i;
+			j = next;
+		}
+		++score;
 	}
 
-	// Maybe this resource can't be matched
-	st->res[i] = UNMATCHED;
-	return match_obj_(st, skips, score, replaced, i + 1);
-}
-
-size_t match_obj(size_t num_objs, const uint32_t objs[static restrict num_objs],
-		size_t num_res, const uint32_t res[static restrict num_res],
-		uint32_t out[static restrict num_res]) {
-	uint32_t solution[num_res];
-
-	struct match_state st = {
-		.num_objs = num_objs,
-		.num_res = num_res,
-		.score = 0,
-		.replaced = SIZE_MAX,
-		.objs = objs,
-		.res = solution,
-		.best = out,
-		.orig = res,
-		.exit_early = false,
-	};
-
-	match_obj_(&st, 0, 0, 0, 0);
-	return st.score;
+	return score;
 }
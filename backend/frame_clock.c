@@ -0,0 +1,91 @@
+#define _POSIX_C_SOURCE 200112L
+#include <stdint.h>
+#include <time.h>
+#include <wayland-server.h>
+#include <wlr/interfaces/wlr_output.h>
+#include "backend/frame_clock.h"
+
+// Used until the refresh rate is known
+#define DEFAULT_REFRESH 60000 // mHz
+// Weight of a new sample in the measured refresh rate, as a power of two
+#define REFRESH_SMOOTHING_SHIFT 3
+
+static int64_t timespec_to_nsec(const struct timespec *t) {
+	return (int64_t)t->tv_sec * 1000000000 + t->tv_nsec;
+}
+
+static int handle_timer(void *data) {
+	struct frame_clock *clock = data;
+	frame_clock_frame(clock);
+	return 0;
+}
+
+void frame_clock_init(struct frame_clock *clock, struct wlr_output *output,
+		struct wl_event_loop *loop) {
+	clock->output = output;
+	clock->timer = wl_event_loop_add_timer(loop, handle_timer, clock);
+}
+
+void frame_clock_finish(struct frame_clock *clock) {
+	if (clock->timer) {
+		wl_event_source_remove(clock->timer);
+		clock->timer = NULL;
+	}
+}
+
+void frame_clock_present(struct frame_clock *clock,
+		const struct timespec *when, uint64_t seq, int32_t refresh) {
+	if (refresh == 0 && clock->has_present && seq > clock->last_seq) {
+		int64_t delta = timespec_to_nsec(when) -
+			timespec_to_nsec(&clock->last_present);
+		if (delta > 0) {
+			int32_t sample =
+				(int64_t)1000000000000 * (seq - clock->last_seq) / delta;
+			// Single intervals jitter, follow their moving average instead
+			if (clock->refresh > 0) {
+				refresh = clock->refresh +
+					(sample - clock->refresh) / (1 << REFRESH_SMOOTHING_SHIFT);
+			} else {
+				refresh = sample;
+			}
+		}
+	}
+
+	clock->last_present = *when;
+	clock->last_seq = seq;
+	clock->has_present = true;
+	if (refresh > 0) {
+		clock->refresh = refresh;
+	}
+
+	struct timespec present_time = *when;
+	wlr_output_send_present(clock->output, &present_time, seq, refresh);
+}
+
+void frame_clock_frame(struct frame_clock *clock) {
+	wl_event_source_timer_update(clock->timer, 0);
+	wlr_output_send_frame(clock->output);
+}
+
+void frame_clock_schedule(struct frame_clock *clock) {
+	int32_t refresh = clock->refresh > 0 ? clock->refresh : DEFAULT_REFRESH;
+	int64_t period = (int64_t)1000000000000 / refresh; // ns
+
+	struct timespec now_ts;
+	clock_gettime(CLOCK_MONOTONIC, &now_ts);
+	int64_t now = timespec_to_nsec(&now_ts);
+
+	int64_t next = now + period;
+	if (clock->has_present) {
+		int64_t last = timespec_to_nsec(&clock->last_present);
+		if (last <= now) {
+			next = last + ((now - last) / period + 1) * period;
+		}
+	}
+
+	int delay = (next - now + 999999) / 1000000; // ms, rounded up
+	if (delay < 1) {
+		delay = 1;
+	}
+	wl_event_source_timer_update(clock->timer, delay);
+}
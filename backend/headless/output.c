@@ -58,7 +58,25 @@ static bool output_make_current(struct wlr_output *wlr_output, int *buffer_age)
 
 static bool output_swap_buffers(struct wlr_output *wlr_output,
 		pixman_region32_t *damage) {
-	return true; // No-op
+	struct wlr_headless_output *output =
+		(struct wlr_headless_output *)wlr_output;
+	if (wlr_output->adaptive_sync) {
+		// The buffer is displayed right away, the next one can be once the
+		// minimum frame duration has elapsed
+		wl_event_source_timer_update(output->frame_timer, output->frame_delay);
+	}
+	return true;
+}
+
+static bool output_enable_adaptive_sync(struct wlr_output *wlr_output,
+		bool enabled) {
+	struct wlr_headless_output *output =
+		(struct wlr_headless_output *)wlr_output;
+	if (!enabled && output->backend->started) {
+		// Back to a fixed refresh cycle
+		wl_event_source_timer_update(output->frame_timer, output->frame_delay);
+	}
+	return true;
 }
 
 static void output_destroy(struct wlr_output *wlr_output) {
@@ -77,6 +95,7 @@ static const struct wlr_output_impl output_impl = {
 	.destroy = output_destroy,
 	.make_current = output_make_current,
 	.swap_buffers = output_swap_buffers,
+	.enable_adaptive_sync = output_enable_adaptive_sync,
 };
 
 bool wlr_output_is_headless(struct wlr_output *wlr_output) {
@@ -86,7 +105,9 @@ bool wlr_output_is_headless(struct wlr_output *wlr_output) {
 static int signal_frame(void *data) {
 	struct wlr_headless_output *output = data;
 	wlr_output_send_frame(&output->wlr_output);
-	wl_event_source_timer_update(output->frame_timer, output->frame_delay);
+	if (!output->wlr_output.adaptive_sync) {
+		wl_event_source_timer_update(output->frame_timer, output->frame_delay);
+	}
 	return 0;
 }
 
@@ -190,11 +190,39 @@ static void handle_device_removed(struct wlr_libinput_backend *backend,
 	free(wlr_devices);
 }
 
+static void flush_pointers(struct wlr_libinput_backend *backend, bool frame) {
+	for (size_t i = 0; i < backend->wlr_device_lists.length; i++) {
+		struct wl_list *wlr_devices = backend->wlr_device_lists.items[i];
+		struct wlr_input_device *wlr_dev;
+		wl_list_for_each(wlr_dev, wlr_devices, link) {
+			if (wlr_dev->type != WLR_INPUT_DEVICE_POINTER) {
+				continue;
+			}
+			struct wlr_libinput_input_device *dev =
+				(struct wlr_libinput_input_device *)wlr_dev;
+			if (frame) {
+				wlr_libinput_pointer_frame(dev);
+			} else {
+				wlr_libinput_pointer_flush(dev);
+			}
+		}
+	}
+}
+
+void wlr_libinput_frame(struct wlr_libinput_backend *backend) {
+	flush_pointers(backend, true);
+}
+
 void wlr_libinput_event(struct wlr_libinput_backend *backend,
 		struct libinput_event *event) {
 	assert(backend && event);
 	struct libinput_device *libinput_dev = libinput_event_get_device(event);
 	enum libinput_event_type event_type = libinput_event_get_type(event);
+	if (event_type != LIBINPUT_EVENT_POINTER_MOTION &&
+			event_type != LIBINPUT_EVENT_POINTER_AXIS) {
+		// Keep the ordering between merged events and everything else
+		flush_pointers(backend, false);
+	}
 	switch (event_type) {
 	case LIBINPUT_EVENT_DEVICE_ADDED:
 		handle_device_added(backend, libinput_dev);
@@ -1,6 +1,7 @@
 #include <assert.h>
 #include <libinput.h>
 #include <stdlib.h>
+#include <string.h>
 #include <wlr/backend/session.h>
 #include <wlr/interfaces/wlr_pointer.h>
 #include <wlr/types/wlr_input_device.h>
@@ -20,6 +21,33 @@ struct wlr_pointer *wlr_libinput_pointer_create(
 	return wlr_pointer;
 }
 
+void wlr_libinput_pointer_flush(struct wlr_libinput_input_device *dev) {
+	struct wlr_pointer *pointer = dev->wlr_input_device.pointer;
+	if (dev->pending.motion) {
+		dev->pending.motion = false;
+		dev->pending.frame = true;
+		wlr_signal_emit_safe(&pointer->events.motion,
+			&dev->pending.motion_event);
+	}
+	for (size_t i = 0; i < 2; ++i) {
+		if (dev->pending.axis[i]) {
+			dev->pending.axis[i] = false;
+			dev->pending.frame = true;
+			wlr_signal_emit_safe(&pointer->events.axis,
+				&dev->pending.axis_events[i]);
+		}
+	}
+}
+
+void wlr_libinput_pointer_frame(struct wlr_libinput_input_device *dev) {
+	wlr_libinput_pointer_flush(dev);
+	if (dev->pending.frame) {
+		dev->pending.frame = false;
+		struct wlr_pointer *pointer = dev->wlr_input_device.pointer;
+		wlr_signal_emit_safe(&pointer->events.frame, pointer);
+	}
+}
+
 void handle_pointer_motion(struct libinput_event *event,
 		struct libinput_device *libinput_dev) {
 	struct wlr_input_device *wlr_dev =
@@ -28,15 +56,27 @@ void handle_pointer_motion(struct libinput_event *event,
 		wlr_log(L_DEBUG, "Got a pointer event for a device with no pointers?");
 		return;
 	}
+	struct wlr_libinput_input_device *dev =
+		(struct wlr_libinput_input_device *)wlr_dev;
 	struct libinput_event_pointer *pevent =
 		libinput_event_get_pointer_event(event);
-	struct wlr_event_pointer_motion wlr_event = { 0 };
-	wlr_event.device = wlr_dev;
-	wlr_event.time_msec =
+
+	// Don't reorder motion and scrolling
+	if (dev->pending.axis[WLR_AXIS_ORIENTATION_VERTICAL] ||
+			dev->pending.axis[WLR_AXIS_ORIENTATION_HORIZONTAL]) {
+		wlr_libinput_pointer_flush(dev);
+	}
+
+	struct wlr_event_pointer_motion *wlr_event = &dev->pending.motion_event;
+	if (!dev->pending.motion) {
+		memset(wlr_event, 0, sizeof(*wlr_event));
+		wlr_event->device = wlr_dev;
+		dev->pending.motion = true;
+	}
+	wlr_event->time_msec =
 		usec_to_msec(libinput_event_pointer_get_time_usec(pevent));
-	wlr_event.delta_x = libinput_event_pointer_get_dx(pevent);
-	wlr_event.delta_y = libinput_event_pointer_get_dy(pevent);
-	wlr_signal_emit_safe(&wlr_dev->pointer->events.motion, &wlr_event);
+	wlr_event->delta_x += libinput_event_pointer_get_dx(pevent);
+	wlr_event->delta_y += libinput_event_pointer_get_dy(pevent);
 }
 
 void handle_pointer_motion_abs(struct libinput_event *event,
@@ -57,6 +97,7 @@ void handle_pointer_motion_abs(struct libinput_event *event,
 	wlr_event.y_mm = libinput_event_pointer_get_absolute_y(pevent);
 	libinput_device_get_size(libinput_dev, &wlr_event.width_mm, &wlr_event.height_mm);
 	wlr_signal_emit_safe(&wlr_dev->pointer->events.motion_absolute, &wlr_event);
+	((struct wlr_libinput_input_device *)wlr_dev)->pending.frame = true;
 }
 
 void handle_pointer_button(struct libinput_event *event,
@@ -83,6 +124,7 @@ void handle_pointer_button(struct libinput_event *event,
 		break;
 	}
 	wlr_signal_emit_safe(&wlr_dev->pointer->events.button, &wlr_event);
+	((struct wlr_libinput_input_device *)wlr_dev)->pending.frame = true;
 }
 
 void handle_pointer_axis(struct libinput_event *event,
@@ -93,6 +135,8 @@ void handle_pointer_axis(struct libinput_event *event,
 		wlr_log(L_DEBUG, "Got a pointer event for a device with no pointers?");
 		return;
 	}
+	struct wlr_libinput_input_device *dev =
+		(struct wlr_libinput_input_device *)wlr_dev;
 	struct libinput_event_pointer *pevent =
 		libinput_event_get_pointer_event(event);
 	struct wlr_event_pointer_axis wlr_event = { 0 };
@@ -113,6 +157,11 @@ void handle_pointer_axis(struct libinput_event *event,
 		wlr_event.source = WLR_AXIS_SOURCE_WHEEL_TILT;
 		break;
 	}
+
+	if (dev->pending.motion) {
+		wlr_libinput_pointer_flush(dev);
+	}
+
 	enum libinput_pointer_axis axies[] = {
 		LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL,
 		LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL,
@@ -129,7 +178,23 @@ void handle_pointer_axis(struct libinput_event *event,
 			}
 			wlr_event.delta = libinput_event_pointer_get_axis_value(
 					pevent, axies[i]);
-			wlr_signal_emit_safe(&wlr_dev->pointer->events.axis, &wlr_event);
+
+			// Merge with the previous event on this axis unless the source
+			// changed. A zero delta stops scrolling and is never merged.
+			struct wlr_event_pointer_axis *pending =
+				&dev->pending.axis_events[wlr_event.orientation];
+			bool *has_pending = &dev->pending.axis[wlr_event.orientation];
+			if (*has_pending && (pending->source != wlr_event.source ||
+					pending->delta == 0 || wlr_event.delta == 0)) {
+				wlr_libinput_pointer_flush(dev);
+			}
+			if (*has_pending) {
+				pending->time_msec = wlr_event.time_msec;
+				pending->delta += wlr_event.delta;
+			} else {
+				*pending = wlr_event;
+				*has_pending = true;
+			}
 		}
 	}
 }
@@ -0,0 +1,256 @@
+#define _POSIX_C_SOURCE 200112L
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wlr/interfaces/wlr_input_device.h>
+#include <wlr/util/log.h>
+#include "backend/replay.h"
+#include "util/input_record.h"
+#include "util/signal.h"
+
+static int64_t get_elapsed_usec(struct wlr_replay_backend *backend) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (int64_t)(now.tv_sec - backend->start.tv_sec) * 1000000 +
+		(now.tv_nsec - backend->start.tv_nsec) / 1000;
+}
+
+static void stop_replay(struct wlr_replay_backend *backend) {
+	backend->offset = backend->size;
+	wl_event_source_timer_update(backend->timer, 0);
+}
+
+/**
+ * Reads the record at the current offset, returns false at the end of the
+ * recording.
+ */
+static bool peek_record(struct wlr_replay_backend *backend,
+		struct input_record *record) {
+	if (backend->size - backend->offset < sizeof(*record)) {
+		return false;
+	}
+	memcpy(record, backend->data + backend->offset, sizeof(*record));
+	if (backend->size - backend->offset - sizeof(*record) < record->size) {
+		wlr_log(L_ERROR, "Truncated input recording");
+		return false;
+	}
+	return true;
+}
+
+static bool replay_record(struct wlr_replay_backend *backend,
+		const struct input_record *record, const uint8_t *payload) {
+	if (record->type == INPUT_RECORD_DEVICE_ADD) {
+		struct input_record_device device;
+		if (record->size < sizeof(device)) {
+			return false;
+		}
+		memcpy(&device, payload, sizeof(device));
+		size_t name_len = record->size - sizeof(device);
+		char name[name_len + 1];
+		memcpy(name, payload + sizeof(device), name_len);
+		name[name_len] = '\0';
+		replay_input_device_create(backend, record->device, device.type, name);
+		return true;
+	}
+
+	struct wlr_replay_input_device *device =
+		replay_input_device_from_id(backend, record->device);
+	if (device == NULL) {
+		wlr_log(L_DEBUG, "Skipping input record for unknown device %d",
+			record->device);
+		return true;
+	}
+
+	if (record->type == INPUT_RECORD_DEVICE_REMOVE) {
+		wlr_input_device_destroy(&device->wlr_input_device);
+		return true;
+	}
+	return replay_input_device_emit(device, record, payload);
+}
+
+static int handle_timer(void *data) {
+	struct wlr_replay_backend *backend = data;
+
+	int64_t elapsed = get_elapsed_usec(backend) * backend->speed;
+	struct input_record record;
+	while (peek_record(backend, &record)) {
+		if ((int64_t)record.time_usec > elapsed) {
+			int delay = (record.time_usec - elapsed) / backend->speed / 1000;
+			wl_event_source_timer_update(backend->timer, delay > 0 ? delay : 1);
+			return 0;
+		}
+
+		const uint8_t *payload = backend->data + backend->offset + sizeof(record);
+		backend->offset += sizeof(record) + record.size;
+		if (!replay_record(backend, &record, payload)) {
+			wlr_log(L_ERROR, "Invalid input record of type %d, stopping replay",
+				record.type);
+			stop_replay(backend);
+			return 0;
+		}
+	}
+
+	wlr_log(L_INFO, "Input replay finished");
+	stop_replay(backend);
+	return 0;
+}
+
+static bool backend_start(struct wlr_backend *wlr_backend) {
+	struct wlr_replay_backend *backend =
+		(struct wlr_replay_backend *)wlr_backend;
+	wlr_log(L_INFO, "Starting input replay at %.2fx speed", backend->speed);
+
+	struct wl_event_loop *loop = wl_display_get_event_loop(backend->display);
+	backend->timer = wl_event_loop_add_timer(loop, handle_timer, backend);
+	if (backend->timer == NULL) {
+		wlr_log(L_ERROR, "Failed to create replay timer");
+		return false;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &backend->start);
+	backend->started = true;
+	handle_timer(backend);
+	return true;
+}
+
+static void backend_destroy(struct wlr_backend *wlr_backend) {
+	struct wlr_replay_backend *backend =
+		(struct wlr_replay_backend *)wlr_backend;
+	if (!wlr_backend) {
+		return;
+	}
+
+	wl_list_remove(&backend->display_destroy.link);
+
+	struct wlr_replay_input_device *input_device, *input_device_tmp;
+	wl_list_for_each_safe(input_device, input_device_tmp,
+			&backend->input_devices, wlr_input_device.link) {
+		wlr_input_device_destroy(&input_device->wlr_input_device);
+	}
+
+	wlr_signal_emit_safe(&wlr_backend->events.destroy, backend);
+
+	if (backend->timer) {
+		wl_event_source_remove(backend->timer);
+	}
+	free(backend->data);
+	free(backend);
+}
+
+static const struct wlr_backend_impl backend_impl = {
+	.start = backend_start,
+	.destroy = backend_destroy,
+};
+
+bool wlr_backend_is_replay(struct wlr_backend *backend) {
+	return backend->impl == &backend_impl;
+}
+
+void wlr_replay_backend_set_speed(struct wlr_backend *wlr_backend,
+		double speed) {
+	assert(wlr_backend_is_replay(wlr_backend));
+	struct wlr_replay_backend *backend =
+		(struct wlr_replay_backend *)wlr_backend;
+	if (speed <= 0) {
+		wlr_log(L_ERROR, "Invalid replay speed %f, ignoring", speed);
+		return;
+	}
+	if (backend->started) {
+		// Keep the current position in the recording
+		int64_t shift = get_elapsed_usec(backend) * (1 - backend->speed / speed);
+		int64_t start = (int64_t)backend->start.tv_sec * 1000000 +
+			backend->start.tv_nsec / 1000 + shift;
+		backend->start.tv_sec = start / 1000000;
+		backend->start.tv_nsec = (start % 1000000) * 1000;
+	}
+	backend->speed = speed;
+	if (backend->started && backend->offset < backend->size) {
+		handle_timer(backend);
+	}
+}
+
+static bool read_recording(struct wlr_replay_backend *backend,
+		const char *path) {
+	FILE *f = fopen(path, "rb");
+	if (f == NULL) {
+		wlr_log_errno(L_ERROR, "Failed to open %s", path);
+		return false;
+	}
+
+	struct input_record_header header;
+	if (fread(&header, sizeof(header), 1, f) != 1 ||
+			memcmp(header.magic, INPUT_RECORD_MAGIC,
+				sizeof(header.magic)) != 0) {
+		wlr_log(L_ERROR, "%s is not an input recording", path);
+		goto error;
+	}
+	if (header.version != INPUT_RECORD_VERSION) {
+		wlr_log(L_ERROR, "Unsupported input recording version %d",
+			header.version);
+		goto error;
+	}
+
+	if (fseek(f, 0, SEEK_END) != 0) {
+		goto error_io;
+	}
+	long end = ftell(f);
+	if (end < (long)sizeof(header) ||
+			fseek(f, sizeof(header), SEEK_SET) != 0) {
+		goto error_io;
+	}
+
+	backend->size = end - sizeof(header);
+	backend->data = malloc(backend->size > 0 ? backend->size : 1);
+	if (backend->data == NULL) {
+		wlr_log(L_ERROR, "Allocation failed");
+		goto error;
+	}
+	if (backend->size > 0 &&
+			fread(backend->data, backend->size, 1, f) != 1) {
+		goto error_io;
+	}
+
+	fclose(f);
+	return true;
+
+error_io:
+	wlr_log_errno(L_ERROR, "Failed to read %s", path);
+error:
+	fclose(f);
+	return false;
+}
+
+static void handle_display_destroy(struct wl_listener *listener, void *data) {
+	struct wlr_replay_backend *backend =
+		wl_container_of(listener, backend, display_destroy);
+	backend_destroy(&backend->backend);
+}
+
+struct wlr_backend *wlr_replay_backend_create(struct wl_display *display,
+		const char *path) {
+	wlr_log(L_INFO, "Creating replay backend for %s", path);
+
+	struct wlr_replay_backend *backend =
+		calloc(1, sizeof(struct wlr_replay_backend));
+	if (!backend) {
+		wlr_log(L_ERROR, "Failed to allocate wlr_replay_backend");
+		return NULL;
+	}
+	wlr_backend_init(&backend->backend, &backend_impl);
+	backend->display = display;
+	backend->speed = 1.0;
+	wl_list_init(&backend->input_devices);
+
+	if (!read_recording(backend, path)) {
+		free(backend->data);
+		free(backend);
+		return NULL;
+	}
+
+	backend->display_destroy.notify = handle_display_destroy;
+	wl_display_add_destroy_listener(display, &backend->display_destroy);
+
+	return &backend->backend;
+}
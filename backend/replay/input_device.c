@@ -0,0 +1,397 @@
+#define _POSIX_C_SOURCE 200112L
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wlr/interfaces/wlr_input_device.h>
+#include <wlr/interfaces/wlr_keyboard.h>
+#include <wlr/interfaces/wlr_pointer.h>
+#include <wlr/interfaces/wlr_tablet_pad.h>
+#include <wlr/interfaces/wlr_tablet_tool.h>
+#include <wlr/interfaces/wlr_touch.h>
+#include <wlr/util/log.h>
+#include "backend/replay.h"
+#include "util/input_record.h"
+#include "util/signal.h"
+
+static void input_device_destroy(struct wlr_input_device *wlr_dev) {
+	struct wlr_replay_input_device *device =
+		(struct wlr_replay_input_device *)wlr_dev;
+	wl_list_remove(&wlr_dev->link);
+	free(device);
+}
+
+static struct wlr_input_device_impl input_device_impl = {
+	.destroy = input_device_destroy,
+};
+
+bool wlr_input_device_is_replay(struct wlr_input_device *wlr_dev) {
+	return wlr_dev->impl == &input_device_impl;
+}
+
+struct wlr_replay_input_device *replay_input_device_create(
+		struct wlr_replay_backend *backend, uint32_t id,
+		enum wlr_input_device_type type, const char *name) {
+	struct wlr_replay_input_device *device =
+		calloc(1, sizeof(struct wlr_replay_input_device));
+	if (device == NULL) {
+		wlr_log(L_ERROR, "Failed to allocate wlr_replay_input_device");
+		return NULL;
+	}
+	device->backend = backend;
+	device->id = id;
+
+	struct wlr_input_device *wlr_device = &device->wlr_input_device;
+	wlr_input_device_init(wlr_device, type, &input_device_impl, name, 0, 0);
+
+	switch (type) {
+	case WLR_INPUT_DEVICE_KEYBOARD:
+		wlr_device->keyboard = calloc(1, sizeof(struct wlr_keyboard));
+		if (wlr_device->keyboard == NULL) {
+			goto error_alloc;
+		}
+		wlr_keyboard_init(wlr_device->keyboard, NULL);
+		break;
+	case WLR_INPUT_DEVICE_POINTER:
+		wlr_device->pointer = calloc(1, sizeof(struct wlr_pointer));
+		if (wlr_device->pointer == NULL) {
+			goto error_alloc;
+		}
+		wlr_pointer_init(wlr_device->pointer, NULL);
+		break;
+	case WLR_INPUT_DEVICE_TOUCH:
+		wlr_device->touch = calloc(1, sizeof(struct wlr_touch));
+		if (wlr_device->touch == NULL) {
+			goto error_alloc;
+		}
+		wlr_touch_init(wlr_device->touch, NULL);
+		break;
+	case WLR_INPUT_DEVICE_TABLET_TOOL:
+		wlr_device->tablet_tool = calloc(1, sizeof(struct wlr_tablet_tool));
+		if (wlr_device->tablet_tool == NULL) {
+			goto error_alloc;
+		}
+		wlr_tablet_tool_init(wlr_device->tablet_tool, NULL);
+		break;
+	case WLR_INPUT_DEVICE_TABLET_PAD:
+		wlr_device->tablet_pad = calloc(1, sizeof(struct wlr_tablet_pad));
+		if (wlr_device->tablet_pad == NULL) {
+			goto error_alloc;
+		}
+		wlr_tablet_pad_init(wlr_device->tablet_pad, NULL);
+		break;
+	}
+
+	wl_list_insert(&backend->input_devices, &wlr_device->link);
+	wlr_signal_emit_safe(&backend->backend.events.new_input, wlr_device);
+	return device;
+
+error_alloc:
+	wlr_log(L_ERROR, "Failed to allocate replayed input device");
+	free(device);
+	return NULL;
+}
+
+struct wlr_replay_input_device *replay_input_device_from_id(
+		struct wlr_replay_backend *backend, uint32_t id) {
+	struct wlr_replay_input_device *device;
+	wl_list_for_each(device, &backend->input_devices, wlr_input_device.link) {
+		if (device->id == id) {
+			return device;
+		}
+	}
+	return NULL;
+}
+
+static uint32_t get_current_time_msec(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+bool replay_input_device_emit(struct wlr_replay_input_device *device,
+		const struct input_record *record, const void *payload) {
+	struct wlr_input_device *dev = &device->wlr_input_device;
+	uint32_t time_msec = get_current_time_msec();
+
+	// Payloads aren't aligned in the recording
+	union {
+		struct input_record_key key;
+		struct input_record_modifiers modifiers;
+		struct input_record_motion motion;
+		struct input_record_position position;
+		struct input_record_button button;
+		struct input_record_axis axis;
+		struct input_record_touch touch;
+		struct input_record_touch_id touch_id;
+		struct input_record_tool_axis tool_axis;
+		struct input_record_pad_axis pad_axis;
+	} p;
+	if (record->size > sizeof(p)) {
+		return false;
+	}
+	memcpy(&p, payload, record->size);
+
+	switch (record->type) {
+	case INPUT_RECORD_KEYBOARD_KEY: {
+		if (dev->type != WLR_INPUT_DEVICE_KEYBOARD ||
+				record->size != sizeof(p.key)) {
+			return false;
+		}
+		struct wlr_event_keyboard_key event = {
+			.time_msec = time_msec,
+			.keycode = p.key.keycode,
+			.update_state = p.key.update_state,
+			.state = p.key.state,
+		};
+		wlr_keyboard_notify_key(dev->keyboard, &event);
+		return true;
+	}
+	case INPUT_RECORD_KEYBOARD_MODIFIERS:
+		if (dev->type != WLR_INPUT_DEVICE_KEYBOARD ||
+				record->size != sizeof(p.modifiers)) {
+			return false;
+		}
+		wlr_keyboard_notify_modifiers(dev->keyboard, p.modifiers.depressed,
+			p.modifiers.latched, p.modifiers.locked, p.modifiers.group);
+		return true;
+	case INPUT_RECORD_POINTER_MOTION: {
+		if (dev->type != WLR_INPUT_DEVICE_POINTER ||
+				record->size != sizeof(p.motion)) {
+			return false;
+		}
+		struct wlr_event_pointer_motion event = {
+			.device = dev,
+			.time_msec = time_msec,
+			.delta_x = p.motion.delta_x,
+			.delta_y = p.motion.delta_y,
+		};
+		wlr_signal_emit_safe(&dev->pointer->events.motion, &event);
+		return true;
+	}
+	case INPUT_RECORD_POINTER_MOTION_ABSOLUTE: {
+		if (dev->type != WLR_INPUT_DEVICE_POINTER ||
+				record->size != sizeof(p.position)) {
+			return false;
+		}
+		struct wlr_event_pointer_motion_absolute event = {
+			.device = dev,
+			.time_msec = time_msec,
+			.x_mm = p.position.x_mm,
+			.y_mm = p.position.y_mm,
+			.width_mm = p.position.width_mm,
+			.height_mm = p.position.height_mm,
+		};
+		wlr_signal_emit_safe(&dev->pointer->events.motion_absolute, &event);
+		return true;
+	}
+	case INPUT_RECORD_POINTER_BUTTON: {
+		if (dev->type != WLR_INPUT_DEVICE_POINTER ||
+				record->size != sizeof(p.button)) {
+			return false;
+		}
+		struct wlr_event_pointer_button event = {
+			.device = dev,
+			.time_msec = time_msec,
+			.button = p.button.button,
+			.state = p.button.state,
+		};
+		wlr_signal_emit_safe(&dev->pointer->events.button, &event);
+		return true;
+	}
+	case INPUT_RECORD_POINTER_AXIS: {
+		if (dev->type != WLR_INPUT_DEVICE_POINTER ||
+				record->size != sizeof(p.axis)) {
+			return false;
+		}
+		struct wlr_event_pointer_axis event = {
+			.device = dev,
+			.time_msec = time_msec,
+			.source = p.axis.source,
+			.orientation = p.axis.orientation,
+			.delta = p.axis.delta,
+		};
+		wlr_signal_emit_safe(&dev->pointer->events.axis, &event);
+		return true;
+	}
+	case INPUT_RECORD_POINTER_FRAME:
+		if (dev->type != WLR_INPUT_DEVICE_POINTER || record->size != 0) {
+			return false;
+		}
+		wlr_signal_emit_safe(&dev->pointer->events.frame, dev->pointer);
+		return true;
+	case INPUT_RECORD_TOUCH_DOWN: {
+		if (dev->type != WLR_INPUT_DEVICE_TOUCH ||
+				record->size != sizeof(p.touch)) {
+			return false;
+		}
+		struct wlr_event_touch_down event = {
+			.device = dev,
+			.time_msec = time_msec,
+			.touch_id = p.touch.touch_id,
+			.x_mm = p.touch.x_mm,
+			.y_mm = p.touch.y_mm,
+			.width_mm = p.touch.width_mm,
+			.height_mm = p.touch.height_mm,
+		};
+		wlr_signal_emit_safe(&dev->touch->events.down, &event);
+		return true;
+	}
+	case INPUT_RECORD_TOUCH_UP: {
+		if (dev->type != WLR_INPUT_DEVICE_TOUCH ||
+				record->size != sizeof(p.touch_id)) {
+			return false;
+		}
+		struct wlr_event_touch_up event = {
+			.device = dev,
+			.time_msec = time_msec,
+			.touch_id = p.touch_id.touch_id,
+		};
+		wlr_signal_emit_safe(&dev->touch->events.up, &event);
+		return true;
+	}
+	case INPUT_RECORD_TOUCH_MOTION: {
+		if (dev->type != WLR_INPUT_DEVICE_TOUCH ||
+				record->size != sizeof(p.touch)) {
+			return false;
+		}
+		struct wlr_event_touch_motion event = {
+			.device = dev,
+			.time_msec = time_msec,
+			.touch_id = p.touch.touch_id,
+			.x_mm = p.touch.x_mm,
+			.y_mm = p.touch.y_mm,
+			.width_mm = p.touch.width_mm,
+			.height_mm = p.touch.height_mm,
+		};
+		wlr_signal_emit_safe(&dev->touch->events.motion, &event);
+		return true;
+	}
+	case INPUT_RECORD_TOUCH_CANCEL: {
+		if (dev->type != WLR_INPUT_DEVICE_TOUCH ||
+				record->size != sizeof(p.touch_id)) {
+			return false;
+		}
+		struct wlr_event_touch_cancel event = {
+			.device = dev,
+			.time_msec = time_msec,
+			.touch_id = p.touch_id.touch_id,
+		};
+		wlr_signal_emit_safe(&dev->touch->events.cancel, &event);
+		return true;
+	}
+	case INPUT_RECORD_TABLET_TOOL_AXIS: {
+		if (dev->type != WLR_INPUT_DEVICE_TABLET_TOOL ||
+				record->size != sizeof(p.tool_axis)) {
+			return false;
+		}
+		struct wlr_event_tablet_tool_axis event = {
+			.device = dev,
+			.time_msec = time_msec,
+			.updated_axes = p.tool_axis.updated_axes,
+			.x_mm = p.tool_axis.x_mm,
+			.y_mm = p.tool_axis.y_mm,
+			.width_mm = p.tool_axis.width_mm,
+			.height_mm = p.tool_axis.height_mm,
+			.pressure = p.tool_axis.pressure,
+			.distance = p.tool_axis.distance,
+			.tilt_x = p.tool_axis.tilt_x,
+			.tilt_y = p.tool_axis.tilt_y,
+			.rotation = p.tool_axis.rotation,
+			.slider = p.tool_axis.slider,
+			.wheel_delta = p.tool_axis.wheel_delta,
+		};
+		wlr_signal_emit_safe(&dev->tablet_tool->events.axis, &event);
+		return true;
+	}
+	case INPUT_RECORD_TABLET_TOOL_PROXIMITY: {
+		if (dev->type != WLR_INPUT_DEVICE_TABLET_TOOL ||
+				record->size != sizeof(p.position)) {
+			return false;
+		}
+		struct wlr_event_tablet_tool_proximity event = {
+			.device = dev,
+			.time_msec = time_msec,
+			.x_mm = p.position.x_mm,
+			.y_mm = p.position.y_mm,
+			.width_mm = p.position.width_mm,
+			.height_mm = p.position.height_mm,
+			.state = p.position.state,
+		};
+		wlr_signal_emit_safe(&dev->tablet_tool->events.proximity, &event);
+		return true;
+	}
+	case INPUT_RECORD_TABLET_TOOL_TIP: {
+		if (dev->type != WLR_INPUT_DEVICE_TABLET_TOOL ||
+				record->size != sizeof(p.position)) {
+			return false;
+		}
+		struct wlr_event_tablet_tool_tip event = {
+			.device = dev,
+			.time_msec = time_msec,
+			.x_mm = p.position.x_mm,
+			.y_mm = p.position.y_mm,
+			.width_mm = p.position.width_mm,
+			.height_mm = p.position.height_mm,
+			.state = p.position.state,
+		};
+		wlr_signal_emit_safe(&dev->tablet_tool->events.tip, &event);
+		return true;
+	}
+	case INPUT_RECORD_TABLET_TOOL_BUTTON: {
+		if (dev->type != WLR_INPUT_DEVICE_TABLET_TOOL ||
+				record->size != sizeof(p.button)) {
+			return false;
+		}
+		struct wlr_event_tablet_tool_button event = {
+			.device = dev,
+			.time_msec = time_msec,
+			.button = p.button.button,
+			.state = p.button.state,
+		};
+		wlr_signal_emit_safe(&dev->tablet_tool->events.button, &event);
+		return true;
+	}
+	case INPUT_RECORD_TABLET_PAD_BUTTON: {
+		if (dev->type != WLR_INPUT_DEVICE_TABLET_PAD ||
+				record->size != sizeof(p.button)) {
+			return false;
+		}
+		struct wlr_event_tablet_pad_button event = {
+			.time_msec = time_msec,
+			.button = p.button.button,
+			.state = p.button.state,
+		};
+		wlr_signal_emit_safe(&dev->tablet_pad->events.button, &event);
+		return true;
+	}
+	case INPUT_RECORD_TABLET_PAD_RING: {
+		if (dev->type != WLR_INPUT_DEVICE_TABLET_PAD ||
+				record->size != sizeof(p.pad_axis)) {
+			return false;
+		}
+		struct wlr_event_tablet_pad_ring event = {
+			.time_msec = time_msec,
+			.source = p.pad_axis.source,
+			.ring = p.pad_axis.index,
+			.position = p.pad_axis.position,
+		};
+		wlr_signal_emit_safe(&dev->tablet_pad->events.ring, &event);
+		return true;
+	}
+	case INPUT_RECORD_TABLET_PAD_STRIP: {
+		if (dev->type != WLR_INPUT_DEVICE_TABLET_PAD ||
+				record->size != sizeof(p.pad_axis)) {
+			return false;
+		}
+		struct wlr_event_tablet_pad_strip event = {
+			.time_msec = time_msec,
+			.source = p.pad_axis.source,
+			.strip = p.pad_axis.index,
+			.position = p.pad_axis.position,
+		};
+		wlr_signal_emit_safe(&dev->tablet_pad->events.strip, &event);
+		return true;
+	}
+	}
+	return false;
+}
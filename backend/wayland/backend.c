@@ -4,6 +4,7 @@
 #include <limits.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <wayland-server.h>
 #include <wlr/backend/interface.h>
 #include <wlr/interfaces/wlr_input_device.h>
@@ -13,6 +14,7 @@
 #include <wlr/util/log.h>
 #include "backend/wayland.h"
 #include "util/signal.h"
+#include "presentation-time-client-protocol.h"
 #include "xdg-shell-unstable-v6-client-protocol.h"
 
 static int dispatch_events(int fd, uint32_t mask, void *data) {
@@ -48,6 +50,10 @@ static bool wlr_wl_backend_start(struct wlr_backend *_backend) {
 		wlr_log_errno(L_ERROR, "Could not obtain retrieve required globals");
 		return false;
 	}
+	if (backend->shm_present && !backend->shm) {
+		wlr_log(L_ERROR, "Remote compositor doesn't support wl_shm");
+		return false;
+	}
 
 	backend->started = true;
 
@@ -95,6 +101,9 @@ static void wlr_wl_backend_destroy(struct wlr_backend *wlr_backend) {
 	if (backend->shm) {
 		wl_shm_destroy(backend->shm);
 	}
+	if (backend->presentation) {
+		wp_presentation_destroy(backend->presentation);
+	}
 	if (backend->shell) {
 		zxdg_shell_v6_destroy(backend->shell);
 	}
@@ -208,17 +217,54 @@ struct wlr_backend *wlr_wl_backend_create(struct wl_display *display, const char
 		return false;
 	}
 
-	wlr_egl_init(&backend->egl, EGL_PLATFORM_WAYLAND_EXT,
-		backend->remote_display, NULL, WL_SHM_FORMAT_ARGB8888);
+	bool egl_ok;
+	if (getenv("WLR_WL_SHM")) {
+		// Render into pbuffers and copy the damage into wl_shm buffers, so
+		// the remote compositor doesn't need to share buffers with our EGL
+		wlr_log(L_INFO, "WLR_WL_SHM set, presenting through wl_shm");
+		backend->shm_present = true;
+
+		static const EGLint config_attribs[] = {
+			EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+			EGL_ALPHA_SIZE, 0,
+			EGL_BLUE_SIZE, 8,
+			EGL_GREEN_SIZE, 8,
+			EGL_RED_SIZE, 8,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+			EGL_NONE,
+		};
+		egl_ok = wlr_egl_init(&backend->egl, EGL_PLATFORM_SURFACELESS_MESA,
+			NULL, (EGLint *)config_attribs, 0);
+		if (egl_ok) {
+			backend->shm_read_bgra = strstr(backend->egl.gl_exts_str,
+				"GL_EXT_read_format_bgra") != NULL;
+		}
+	} else {
+		egl_ok = wlr_egl_init(&backend->egl, EGL_PLATFORM_WAYLAND_EXT,
+			backend->remote_display, NULL, WL_SHM_FORMAT_ARGB8888);
+	}
+	if (!egl_ok) {
+		wlr_log(L_ERROR, "Could not initialize EGL");
+		goto error_registry;
+	}
 	wlr_egl_bind_display(&backend->egl, backend->local_display);
 
 	backend->renderer = wlr_gles2_renderer_create(&backend->backend);
 	if (backend->renderer == NULL) {
 		wlr_log_errno(L_ERROR, "Could not create renderer");
+		goto error_egl;
 	}
 
 	backend->local_display_destroy.notify = handle_display_destroy;
 	wl_display_add_destroy_listener(display, &backend->local_display_destroy);
 
 	return &backend->backend;
+
+error_egl:
+	wlr_egl_finish(&backend->egl);
+error_registry:
+	wl_registry_destroy(backend->registry);
+	wl_display_disconnect(backend->remote_display);
+	free(backend);
+	return NULL;
 }
@@ -1,16 +1,21 @@
+#define _POSIX_C_SOURCE 200112L
 #include <assert.h>
+#include <EGL/egl.h>
 #include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 #include <wayland-client.h>
 #include <wlr/interfaces/wlr_output.h>
 #include <wlr/util/log.h>
 #include "backend/wayland.h"
+#include "presentation-time-client-protocol.h"
 #include "util/signal.h"
 #include "xdg-shell-unstable-v6-client-protocol.h"
 
@@ -25,18 +30,285 @@ static void surface_frame_callback(void *data, struct wl_callback *cb,
 	wl_callback_destroy(cb);
 	output->frame_callback = NULL;
 
-	wlr_output_send_frame(&output->wlr_output);
+	frame_clock_frame(&output->frame_clock);
 }
 
 static struct wl_callback_listener frame_listener = {
 	.done = surface_frame_callback
 };
 
+static void presentation_feedback_destroy(
+		struct wlr_wl_backend_output *output) {
+	if (output->presentation_feedback) {
+		wp_presentation_feedback_destroy(output->presentation_feedback);
+		output->presentation_feedback = NULL;
+	}
+}
+
+static void presentation_feedback_handle_sync_output(void *data,
+		struct wp_presentation_feedback *feedback, struct wl_output *output) {
+	// This is a no-op
+}
+
+static void presentation_feedback_handle_presented(void *data,
+		struct wp_presentation_feedback *feedback, uint32_t tv_sec_hi,
+		uint32_t tv_sec_lo, uint32_t tv_nsec, uint32_t refresh_ns,
+		uint32_t seq_hi, uint32_t seq_lo, uint32_t flags) {
+	struct wlr_wl_backend_output *output = data;
+
+	struct timespec when = {
+		.tv_sec = ((uint64_t)tv_sec_hi << 32) | tv_sec_lo,
+		.tv_nsec = tv_nsec,
+	};
+	uint64_t seq = ((uint64_t)seq_hi << 32) | seq_lo;
+	int32_t refresh = 0;
+	if (refresh_ns != 0) {
+		refresh = (int64_t)1000000000000 / refresh_ns;
+	}
+	frame_clock_present(&output->frame_clock, &when, seq, refresh);
+
+	presentation_feedback_destroy(output);
+}
+
+static void presentation_feedback_handle_discarded(void *data,
+		struct wp_presentation_feedback *feedback) {
+	struct wlr_wl_backend_output *output = data;
+	presentation_feedback_destroy(output);
+}
+
+static const struct wp_presentation_feedback_listener
+		presentation_feedback_listener = {
+	.sync_output = presentation_feedback_handle_sync_output,
+	.presented = presentation_feedback_handle_presented,
+	.discarded = presentation_feedback_handle_discarded,
+};
+
+static void shm_buffer_handle_release(void *data, struct wl_buffer *wl_buffer) {
+	struct wlr_wl_shm_buffer *buffer = data;
+	buffer->busy = false;
+}
+
+static const struct wl_buffer_listener shm_buffer_listener = {
+	.release = shm_buffer_handle_release,
+};
+
+static bool shm_buffer_init(struct wlr_wl_shm_buffer *buffer,
+		struct wl_shm *shm, int32_t width, int32_t height) {
+	int32_t stride = width * 4;
+	size_t size = stride * height;
+
+	int fd = os_create_anonymous_file(size);
+	if (fd < 0) {
+		wlr_log_errno(L_ERROR, "creating anonymous file for shm buffer failed");
+		return false;
+	}
+
+	void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED) {
+		close(fd);
+		wlr_log_errno(L_ERROR, "mmap failed");
+		return false;
+	}
+
+	struct wl_shm_pool *pool = wl_shm_create_pool(shm, fd, size);
+	buffer->buffer = wl_shm_pool_create_buffer(pool, 0, width, height, stride,
+		WL_SHM_FORMAT_XRGB8888);
+	wl_shm_pool_destroy(pool);
+	close(fd);
+	wl_buffer_add_listener(buffer->buffer, &shm_buffer_listener, buffer);
+
+	buffer->data = data;
+	buffer->size = size;
+	buffer->width = width;
+	buffer->height = height;
+	buffer->stride = stride;
+	buffer->busy = false;
+	// The buffer doesn't hold anything yet
+	pixman_region32_init_rect(&buffer->damage, 0, 0, width, height);
+	return true;
+}
+
+static void shm_buffer_finish(struct wlr_wl_shm_buffer *buffer) {
+	if (buffer->buffer == NULL) {
+		return;
+	}
+	// The remote compositor keeps the contents of busy buffers around
+	wl_buffer_destroy(buffer->buffer);
+	munmap(buffer->data, buffer->size);
+	pixman_region32_fini(&buffer->damage);
+	memset(buffer, 0, sizeof(*buffer));
+}
+
+static struct wlr_wl_shm_buffer *output_get_shm_buffer(
+		struct wlr_wl_backend_output *output) {
+	struct wlr_output *wlr_output = &output->wlr_output;
+	struct wlr_wl_shm_buffer *empty = NULL;
+	for (size_t i = 0; i < WLR_WL_SHM_BUFFERS_LEN; ++i) {
+		struct wlr_wl_shm_buffer *buffer = &output->shm_buffers[i];
+		if (buffer->buffer == NULL) {
+			if (empty == NULL) {
+				empty = buffer;
+			}
+			continue;
+		}
+		if (!buffer->busy && buffer->width == wlr_output->width &&
+				buffer->height == wlr_output->height) {
+			return buffer;
+		}
+	}
+
+	if (empty == NULL ||
+			!shm_buffer_init(empty, output->backend->shm, wlr_output->width,
+				wlr_output->height)) {
+		return NULL;
+	}
+	return empty;
+}
+
+static bool output_create_pbuffer(struct wlr_wl_backend_output *output,
+		int32_t width, int32_t height) {
+	struct wlr_egl *egl = &output->backend->egl;
+	if (output->egl_surface) {
+		eglDestroySurface(egl->display, output->egl_surface);
+	}
+
+	EGLint attribs[] = {EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE};
+	output->egl_surface = eglCreatePbufferSurface(egl->display, egl->config,
+		attribs);
+	if (output->egl_surface == EGL_NO_SURFACE) {
+		wlr_log(L_ERROR, "Failed to create EGL surface: %s", egl_error());
+		return false;
+	}
+	return true;
+}
+
+static bool output_resize(struct wlr_wl_backend_output *output, int32_t width,
+		int32_t height) {
+	if (!output->backend->shm_present) {
+		wl_egl_window_resize(output->egl_window, width, height, 0, 0);
+		return true;
+	}
+
+	for (size_t i = 0; i < WLR_WL_SHM_BUFFERS_LEN; ++i) {
+		shm_buffer_finish(&output->shm_buffers[i]);
+	}
+	return output_create_pbuffer(output, width, height);
+}
+
+/**
+ * Copies the accumulated damage of the buffer out of the current pbuffer. The
+ * damage is in renderer coordinates, ie. upside down. Each rectangle is read
+ * at once, then flipped into the buffer.
+ */
+static void shm_buffer_read_pixels(struct wlr_wl_backend_output *output,
+		struct wlr_wl_shm_buffer *buffer) {
+	bool read_bgra = output->backend->shm_read_bgra;
+	GLenum format = read_bgra ? GL_BGRA_EXT : GL_RGBA;
+
+	int nrects;
+	pixman_box32_t *rects = pixman_region32_rectangles(&buffer->damage, &nrects);
+	for (int i = 0; i < nrects; ++i) {
+		int32_t width = rects[i].x2 - rects[i].x1;
+		int32_t height = rects[i].y2 - rects[i].y1;
+		size_t size = (size_t)width * height * 4;
+		if (size > output->shm_scratch_size) {
+			void *scratch = realloc(output->shm_scratch, size);
+			if (scratch == NULL) {
+				wlr_log(L_ERROR, "Allocation failed");
+				return;
+			}
+			output->shm_scratch = scratch;
+			output->shm_scratch_size = size;
+		}
+
+		// Rows are 4-byte aligned, the default GL_PACK_ALIGNMENT is fine
+		glReadPixels(rects[i].x1, rects[i].y1, width, height, format,
+			GL_UNSIGNED_BYTE, output->shm_scratch);
+
+		for (int32_t y = 0; y < height; ++y) {
+			const uint8_t *src =
+				(const uint8_t *)output->shm_scratch + (size_t)y * width * 4;
+			uint8_t *dst = (uint8_t *)buffer->data +
+				(buffer->height - rects[i].y1 - y - 1) * buffer->stride +
+				rects[i].x1 * 4;
+			if (read_bgra) {
+				memcpy(dst, src, width * 4);
+				continue;
+			}
+			for (int32_t x = 0; x < width; ++x) {
+				dst[4 * x] = src[4 * x + 2];
+				dst[4 * x + 1] = src[4 * x + 1];
+				dst[4 * x + 2] = src[4 * x];
+				dst[4 * x + 3] = src[4 * x + 3];
+			}
+		}
+	}
+
+	pixman_region32_clear(&buffer->damage);
+}
+
+static bool output_present_shm(struct wlr_wl_backend_output *output,
+		pixman_region32_t *damage) {
+	struct wlr_output *wlr_output = &output->wlr_output;
+	struct wlr_wl_backend *backend = output->backend;
+
+	struct wlr_wl_shm_buffer *buffer = output_get_shm_buffer(output);
+	if (buffer == NULL) {
+		wlr_log(L_ERROR, "No free shm buffer, skipping buffer swap");
+		return false;
+	}
+
+	pixman_region32_t frame_damage;
+	pixman_region32_init_rect(&frame_damage, 0, 0, wlr_output->width,
+		wlr_output->height);
+	if (damage != NULL) {
+		pixman_region32_intersect(&frame_damage, &frame_damage, damage);
+	}
+
+	for (size_t i = 0; i < WLR_WL_SHM_BUFFERS_LEN; ++i) {
+		struct wlr_wl_shm_buffer *b = &output->shm_buffers[i];
+		if (b->buffer != NULL) {
+			pixman_region32_union(&b->damage, &b->damage, &frame_damage);
+		}
+	}
+
+	shm_buffer_read_pixels(output, buffer);
+
+	wl_surface_attach(output->surface, buffer->buffer, 0, 0);
+	bool damage_buffer = wl_surface_get_version(output->surface) >=
+		WL_SURFACE_DAMAGE_BUFFER_SINCE_VERSION;
+	int nrects;
+	pixman_box32_t *rects = pixman_region32_rectangles(&frame_damage, &nrects);
+	for (int i = 0; i < nrects; ++i) {
+		// Flip back to buffer coordinates
+		int32_t x = rects[i].x1;
+		int32_t y = wlr_output->height - rects[i].y2;
+		int32_t width = rects[i].x2 - rects[i].x1;
+		int32_t height = rects[i].y2 - rects[i].y1;
+		if (damage_buffer) {
+			wl_surface_damage_buffer(output->surface, x, y, width, height);
+		} else {
+			// Buffer and surface coordinates match, we never set a scale or
+			// a transform on the remote surface
+			wl_surface_damage(output->surface, x, y, width, height);
+		}
+	}
+	pixman_region32_fini(&frame_damage);
+
+	buffer->busy = true;
+	wl_surface_commit(output->surface);
+	wl_display_flush(backend->remote_display);
+	return true;
+}
+
 static bool wlr_wl_output_set_custom_mode(struct wlr_output *_output,
 		int32_t width, int32_t height, int32_t refresh) {
 	struct wlr_wl_backend_output *output = (struct wlr_wl_backend_output *)_output;
-	wl_egl_window_resize(output->egl_window, width, height, 0, 0);
-	wlr_output_update_custom_mode(&output->wlr_output, width, height, 0);
+	if (!output_resize(output, width, height)) {
+		return false;
+	}
+	wlr_output_update_custom_mode(&output->wlr_output, width, height,
+		output->wlr_output.refresh);
 	return true;
 }
 
@@ -61,6 +333,20 @@ static bool wlr_wl_output_swap_buffers(struct wlr_output *wlr_output,
 	output->frame_callback = wl_surface_frame(output->surface);
 	wl_callback_add_listener(output->frame_callback, &frame_listener, output);
 
+	// Timestamps are reported as CLOCK_MONOTONIC, ignore other clocks
+	struct wlr_wl_backend *backend = output->backend;
+	if (backend->presentation &&
+			backend->presentation_clock == CLOCK_MONOTONIC) {
+		presentation_feedback_destroy(output);
+		output->presentation_feedback =
+			wp_presentation_feedback(backend->presentation, output->surface);
+		wp_presentation_feedback_add_listener(output->presentation_feedback,
+			&presentation_feedback_listener, output);
+	}
+
+	if (backend->shm_present) {
+		return output_present_shm(output, damage);
+	}
 	return wlr_egl_swap_buffers(&output->backend->egl, output->egl_surface,
 		damage);
 }
@@ -185,9 +471,19 @@ static void wlr_wl_output_destroy(struct wlr_output *wlr_output) {
 	if (output->frame_callback) {
 		wl_callback_destroy(output->frame_callback);
 	}
+	presentation_feedback_destroy(output);
+	frame_clock_finish(&output->frame_clock);
 
-	eglDestroySurface(output->backend->egl.display, output->surface);
-	wl_egl_window_destroy(output->egl_window);
+	for (size_t i = 0; i < WLR_WL_SHM_BUFFERS_LEN; ++i) {
+		shm_buffer_finish(&output->shm_buffers[i]);
+	}
+	free(output->shm_scratch);
+	if (output->egl_surface) {
+		eglDestroySurface(output->backend->egl.display, output->egl_surface);
+	}
+	if (output->egl_window) {
+		wl_egl_window_destroy(output->egl_window);
+	}
 	zxdg_toplevel_v6_destroy(output->xdg_toplevel);
 	zxdg_surface_v6_destroy(output->xdg_surface);
 	wl_surface_destroy(output->surface);
@@ -244,8 +540,12 @@ static void xdg_toplevel_handle_configure(void *data, struct zxdg_toplevel_v6 *x
 		return;
 	}
 	// loop over states for maximized etc?
-	wl_egl_window_resize(output->egl_window, width, height, 0, 0);
-	wlr_output_update_custom_mode(&output->wlr_output, width, height, 0);
+	if (!output_resize(output, width, height)) {
+		wlr_output_destroy(&output->wlr_output);
+		return;
+	}
+	wlr_output_update_custom_mode(&output->wlr_output, width, height,
+		output->wlr_output.refresh);
 }
 
 static void xdg_toplevel_handle_close(void *data, struct zxdg_toplevel_v6 *xdg_toplevel) {
@@ -284,6 +584,8 @@ struct wlr_output *wlr_wl_output_create(struct wlr_backend *_backend) {
 		wl_list_length(&backend->outputs) + 1);
 
 	output->backend = backend;
+	frame_clock_init(&output->frame_clock, wlr_output,
+		wl_display_get_event_loop(backend->local_display));
 
 	output->surface = wl_compositor_create_surface(backend->compositor);
 	if (!output->surface) {
@@ -311,9 +613,17 @@ struct wlr_output *wlr_wl_output_create(struct wlr_backend *_backend) {
 			&xdg_toplevel_listener, output);
 	wl_surface_commit(output->surface);
 
-	output->egl_window = wl_egl_window_create(output->surface,
-			wlr_output->width, wlr_output->height);
-	output->egl_surface = wlr_egl_create_surface(&backend->egl, output->egl_window);
+	if (backend->shm_present) {
+		if (!output_create_pbuffer(output, wlr_output->width,
+				wlr_output->height)) {
+			goto error;
+		}
+	} else {
+		output->egl_window = wl_egl_window_create(output->surface,
+				wlr_output->width, wlr_output->height);
+		output->egl_surface = wlr_egl_create_surface(&backend->egl,
+				output->egl_window);
+	}
 
 	wl_display_roundtrip(output->backend->remote_display);
 
@@ -332,7 +642,12 @@ struct wlr_output *wlr_wl_output_create(struct wlr_backend *_backend) {
 	output->frame_callback = wl_surface_frame(output->surface);
 	wl_callback_add_listener(output->frame_callback, &frame_listener, output);
 
-	if (!eglSwapBuffers(output->backend->egl.display, output->egl_surface)) {
+	if (backend->shm_present) {
+		if (!output_present_shm(output, NULL)) {
+			goto error;
+		}
+	} else if (!eglSwapBuffers(output->backend->egl.display,
+			output->egl_surface)) {
 		wlr_log(L_ERROR, "eglSwapBuffers failed: %s", egl_error());
 		goto error;
 	}
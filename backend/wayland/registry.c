@@ -4,6 +4,7 @@
 #include <wayland-client.h>
 #include <wlr/util/log.h>
 #include "backend/wayland.h"
+#include "presentation-time-client-protocol.h"
 #include "xdg-shell-unstable-v6-client-protocol.h"
 
 static void xdg_shell_handle_ping(void *data, struct zxdg_shell_v6 *shell,
@@ -15,6 +16,16 @@ static const struct zxdg_shell_v6_listener xdg_shell_listener = {
 	xdg_shell_handle_ping,
 };
 
+static void presentation_handle_clock_id(void *data,
+		struct wp_presentation *presentation, uint32_t clock_id) {
+	struct wlr_wl_backend *backend = data;
+	backend->presentation_clock = clock_id;
+}
+
+static const struct wp_presentation_listener presentation_listener = {
+	.clock_id = presentation_handle_clock_id,
+};
+
 
 static void registry_global(void *data, struct wl_registry *registry,
 		uint32_t name, const char *interface, uint32_t version) {
@@ -31,6 +42,11 @@ static void registry_global(void *data, struct wl_registry *registry,
 	} else if (strcmp(interface, wl_shm_interface.name) == 0) {
 		backend->shm = wl_registry_bind(registry, name,
 				&wl_shm_interface, version);
+	} else if (strcmp(interface, wp_presentation_interface.name) == 0) {
+		backend->presentation = wl_registry_bind(registry, name,
+				&wp_presentation_interface, 1);
+		wp_presentation_add_listener(backend->presentation,
+				&presentation_listener, backend);
 	} else if (strcmp(interface, wl_seat_interface.name) == 0) {
 		backend->seat = wl_registry_bind(registry, name,
 				&wl_seat_interface, version);
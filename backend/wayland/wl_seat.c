@@ -111,7 +111,9 @@ static void pointer_handle_axis(void *data, struct wl_pointer *wl_pointer,
 }
 
 static void pointer_handle_frame(void *data, struct wl_pointer *wl_pointer) {
-
+	struct wlr_input_device *dev = data;
+	assert(dev && dev->pointer);
+	wlr_signal_emit_safe(&dev->pointer->events.frame, dev->pointer);
 }
 
 static void pointer_handle_axis_source(void *data, struct wl_pointer *wl_pointer,
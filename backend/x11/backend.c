@@ -1,12 +1,12 @@
 #define _POSIX_C_SOURCE 200112L
 #include <EGL/egl.h>
 #include <stdbool.h>
-#include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 #include <wayland-server.h>
 #include <wlr/backend/interface.h>
 #include <wlr/backend/x11.h>
+#include <wlr/config.h>
 #include <wlr/interfaces/wlr_input_device.h>
 #include <wlr/interfaces/wlr_keyboard.h>
 #include <wlr/interfaces/wlr_output.h>
@@ -15,8 +15,11 @@
 #include <wlr/render/gles2.h>
 #include <wlr/util/log.h>
 #include <X11/Xlib-xcb.h>
-#include <xcb/glx.h>
+#include <xcb/render.h>
 #include <xcb/xcb.h>
+#ifdef WLR_HAS_XCB_PRESENT
+#include <xcb/present.h>
+#endif
 #ifdef __linux__
 #include <linux/input-event-codes.h>
 #elif __FreeBSD__
@@ -26,7 +29,6 @@
 #include "util/signal.h"
 
 static struct wlr_backend_impl backend_impl;
-static struct wlr_output_impl output_impl;
 static struct wlr_input_device_impl input_device_impl = { 0 };
 
 static uint32_t xcb_button_to_wl(uint32_t button) {
@@ -41,12 +43,55 @@ static uint32_t xcb_button_to_wl(uint32_t button) {
 	}
 }
 
-static bool handle_x11_event(struct wlr_x11_backend *x11, xcb_generic_event_t *event) {
-	struct wlr_x11_output *output = &x11->output;
+static void send_pointer_position(struct wlr_x11_output *output,
+		int16_t x, int16_t y, xcb_timestamp_t time) {
+	struct wlr_x11_backend *x11 = output->x11;
+	struct wlr_output *wlr_output = &output->wlr_output;
+
+	struct wlr_box layout_box;
+	wlr_x11_output_layout_get_box(x11, &layout_box);
+
+	struct wlr_event_pointer_motion_absolute abs = {
+		.device = &x11->pointer_dev,
+		.time_msec = time,
+		.x_mm = x / wlr_output->scale + wlr_output->lx - layout_box.x,
+		.y_mm = y / wlr_output->scale + wlr_output->ly - layout_box.y,
+		.width_mm = layout_box.width,
+		.height_mm = layout_box.height,
+	};
+
+	wlr_signal_emit_safe(&x11->pointer.events.motion_absolute, &abs);
+}
 
-	switch (event->response_type) {
+#ifdef WLR_HAS_XCB_PRESENT
+static void handle_present_complete(struct wlr_x11_backend *x11,
+		xcb_present_complete_notify_event_t *ev) {
+	struct wlr_x11_output *output = wlr_x11_output_for_window(x11, ev->window);
+	if (!output || ev->kind != XCB_PRESENT_COMPLETE_KIND_NOTIFY_MSC) {
+		return;
+	}
+
+	// ust is the CLOCK_MONOTONIC time of the vblank, in microseconds
+	struct timespec when = {
+		.tv_sec = ev->ust / 1000000,
+		.tv_nsec = (ev->ust % 1000000) * 1000,
+	};
+	frame_clock_present(&output->frame_clock, &when, ev->msc, 0);
+	frame_clock_frame(&output->frame_clock);
+}
+#endif
+
+static bool handle_x11_event(struct wlr_x11_backend *x11, xcb_generic_event_t *event) {
+	// The high bit is set for events sent by other clients
+	uint8_t type = event->response_type & 0x7f;
+	switch (type) {
 	case XCB_EXPOSE: {
-		wlr_output_send_frame(&output->wlr_output);
+		xcb_expose_event_t *ev = (xcb_expose_event_t *)event;
+		struct wlr_x11_output *output =
+			wlr_x11_output_for_window(x11, ev->window);
+		if (output) {
+			frame_clock_frame(&output->frame_clock);
+		}
 		break;
 	}
 	case XCB_KEY_PRESS:
@@ -55,7 +100,7 @@ static bool handle_x11_event(struct wlr_x11_backend *x11, xcb_generic_event_t *e
 		struct wlr_event_keyboard_key key = {
 			.time_msec = ev->time,
 			.keycode = ev->detail - 8,
-			.state = event->response_type == XCB_KEY_PRESS ?
+			.state = type == XCB_KEY_PRESS ?
 				WLR_KEY_PRESSED : WLR_KEY_RELEASED,
 			.update_state = true,
 		};
@@ -93,7 +138,7 @@ static bool handle_x11_event(struct wlr_x11_backend *x11, xcb_generic_event_t *e
 				.device = &x11->pointer_dev,
 				.time_msec = ev->time,
 				.button = xcb_button_to_wl(ev->detail),
-				.state = event->response_type == XCB_BUTTON_PRESS ?
+				.state = type == XCB_BUTTON_PRESS ?
 					WLR_BUTTON_PRESSED : WLR_BUTTON_RELEASED,
 			};
 
@@ -104,24 +149,27 @@ static bool handle_x11_event(struct wlr_x11_backend *x11, xcb_generic_event_t *e
 	}
 	case XCB_MOTION_NOTIFY: {
 		xcb_motion_notify_event_t *ev = (xcb_motion_notify_event_t *)event;
-		struct wlr_event_pointer_motion_absolute abs = {
-			.device = &x11->pointer_dev,
-			.time_msec = ev->time,
-			.x_mm = ev->event_x,
-			.y_mm = ev->event_y,
-			.width_mm = output->wlr_output.width,
-			.height_mm = output->wlr_output.height,
-		};
-
-		wlr_signal_emit_safe(&x11->pointer.events.motion_absolute, &abs);
+		struct wlr_x11_output *output =
+			wlr_x11_output_for_window(x11, ev->event);
+		if (output) {
+			send_pointer_position(output, ev->event_x, ev->event_y, ev->time);
+		}
 		x11->time = ev->time;
 		break;
 	}
 	case XCB_CONFIGURE_NOTIFY: {
 		xcb_configure_notify_event_t *ev = (xcb_configure_notify_event_t *)event;
+		struct wlr_x11_output *output =
+			wlr_x11_output_for_window(x11, ev->window);
+		if (!output) {
+			break;
+		}
 
-		wlr_output_update_custom_mode(&output->wlr_output, ev->width,
-			ev->height, 0);
+		if (ev->width != output->wlr_output.width ||
+				ev->height != output->wlr_output.height) {
+			wlr_output_update_custom_mode(&output->wlr_output, ev->width,
+				ev->height, output->wlr_output.refresh);
+		}
 
 		// Move the pointer to its new location
 		xcb_query_pointer_cookie_t cookie =
@@ -132,21 +180,40 @@ static bool handle_x11_event(struct wlr_x11_backend *x11, xcb_generic_event_t *e
 			break;
 		}
 
-		struct wlr_event_pointer_motion_absolute abs = {
-			.device = &x11->pointer_dev,
-			.time_msec = x11->time,
-			.x_mm = pointer->root_x,
-			.y_mm = pointer->root_y,
-			.width_mm = output->wlr_output.width,
-			.height_mm = output->wlr_output.height,
-		};
+		if (pointer->same_screen) {
+			send_pointer_position(output, pointer->win_x, pointer->win_y,
+				x11->time);
+		}
+		free(pointer);
+		break;
+	}
+	case XCB_CLIENT_MESSAGE: {
+		xcb_client_message_event_t *ev = (xcb_client_message_event_t *)event;
+		if (ev->data.data32[0] != x11->atoms.wm_delete_window.reply->atom) {
+			break;
+		}
 
-		wlr_signal_emit_safe(&x11->pointer.events.motion_absolute, &abs);
+		struct wlr_x11_output *output =
+			wlr_x11_output_for_window(x11, ev->window);
+		if (output) {
+			wlr_output_destroy(&output->wlr_output);
+		}
+		if (wl_list_empty(&x11->outputs)) {
+			wl_display_terminate(x11->wl_display);
+			return true;
+		}
 		break;
 	}
-	case XCB_GLX_DELETE_QUERIES_ARB: {
-		wl_display_terminate(x11->wl_display);
-		return true;
+	case XCB_GE_GENERIC: {
+#ifdef WLR_HAS_XCB_PRESENT
+		xcb_ge_generic_event_t *ev = (xcb_ge_generic_event_t *)event;
+		if (x11->present_opcode != 0 &&
+				ev->extension == x11->present_opcode &&
+				ev->event_type == XCB_PRESENT_COMPLETE_NOTIFY) {
+			handle_present_complete(x11,
+				(xcb_present_complete_notify_event_t *)event);
+		}
+#endif
 		break;
 	}
 	default:
@@ -174,13 +241,6 @@ static int x11_event(int fd, uint32_t mask, void *data) {
 	return 0;
 }
 
-static int signal_frame(void *data) {
-	struct wlr_x11_backend *x11 = data;
-	wlr_output_send_frame(&x11->output.wlr_output);
-	wl_event_source_timer_update(x11->frame_timer, 16);
-	return 0;
-}
-
 static void init_atom(struct wlr_x11_backend *x11, struct wlr_x11_atom *atom,
 		uint8_t only_if_exists, const char *name) {
 	atom->cookie = xcb_intern_atom(x11->xcb_conn, only_if_exists, strlen(name),
@@ -188,63 +248,68 @@ static void init_atom(struct wlr_x11_backend *x11, struct wlr_x11_atom *atom,
 	atom->reply = xcb_intern_atom_reply(x11->xcb_conn, atom->cookie, NULL);
 }
 
-static bool wlr_x11_backend_start(struct wlr_backend *backend) {
-	struct wlr_x11_backend *x11 = (struct wlr_x11_backend *)backend;
-	struct wlr_x11_output *output = &x11->output;
-
-	uint32_t mask = XCB_CW_BACK_PIXEL | XCB_CW_EVENT_MASK;
-	uint32_t values[2] = {
-		x11->screen->white_pixel,
-		XCB_EVENT_MASK_EXPOSURE |
-		XCB_EVENT_MASK_KEY_PRESS | XCB_EVENT_MASK_KEY_RELEASE |
-		XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_BUTTON_RELEASE |
-		XCB_EVENT_MASK_POINTER_MOTION |
-		XCB_EVENT_MASK_STRUCTURE_NOTIFY
-	};
+static xcb_render_pictformat_t find_argb32_format(xcb_connection_t *conn) {
+	xcb_render_query_version_cookie_t version_cookie =
+		xcb_render_query_version(conn, XCB_RENDER_MAJOR_VERSION,
+			XCB_RENDER_MINOR_VERSION);
+	xcb_render_query_version_reply_t *version =
+		xcb_render_query_version_reply(conn, version_cookie, NULL);
+	if (!version) {
+		return 0;
+	}
+	// Cursors need Render 0.5
+	bool has_cursors = version->major_version > 0 ||
+		version->minor_version >= 5;
+	free(version);
+	if (!has_cursors) {
+		return 0;
+	}
 
-	output->x11 = x11;
+	xcb_render_query_pict_formats_cookie_t formats_cookie =
+		xcb_render_query_pict_formats(conn);
+	xcb_render_query_pict_formats_reply_t *formats =
+		xcb_render_query_pict_formats_reply(conn, formats_cookie, NULL);
+	if (!formats) {
+		return 0;
+	}
 
-	wlr_output_init(&output->wlr_output, &x11->backend, &output_impl,
-		x11->wl_display);
-	snprintf(output->wlr_output.name, sizeof(output->wlr_output.name), "X11-1");
+	xcb_render_pictformat_t id = 0;
+	xcb_render_pictforminfo_iterator_t iter =
+		xcb_render_query_pict_formats_formats_iterator(formats);
+	for (; iter.rem > 0; xcb_render_pictforminfo_next(&iter)) {
+		xcb_render_pictforminfo_t *format = iter.data;
+		xcb_render_directformat_t *direct = &format->direct;
+		if (format->type == XCB_RENDER_PICT_TYPE_DIRECT &&
+				format->depth == 32 &&
+				direct->alpha_shift == 24 && direct->alpha_mask == 0xff &&
+				direct->red_shift == 16 && direct->red_mask == 0xff &&
+				direct->green_shift == 8 && direct->green_mask == 0xff &&
+				direct->blue_shift == 0 && direct->blue_mask == 0xff) {
+			id = format->id;
+			break;
+		}
+	}
 
-	output->win = xcb_generate_id(x11->xcb_conn);
-	xcb_create_window(x11->xcb_conn, XCB_COPY_FROM_PARENT, output->win,
-		x11->screen->root, 0, 0, 1024, 768, 1, XCB_WINDOW_CLASS_INPUT_OUTPUT,
-		x11->screen->root_visual, mask, values);
+	free(formats);
+	return id;
+}
 
-	output->surf = wlr_egl_create_surface(&x11->egl, &output->win);
-	if (!output->surf) {
-		wlr_log(L_ERROR, "Failed to create EGL surface");
-		return false;
-	}
+static bool wlr_x11_backend_start(struct wlr_backend *backend) {
+	struct wlr_x11_backend *x11 = (struct wlr_x11_backend *)backend;
 
 	init_atom(x11, &x11->atoms.wm_protocols, 1, "WM_PROTOCOLS");
 	init_atom(x11, &x11->atoms.wm_delete_window, 0, "WM_DELETE_WINDOW");
 	init_atom(x11, &x11->atoms.net_wm_name, 1, "_NET_WM_NAME");
 	init_atom(x11, &x11->atoms.utf8_string, 0, "UTF8_STRING");
 
-	xcb_change_property(x11->xcb_conn, XCB_PROP_MODE_REPLACE, output->win,
-		x11->atoms.wm_protocols.reply->atom, XCB_ATOM_ATOM, 32, 1,
-		&x11->atoms.wm_delete_window.reply->atom);
-
-	char title[32];
-	if (snprintf(title, sizeof(title), "wlroots - %s", output->wlr_output.name)) {
-		xcb_change_property(x11->xcb_conn, XCB_PROP_MODE_REPLACE, output->win,
-			x11->atoms.net_wm_name.reply->atom,
-			x11->atoms.utf8_string.reply->atom, 8,
-			strlen(title), title);
-	}
-
-	xcb_map_window(x11->xcb_conn, output->win);
-	xcb_flush(x11->xcb_conn);
-	wlr_output_update_enabled(&output->wlr_output, true);
+	x11->started = true;
 
-	wlr_signal_emit_safe(&x11->backend.events.new_output, output);
 	wlr_signal_emit_safe(&x11->backend.events.new_input, &x11->keyboard_dev);
 	wlr_signal_emit_safe(&x11->backend.events.new_input, &x11->pointer_dev);
 
-	wl_event_source_timer_update(x11->frame_timer, 16);
+	for (size_t i = 0; i < x11->requested_outputs; ++i) {
+		wlr_x11_output_create(&x11->backend);
+	}
 
 	return true;
 }
@@ -256,8 +321,10 @@ static void wlr_x11_backend_destroy(struct wlr_backend *backend) {
 
 	struct wlr_x11_backend *x11 = (struct wlr_x11_backend *)backend;
 
-	struct wlr_x11_output *output = &x11->output;
-	wlr_output_destroy(&output->wlr_output);
+	struct wlr_x11_output *output, *tmp_output;
+	wl_list_for_each_safe(output, tmp_output, &x11->outputs, link) {
+		wlr_output_destroy(&output->wlr_output);
+	}
 
 	wlr_signal_emit_safe(&x11->pointer_dev.events.destroy, &x11->pointer_dev);
 	wlr_signal_emit_safe(&x11->keyboard_dev.events.destroy, &x11->keyboard_dev);
@@ -270,11 +337,12 @@ static void wlr_x11_backend_destroy(struct wlr_backend *backend) {
 		xkb_state_unref(x11->keyboard_dev.keyboard->xkb_state);
 	}
 
+	wlr_x11_cursor_cache_finish(x11);
+
 	wlr_signal_emit_safe(&backend->events.destroy, backend);
 
 	wl_list_remove(&x11->display_destroy.link);
 
-	wl_event_source_remove(x11->frame_timer);
 	wlr_egl_finish(&x11->egl);
 
 	xcb_disconnect(x11->xcb_conn);
@@ -318,6 +386,7 @@ struct wlr_backend *wlr_x11_backend_create(struct wl_display *display,
 
 	wlr_backend_init(&x11->backend, &backend_impl);
 	x11->wl_display = display;
+	wl_list_init(&x11->outputs);
 
 	x11->xlib_conn = XOpenDisplay(x11_display);
 	if (!x11->xlib_conn) {
@@ -342,10 +411,35 @@ struct wlr_backend *wlr_x11_backend_create(struct wl_display *display,
 		goto error_x11;
 	}
 
-	x11->frame_timer = wl_event_loop_add_timer(ev, signal_frame, x11);
-
 	x11->screen = xcb_setup_roots_iterator(xcb_get_setup(x11->xcb_conn)).data;
 
+	wl_list_init(&x11->cursors);
+	x11->argb32 = find_argb32_format(x11->xcb_conn);
+	if (x11->argb32 == 0) {
+		wlr_log(L_INFO, "Render extension can't create cursors, "
+			"falling back to software cursors");
+	}
+
+#ifdef WLR_HAS_XCB_PRESENT
+	const xcb_query_extension_reply_t *present_ext =
+		xcb_get_extension_data(x11->xcb_conn, &xcb_present_id);
+	if (present_ext && present_ext->present) {
+		xcb_present_query_version_cookie_t cookie =
+			xcb_present_query_version(x11->xcb_conn,
+				XCB_PRESENT_MAJOR_VERSION, XCB_PRESENT_MINOR_VERSION);
+		xcb_present_query_version_reply_t *reply =
+			xcb_present_query_version_reply(x11->xcb_conn, cookie, NULL);
+		if (reply) {
+			x11->present_opcode = present_ext->major_opcode;
+			free(reply);
+		}
+	}
+#endif
+	if (x11->present_opcode == 0) {
+		wlr_log(L_INFO, "Present extension not available, "
+			"frames won't follow the X server refresh cycle");
+	}
+
 	if (!wlr_egl_init(&x11->egl, EGL_PLATFORM_X11_KHR, x11->xlib_conn, NULL,
 			x11->screen->root_visual)) {
 		goto error_event;
@@ -380,58 +474,6 @@ error_x11:
 	return NULL;
 }
 
-static bool output_set_custom_mode(struct wlr_output *wlr_output, int32_t width,
-		int32_t height, int32_t refresh) {
-	struct wlr_x11_output *output = (struct wlr_x11_output *)wlr_output;
-	struct wlr_x11_backend *x11 = output->x11;
-
-	const uint32_t values[] = { width, height };
-	xcb_configure_window(x11->xcb_conn, output->win,
-		XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT, values);
-	return true;
-}
-
-static void output_transform(struct wlr_output *wlr_output, enum wl_output_transform transform) {
-	struct wlr_x11_output *output = (struct wlr_x11_output *)wlr_output;
-	output->wlr_output.transform = transform;
-}
-
-static void output_destroy(struct wlr_output *wlr_output) {
-	struct wlr_x11_output *output = (struct wlr_x11_output *)wlr_output;
-	struct wlr_x11_backend *x11 = output->x11;
-
-	eglDestroySurface(x11->egl.display, output->surf);
-	xcb_destroy_window(x11->xcb_conn, output->win);
-	// output has been allocated on the stack, do not free it
-}
-
-static bool output_make_current(struct wlr_output *wlr_output, int *buffer_age) {
-	struct wlr_x11_output *output = (struct wlr_x11_output *)wlr_output;
-	struct wlr_x11_backend *x11 = output->x11;
-
-	return wlr_egl_make_current(&x11->egl, output->surf, buffer_age);
-}
-
-static bool output_swap_buffers(struct wlr_output *wlr_output,
-		pixman_region32_t *damage) {
-	struct wlr_x11_output *output = (struct wlr_x11_output *)wlr_output;
-	struct wlr_x11_backend *x11 = output->x11;
-
-	return wlr_egl_swap_buffers(&x11->egl, output->surf, damage);
-}
-
-static struct wlr_output_impl output_impl = {
-	.set_custom_mode = output_set_custom_mode,
-	.transform = output_transform,
-	.destroy = output_destroy,
-	.make_current = output_make_current,
-	.swap_buffers = output_swap_buffers,
-};
-
-bool wlr_output_is_x11(struct wlr_output *wlr_output) {
-	return wlr_output->impl == &output_impl;
-}
-
 bool wlr_input_device_is_x11(struct wlr_input_device *wlr_dev) {
 	return wlr_dev->impl == &input_device_impl;
 }
@@ -0,0 +1,504 @@
+#define _POSIX_C_SOURCE 200112L
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wayland-server.h>
+#include <wlr/backend/x11.h>
+#include <wlr/config.h>
+#include <wlr/interfaces/wlr_output.h>
+#include <wlr/render/egl.h>
+#include <wlr/types/wlr_box.h>
+#include <wlr/util/log.h>
+#include <xcb/render.h>
+#include <xcb/xcb.h>
+#ifdef WLR_HAS_XCB_PRESENT
+#include <xcb/present.h>
+#endif
+#include "backend/x11.h"
+#include "util/signal.h"
+
+static struct wlr_output_impl output_impl;
+
+static uint64_t hash_pixels(const uint8_t *buf, int32_t stride,
+		uint32_t width, uint32_t height) {
+	// FNV-1a
+	uint64_t hash = 0xcbf29ce484222325;
+	for (uint32_t y = 0; y < height; ++y) {
+		const uint8_t *row = buf + (size_t)y * stride * 4;
+		for (uint32_t i = 0; i < width * 4; ++i) {
+			hash ^= row[i];
+			hash *= 0x100000001b3;
+		}
+	}
+	return hash;
+}
+
+static void x11_cursor_destroy(struct wlr_x11_backend *x11,
+		struct wlr_x11_cursor *cursor) {
+	if (cursor->cursor) {
+		xcb_free_cursor(x11->xcb_conn, cursor->cursor);
+	}
+	xcb_render_free_picture(x11->xcb_conn, cursor->picture);
+	wl_list_remove(&cursor->link);
+	free(cursor->pixels);
+	free(cursor);
+}
+
+static bool x11_cursor_matches(struct wlr_x11_cursor *cursor, uint64_t hash,
+		const uint8_t *buf, int32_t stride, uint32_t width, uint32_t height) {
+	if (cursor->hash != hash || cursor->width != width ||
+			cursor->height != height) {
+		return false;
+	}
+	for (uint32_t y = 0; y < height; ++y) {
+		if (memcmp(cursor->pixels + (size_t)y * width,
+				buf + (size_t)y * stride * 4, width * 4) != 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static struct wlr_x11_cursor *x11_cursor_upload(struct wlr_x11_backend *x11,
+		const uint8_t *buf, int32_t stride, uint32_t width, uint32_t height,
+		uint64_t hash) {
+	struct wlr_x11_cursor *cursor = calloc(1, sizeof(struct wlr_x11_cursor));
+	if (!cursor) {
+		wlr_log(L_ERROR, "Allocation failed");
+		return NULL;
+	}
+	cursor->hash = hash;
+	cursor->width = width;
+	cursor->height = height;
+	cursor->pixels = malloc((size_t)width * height * 4);
+	if (!cursor->pixels) {
+		wlr_log(L_ERROR, "Allocation failed");
+		free(cursor);
+		return NULL;
+	}
+	for (uint32_t y = 0; y < height; ++y) {
+		memcpy(cursor->pixels + (size_t)y * width,
+			buf + (size_t)y * stride * 4, width * 4);
+	}
+
+	xcb_pixmap_t pixmap = xcb_generate_id(x11->xcb_conn);
+	xcb_create_pixmap(x11->xcb_conn, 32, pixmap, x11->screen->root,
+		width, height);
+
+	xcb_gcontext_t gc = xcb_generate_id(x11->xcb_conn);
+	xcb_create_gc(x11->xcb_conn, gc, pixmap, 0, NULL);
+
+	if ((uint32_t)stride == width) {
+		xcb_put_image(x11->xcb_conn, XCB_IMAGE_FORMAT_Z_PIXMAP, pixmap, gc,
+			width, height, 0, 0, 0, 32, width * height * 4, buf);
+	} else {
+		for (uint32_t y = 0; y < height; ++y) {
+			xcb_put_image(x11->xcb_conn, XCB_IMAGE_FORMAT_Z_PIXMAP, pixmap,
+				gc, width, 1, 0, y, 0, 32, width * 4,
+				buf + (size_t)y * stride * 4);
+		}
+	}
+
+	cursor->picture = xcb_generate_id(x11->xcb_conn);
+	xcb_render_create_picture(x11->xcb_conn, cursor->picture, pixmap,
+		x11->argb32, 0, NULL);
+
+	// The picture keeps a reference to the pixmap
+	xcb_free_gc(x11->xcb_conn, gc);
+	xcb_free_pixmap(x11->xcb_conn, pixmap);
+
+	return cursor;
+}
+
+static void x11_cursor_set_hotspot(struct wlr_x11_backend *x11,
+		struct wlr_x11_cursor *cursor, int32_t hotspot_x, int32_t hotspot_y) {
+	if (hotspot_x < 0) {
+		hotspot_x = 0;
+	}
+	if (hotspot_y < 0) {
+		hotspot_y = 0;
+	}
+
+	if (cursor->cursor && cursor->hotspot_x == hotspot_x &&
+			cursor->hotspot_y == hotspot_y) {
+		return;
+	}
+
+	if (cursor->cursor) {
+		xcb_free_cursor(x11->xcb_conn, cursor->cursor);
+	}
+	cursor->hotspot_x = hotspot_x;
+	cursor->hotspot_y = hotspot_y;
+	cursor->cursor = xcb_generate_id(x11->xcb_conn);
+	xcb_render_create_cursor(x11->xcb_conn, cursor->cursor, cursor->picture,
+		hotspot_x, hotspot_y);
+}
+
+static bool cursor_in_use(struct wlr_x11_backend *x11,
+		struct wlr_x11_cursor *cursor) {
+	struct wlr_x11_output *output;
+	wl_list_for_each(output, &x11->outputs, link) {
+		if (output->cursor == cursor) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Returns the cursor for an image, uploading it if it isn't cached yet. Returns
+ * NULL if the cache is full of cursors displayed by outputs.
+ */
+static struct wlr_x11_cursor *x11_get_cursor(struct wlr_x11_backend *x11,
+		const uint8_t *buf, int32_t stride, uint32_t width, uint32_t height) {
+	uint64_t hash = hash_pixels(buf, stride, width, height);
+
+	struct wlr_x11_cursor *cursor = NULL, *iter;
+	wl_list_for_each(iter, &x11->cursors, link) {
+		if (x11_cursor_matches(iter, hash, buf, stride, width, height)) {
+			cursor = iter;
+			break;
+		}
+	}
+
+	if (cursor) {
+		wl_list_remove(&cursor->link);
+		wl_list_insert(&x11->cursors, &cursor->link);
+		return cursor;
+	}
+
+	if (wl_list_length(&x11->cursors) >= WLR_X11_CURSOR_CACHE_SIZE) {
+		// Evict the least recently used cursor no output displays
+		struct wlr_x11_cursor *victim = NULL;
+		wl_list_for_each_reverse(iter, &x11->cursors, link) {
+			if (!cursor_in_use(x11, iter)) {
+				victim = iter;
+				break;
+			}
+		}
+		if (!victim) {
+			wlr_log(L_DEBUG, "X11 cursor cache full, all entries in use");
+			return NULL;
+		}
+		x11_cursor_destroy(x11, victim);
+	}
+
+	cursor = x11_cursor_upload(x11, buf, stride, width, height, hash);
+	if (!cursor) {
+		return NULL;
+	}
+	wl_list_insert(&x11->cursors, &cursor->link);
+	return cursor;
+}
+
+static bool output_set_custom_mode(struct wlr_output *wlr_output, int32_t width,
+		int32_t height, int32_t refresh) {
+	struct wlr_x11_output *output = (struct wlr_x11_output *)wlr_output;
+	struct wlr_x11_backend *x11 = output->x11;
+
+	const uint32_t values[] = { width, height };
+	xcb_configure_window(x11->xcb_conn, output->win,
+		XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT, values);
+	return true;
+}
+
+static void output_transform(struct wlr_output *wlr_output, enum wl_output_transform transform) {
+	struct wlr_x11_output *output = (struct wlr_x11_output *)wlr_output;
+	output->wlr_output.transform = transform;
+}
+
+static void output_destroy(struct wlr_output *wlr_output) {
+	struct wlr_x11_output *output = (struct wlr_x11_output *)wlr_output;
+	struct wlr_x11_backend *x11 = output->x11;
+
+	wl_list_remove(&output->link);
+	frame_clock_finish(&output->frame_clock);
+	eglDestroySurface(x11->egl.display, output->surf);
+	xcb_destroy_window(x11->xcb_conn, output->win);
+	xcb_flush(x11->xcb_conn);
+	free(output);
+}
+
+static bool output_make_current(struct wlr_output *wlr_output, int *buffer_age) {
+	struct wlr_x11_output *output = (struct wlr_x11_output *)wlr_output;
+	struct wlr_x11_backend *x11 = output->x11;
+
+	return wlr_egl_make_current(&x11->egl, output->surf, buffer_age);
+}
+
+static bool output_swap_buffers(struct wlr_output *wlr_output,
+		pixman_region32_t *damage) {
+	struct wlr_x11_output *output = (struct wlr_x11_output *)wlr_output;
+	struct wlr_x11_backend *x11 = output->x11;
+
+	if (!wlr_egl_swap_buffers(&x11->egl, output->surf, damage)) {
+		return false;
+	}
+
+#ifdef WLR_HAS_XCB_PRESENT
+	if (x11->present_opcode != 0) {
+		// Get notified at the next vblank
+		xcb_present_notify_msc(x11->xcb_conn, output->win, 0, 0, 1, 0);
+		xcb_flush(x11->xcb_conn);
+		return true;
+	}
+#endif
+
+	frame_clock_schedule(&output->frame_clock);
+	return true;
+}
+
+/**
+ * Returns a copy of a cursor image as it appears on a transformed output, with
+ * a stride equal to its width. The size of the copy is stored in `width` and
+ * `height`.
+ */
+static uint32_t *transform_cursor_pixels(const uint8_t *buf, int32_t stride,
+		uint32_t *width, uint32_t *height,
+		enum wl_output_transform transform) {
+	uint32_t src_width = *width, src_height = *height;
+	uint32_t dst_width = src_width, dst_height = src_height;
+	if (transform % 2 == 1) {
+		dst_width = src_height;
+		dst_height = src_width;
+	}
+
+	uint32_t *dst = malloc((size_t)dst_width * dst_height * sizeof(uint32_t));
+	if (dst == NULL) {
+		wlr_log(L_ERROR, "Allocation failed");
+		return NULL;
+	}
+
+	const uint32_t *src = (const uint32_t *)buf;
+	for (uint32_t y = 0; y < src_height; ++y) {
+		for (uint32_t x = 0; x < src_width; ++x) {
+			struct wlr_box box = { .x = x, .y = y, .width = 1, .height = 1 };
+			wlr_box_transform(&box, transform, src_width, src_height, &box);
+			dst[(size_t)box.y * dst_width + box.x] =
+				src[(size_t)y * stride + x];
+		}
+	}
+
+	*width = dst_width;
+	*height = dst_height;
+	return dst;
+}
+
+static bool output_set_cursor(struct wlr_output *wlr_output,
+		const uint8_t *buf, int32_t stride, uint32_t width, uint32_t height,
+		int32_t hotspot_x, int32_t hotspot_y, bool update_pixels) {
+	struct wlr_x11_output *output = (struct wlr_x11_output *)wlr_output;
+	struct wlr_x11_backend *x11 = output->x11;
+
+	if (x11->argb32 == 0) {
+		return false;
+	}
+
+	// The image is given in output coordinates, X displays it in window
+	// coordinates
+	enum wl_output_transform transform =
+		wlr_output_transform_invert(wlr_output->transform);
+
+	struct wlr_x11_cursor *cursor;
+	if (!update_pixels) {
+		// Update hotspot without changing cursor image
+		cursor = output->cursor;
+		if (!cursor) {
+			return true;
+		}
+		width = cursor->width;
+		height = cursor->height;
+		if (transform % 2 == 1) {
+			width = cursor->height;
+			height = cursor->width;
+		}
+	} else if (!buf) {
+		// Hide cursor, X would show its own otherwise
+		static const uint32_t blank = 0;
+		cursor = x11_get_cursor(x11, (const uint8_t *)&blank, 1, 1, 1);
+		width = height = 1;
+		hotspot_x = hotspot_y = 0;
+	} else if (transform != WL_OUTPUT_TRANSFORM_NORMAL) {
+		uint32_t dst_width = width, dst_height = height;
+		uint32_t *pixels = transform_cursor_pixels(buf, stride, &dst_width,
+			&dst_height, transform);
+		if (!pixels) {
+			return false;
+		}
+		cursor = x11_get_cursor(x11, (const uint8_t *)pixels, dst_width,
+			dst_width, dst_height);
+		free(pixels);
+	} else {
+		cursor = x11_get_cursor(x11, buf, stride, width, height);
+	}
+	if (!cursor) {
+		return false;
+	}
+
+	struct wlr_box hotspot = { .x = hotspot_x, .y = hotspot_y };
+	wlr_box_transform(&hotspot, transform, width, height, &hotspot);
+	hotspot_x = hotspot.x;
+	hotspot_y = hotspot.y;
+
+	x11_cursor_set_hotspot(x11, cursor, hotspot_x, hotspot_y);
+	output->cursor = cursor;
+
+	xcb_change_window_attributes(x11->xcb_conn, output->win, XCB_CW_CURSOR,
+		&cursor->cursor);
+	xcb_flush(x11->xcb_conn);
+	return true;
+}
+
+static bool output_move_cursor(struct wlr_output *wlr_output, int x, int y) {
+	// The X server moves the cursor itself
+	return true;
+}
+
+static struct wlr_output_impl output_impl = {
+	.set_custom_mode = output_set_custom_mode,
+	.transform = output_transform,
+	.destroy = output_destroy,
+	.make_current = output_make_current,
+	.swap_buffers = output_swap_buffers,
+	.set_cursor = output_set_cursor,
+	.move_cursor = output_move_cursor,
+};
+
+bool wlr_output_is_x11(struct wlr_output *wlr_output) {
+	return wlr_output->impl == &output_impl;
+}
+
+void wlr_x11_cursor_cache_finish(struct wlr_x11_backend *x11) {
+	struct wlr_x11_cursor *cursor, *tmp;
+	wl_list_for_each_safe(cursor, tmp, &x11->cursors, link) {
+		x11_cursor_destroy(x11, cursor);
+	}
+}
+
+struct wlr_x11_output *wlr_x11_output_for_window(struct wlr_x11_backend *x11,
+		xcb_window_t window) {
+	struct wlr_x11_output *output;
+	wl_list_for_each(output, &x11->outputs, link) {
+		if (output->win == window) {
+			return output;
+		}
+	}
+	return NULL;
+}
+
+void wlr_x11_output_layout_get_box(struct wlr_x11_backend *x11,
+		struct wlr_box *box) {
+	int min_x = INT_MAX, min_y = INT_MAX;
+	int max_x = INT_MIN, max_y = INT_MIN;
+
+	struct wlr_x11_output *output;
+	wl_list_for_each(output, &x11->outputs, link) {
+		struct wlr_output *wlr_output = &output->wlr_output;
+
+		int width, height;
+		wlr_output_effective_resolution(wlr_output, &width, &height);
+
+		if (wlr_output->lx < min_x) {
+			min_x = wlr_output->lx;
+		}
+		if (wlr_output->ly < min_y) {
+			min_y = wlr_output->ly;
+		}
+		if (wlr_output->lx + width > max_x) {
+			max_x = wlr_output->lx + width;
+		}
+		if (wlr_output->ly + height > max_y) {
+			max_y = wlr_output->ly + height;
+		}
+	}
+
+	box->x = min_x;
+	box->y = min_y;
+	box->width = max_x - min_x;
+	box->height = max_y - min_y;
+}
+
+struct wlr_output *wlr_x11_output_create(struct wlr_backend *backend) {
+	assert(wlr_backend_is_x11(backend));
+	struct wlr_x11_backend *x11 = (struct wlr_x11_backend *)backend;
+	if (!x11->started) {
+		++x11->requested_outputs;
+		return NULL;
+	}
+
+	struct wlr_x11_output *output = calloc(1, sizeof(struct wlr_x11_output));
+	if (!output) {
+		wlr_log(L_ERROR, "Failed to allocate wlr_x11_output");
+		return NULL;
+	}
+	output->x11 = x11;
+
+	struct wlr_output *wlr_output = &output->wlr_output;
+	wlr_output_init(wlr_output, &x11->backend, &output_impl, x11->wl_display);
+
+	wlr_output_update_custom_mode(wlr_output, 1024, 768, 0);
+	strncpy(wlr_output->make, "X11", sizeof(wlr_output->make));
+	strncpy(wlr_output->model, "X11", sizeof(wlr_output->model));
+	snprintf(wlr_output->name, sizeof(wlr_output->name), "X11-%d",
+		++x11->last_output_num);
+
+	frame_clock_init(&output->frame_clock, wlr_output,
+		wl_display_get_event_loop(x11->wl_display));
+
+	uint32_t mask = XCB_CW_BACK_PIXEL | XCB_CW_EVENT_MASK;
+	uint32_t values[2] = {
+		x11->screen->white_pixel,
+		XCB_EVENT_MASK_EXPOSURE |
+		XCB_EVENT_MASK_KEY_PRESS | XCB_EVENT_MASK_KEY_RELEASE |
+		XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_BUTTON_RELEASE |
+		XCB_EVENT_MASK_POINTER_MOTION |
+		XCB_EVENT_MASK_STRUCTURE_NOTIFY
+	};
+	output->win = xcb_generate_id(x11->xcb_conn);
+	xcb_create_window(x11->xcb_conn, XCB_COPY_FROM_PARENT, output->win,
+		x11->screen->root, 0, 0, wlr_output->width, wlr_output->height, 1,
+		XCB_WINDOW_CLASS_INPUT_OUTPUT, x11->screen->root_visual, mask, values);
+
+#ifdef WLR_HAS_XCB_PRESENT
+	if (x11->present_opcode != 0) {
+		xcb_present_select_input(x11->xcb_conn, xcb_generate_id(x11->xcb_conn),
+			output->win, XCB_PRESENT_EVENT_MASK_COMPLETE_NOTIFY);
+	}
+#endif
+
+	wl_list_insert(&x11->outputs, &output->link);
+
+	output->surf = wlr_egl_create_surface(&x11->egl, &output->win);
+	if (!output->surf) {
+		wlr_log(L_ERROR, "Failed to create EGL surface");
+		xcb_destroy_window(x11->xcb_conn, output->win);
+		wl_list_remove(&output->link);
+		frame_clock_finish(&output->frame_clock);
+		free(output);
+		return NULL;
+	}
+
+	xcb_change_property(x11->xcb_conn, XCB_PROP_MODE_REPLACE, output->win,
+		x11->atoms.wm_protocols.reply->atom, XCB_ATOM_ATOM, 32, 1,
+		&x11->atoms.wm_delete_window.reply->atom);
+
+	char title[32];
+	if (snprintf(title, sizeof(title), "wlroots - %s", wlr_output->name)) {
+		xcb_change_property(x11->xcb_conn, XCB_PROP_MODE_REPLACE, output->win,
+			x11->atoms.net_wm_name.reply->atom,
+			x11->atoms.utf8_string.reply->atom, 8,
+			strlen(title), title);
+	}
+
+	xcb_map_window(x11->xcb_conn, output->win);
+	xcb_flush(x11->xcb_conn);
+	wlr_output_update_enabled(wlr_output, true);
+
+	wlr_signal_emit_safe(&x11->backend.events.new_output, wlr_output);
+
+	frame_clock_schedule(&output->frame_clock);
+
+	return wlr_output;
+}
@@ -24,6 +24,9 @@ struct wlr_drm_plane {
 
 	struct wlr_drm_surface surf;
 	struct wlr_drm_surface mgpu_surf;
+	// Scan out buffers of surf imported on this GPU instead of copying them
+	// to mgpu_surf
+	bool mgpu_import;
 
 	// Only used by cursor
 	float matrix[16];
@@ -35,13 +38,44 @@ struct wlr_drm_plane {
 	union wlr_drm_plane_props props;
 };
 
+enum wlr_drm_crtc_field {
+	WLR_DRM_CRTC_MODE = 1 << 0,
+	WLR_DRM_CRTC_PRIMARY = 1 << 1,
+	WLR_DRM_CRTC_CURSOR = 1 << 2,
+	WLR_DRM_CRTC_CURSOR_POS = 1 << 3,
+	WLR_DRM_CRTC_GAMMA = 1 << 4,
+	WLR_DRM_CRTC_VRR = 1 << 5,
+};
+
+// CRTC state collected between two atomic commits
+struct wlr_drm_crtc_pending {
+	uint32_t committed; // enum wlr_drm_crtc_field
+
+	struct wlr_drm_connector *conn;
+	bool active;
+	uint32_t mode_id; // new mode blob, 0 to keep the current one
+	uint32_t primary_fb_id;
+	uint32_t cursor_fb_id; // 0 to disable the cursor
+	int cursor_x, cursor_y;
+	uint32_t gamma_lut; // new gamma blob
+	struct drm_color_lut *gamma_lut_data;
+	uint32_t gamma_lut_len; // bytes
+	bool vrr_enabled;
+};
+
 struct wlr_drm_crtc {
 	uint32_t id;
 
 	// Atomic modesetting only
 	uint32_t mode_id;
 	uint32_t gamma_lut;
-	drmModeAtomicReq *atomic;
+	// Contents of the gamma blob, identical ramps reuse it
+	struct drm_color_lut *gamma_lut_data;
+	uint32_t gamma_lut_len; // bytes
+	bool vrr_enabled;
+	// Commits in a row which only succeeded without the cursor changes
+	unsigned int cursor_failures;
+	struct wlr_drm_crtc_pending pending;
 
 	// Legacy only
 	drmModeCrtc *legacy_crtc;
@@ -3,9 +3,11 @@
 
 #include <gbm.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <xf86drm.h>
 #include <xf86drmMode.h>
+#include <wlr/types/wlr_output.h>
 
 struct wlr_drm_backend;
 struct wlr_drm_connector;
@@ -16,10 +18,18 @@ struct wlr_drm_interface {
 	// Enable or disable DPMS for connector
 	bool (*conn_enable)(struct wlr_drm_backend *drm,
 		struct wlr_drm_connector *conn, bool enable);
+	// Set the DPMS state of connector, keeping its mode
+	bool (*conn_set_dpms)(struct wlr_drm_backend *drm,
+		struct wlr_drm_connector *conn, enum wlr_output_dpms_mode mode);
 	// Pageflip on crtc. If mode is non-NULL perform a full modeset using it.
 	bool (*crtc_pageflip)(struct wlr_drm_backend *drm,
 		struct wlr_drm_connector *conn, struct wlr_drm_crtc *crtc,
 		uint32_t fb_id, drmModeModeInfo *mode);
+	// Modeset several connectors with a single operation, using their current
+	// mode and the given framebuffers. Optional, connectors are modeset one by
+	// one with crtc_pageflip otherwise.
+	bool (*conn_modeset)(struct wlr_drm_backend *drm,
+		struct wlr_drm_connector **conns, const uint32_t *fb_ids, size_t n);
 	// Enable the cursor buffer on crtc. Set bo to NULL to disable
 	bool (*crtc_set_cursor)(struct wlr_drm_backend *drm,
 		struct wlr_drm_crtc *crtc, struct gbm_bo *bo);
@@ -30,6 +40,9 @@ struct wlr_drm_interface {
 	bool (*crtc_set_gamma)(struct wlr_drm_backend *drm,
 			struct wlr_drm_crtc *crtc, uint16_t *r, uint16_t *g, uint16_t *b,
 			uint32_t size);
+	// Enable or disable variable refresh rate on crtc. Optional.
+	bool (*crtc_set_vrr)(struct wlr_drm_backend *drm,
+			struct wlr_drm_crtc *crtc, bool enabled);
 	// Get the gamma lut size of a crtc
 	uint32_t (*crtc_get_gamma_size)(struct wlr_drm_backend *drm,
 			struct wlr_drm_crtc *crtc);
@@ -14,12 +14,13 @@ union wlr_drm_connector_props {
 	struct {
 		uint32_t edid;
 		uint32_t dpms;
+		uint32_t vrr_capable; // Not guaranteed to exist
 
 		// atomic-modesetting only
 
 		uint32_t crtc_id;
 	};
-	uint32_t props[3];
+	uint32_t props[4];
 };
 
 union wlr_drm_crtc_props {
@@ -34,8 +35,9 @@ union wlr_drm_crtc_props {
 		uint32_t mode_id;
 		uint32_t gamma_lut;
 		uint32_t gamma_lut_size;
+		uint32_t vrr_enabled; // Not guaranteed to exist
 	};
-	uint32_t props[6];
+	uint32_t props[7];
 };
 
 union wlr_drm_plane_props {
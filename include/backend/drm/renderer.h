@@ -2,6 +2,7 @@
 #define BACKEND_DRM_RENDERER_H
 
 #include <EGL/egl.h>
+#include <EGL/eglext.h>
 #include <gbm.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -18,6 +19,22 @@ struct wlr_drm_renderer {
 	struct wlr_renderer *wlr_rend;
 };
 
+// Maximum number of buffers a GBM surface cycles through
+#define WLR_DRM_SURFACE_MAX_BUFFERS 4
+
+// A buffer of a DRM surface, with the resources derived from it
+struct wlr_drm_buffer {
+	struct gbm_bo *bo;
+	uint32_t fb_id;
+
+	// Only used when scanning out the buffer on another GPU
+	struct wlr_drm_renderer *mgpu_renderer;
+	struct gbm_bo *mgpu_bo; // imported on mgpu_renderer
+	uint32_t mgpu_fb_id;
+	EGLImageKHR image; // only used by the copy fallback
+	struct wlr_texture *texture;
+};
+
 struct wlr_drm_surface {
 	struct wlr_drm_renderer *renderer;
 
@@ -27,8 +44,11 @@ struct wlr_drm_surface {
 	struct gbm_surface *gbm;
 	EGLSurface egl;
 
-	struct gbm_bo *front;
-	struct gbm_bo *back;
+	struct gbm_bo *front; // released once the back buffer is displayed
+	struct gbm_bo *back; // displayed or waiting for a page-flip
+	struct gbm_bo *queued; // rendered while a page-flip is pending
+
+	struct wlr_drm_buffer buffers[WLR_DRM_SURFACE_MAX_BUFFERS];
 };
 
 bool wlr_drm_renderer_init(struct wlr_drm_backend *drm,
@@ -49,7 +69,27 @@ struct gbm_bo *wlr_drm_surface_swap_buffers(struct wlr_drm_surface *surf,
 	pixman_region32_t *damage);
 struct gbm_bo *wlr_drm_surface_get_front(struct wlr_drm_surface *surf);
 void wlr_drm_surface_post(struct wlr_drm_surface *surf);
+// Swaps buffers while the back buffer is waiting for a page-flip. The new
+// buffer replaces any previously queued one.
+void wlr_drm_surface_queue_buffers(struct wlr_drm_surface *surf,
+	pixman_region32_t *damage);
+// Makes the queued buffer the back buffer. Must only be called once a
+// page-flip to the queued buffer has been scheduled.
+void wlr_drm_surface_flip_queued(struct wlr_drm_surface *surf);
+// Releases the queued buffer without displaying it
+void wlr_drm_surface_drop_queued(struct wlr_drm_surface *surf);
+// Returns the DRM framebuffer id for a buffer of the surface
+uint32_t wlr_drm_surface_get_fb(struct wlr_drm_surface *surf,
+	struct gbm_bo *bo);
 struct gbm_bo *wlr_drm_surface_mgpu_copy(struct wlr_drm_surface *dest,
-	struct gbm_bo *src);
+	struct wlr_drm_surface *src, struct gbm_bo *bo);
+// Imports a buffer of the surface on another GPU through dmabuf and returns a
+// framebuffer id for it on that GPU, or 0 if the import failed
+uint32_t wlr_drm_surface_import_fb(struct wlr_drm_surface *surf,
+	struct wlr_drm_renderer *dest, struct gbm_bo *bo);
+// Checks whether linear buffers allocated by src can be scanned out by dest
+bool wlr_drm_renderer_can_import(struct wlr_drm_renderer *src,
+	struct wlr_drm_renderer *dest, uint32_t width, uint32_t height,
+	uint32_t format);
 
 #endif
@@ -12,7 +12,9 @@ int32_t calculate_refresh_rate(drmModeModeInfo *mode);
 void parse_edid(struct wlr_output *restrict output, size_t len, const uint8_t *data);
 // Returns the string representation of a DRM output type
 const char *conn_get_name(uint32_t type_id);
-// Returns the DRM framebuffer id for a gbm_bo
+// Creates a DRM framebuffer for a gbm_bo, returns 0 on failure
+uint32_t create_fb_for_bo(struct gbm_bo *bo);
+// Returns the DRM framebuffer id for a gbm_bo, stored in its user data
 uint32_t get_fb_for_bo(struct gbm_bo *bo);
 
 // Part of match_obj
@@ -30,7 +32,8 @@ enum {
  *
  * res contains an index of which objs it is matched with or UNMATCHED.
  *
- * This solution is left in out.
+ * The solution maximizes the number of matches, then minimizes the number of
+ * changes from res. It is left in out.
  * Returns the total number of matched solutions.
  */
 size_t match_obj(size_t num_objs, const uint32_t objs[static restrict num_objs],
@@ -0,0 +1,45 @@
+#ifndef BACKEND_FRAME_CLOCK_H
+#define BACKEND_FRAME_CLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <wayland-server.h>
+#include <wlr/types/wlr_output.h>
+
+/**
+ * Paces the frames of an output of a nested backend. The host reports when
+ * frames are displayed if it can, the clock then follows its refresh cycle.
+ * Otherwise frames are predicted from the last known vblank and refresh rate.
+ */
+struct frame_clock {
+	struct wlr_output *output;
+	struct wl_event_source *timer;
+
+	int32_t refresh; // mHz, zero if unknown
+	struct timespec last_present;
+	uint64_t last_seq;
+	bool has_present;
+};
+
+void frame_clock_init(struct frame_clock *clock, struct wlr_output *output,
+	struct wl_event_loop *loop);
+void frame_clock_finish(struct frame_clock *clock);
+/**
+ * Records a vblank reported by the host. `seq` is the host's vertical retrace
+ * counter, or zero if unknown. If the host doesn't report its refresh rate,
+ * set `refresh` to zero and it is measured from consecutive vblanks.
+ */
+void frame_clock_present(struct frame_clock *clock,
+	const struct timespec *when, uint64_t seq, int32_t refresh);
+/**
+ * Sends a frame event now, cancelling any scheduled one.
+ */
+void frame_clock_frame(struct frame_clock *clock);
+/**
+ * Sends a frame event at the next predicted vblank. Used when the host doesn't
+ * tell when frames are displayed.
+ */
+void frame_clock_schedule(struct frame_clock *clock);
+
+#endif
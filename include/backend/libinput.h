@@ -7,6 +7,7 @@
 #include <wlr/interfaces/wlr_input_device.h>
 #include <wlr/types/wlr_input_device.h>
 #include <wlr/types/wlr_list.h>
+#include <wlr/types/wlr_pointer.h>
 
 struct wlr_libinput_backend {
 	struct wlr_backend backend;
@@ -27,10 +28,25 @@ struct wlr_libinput_input_device {
 	struct wlr_input_device wlr_input_device;
 
 	struct libinput_device *handle;
+
+	// Relative pointer events merged until the end of the batch or until an
+	// event that can't be merged comes in
+	struct {
+		bool motion;
+		struct wlr_event_pointer_motion motion_event;
+		bool axis[2]; // indexed by enum wlr_axis_orientation
+		struct wlr_event_pointer_axis axis_events[2];
+		bool frame; // events were emitted during this batch
+	} pending;
 };
 
 void wlr_libinput_event(struct wlr_libinput_backend *state,
 		struct libinput_event *event);
+/**
+ * Ends the current batch of events: emits merged events and a frame event for
+ * each pointer which got events.
+ */
+void wlr_libinput_frame(struct wlr_libinput_backend *backend);
 
 struct wlr_input_device *get_appropriate_device(
 		enum wlr_input_device_type desired_type,
@@ -43,6 +59,8 @@ void handle_keyboard_key(struct libinput_event *event,
 
 struct wlr_pointer *wlr_libinput_pointer_create(
 		struct libinput_device *device);
+void wlr_libinput_pointer_flush(struct wlr_libinput_input_device *dev);
+void wlr_libinput_pointer_frame(struct wlr_libinput_input_device *dev);
 void handle_pointer_motion(struct libinput_event *event,
 		struct libinput_device *device);
 void handle_pointer_motion_abs(struct libinput_event *event,
@@ -0,0 +1,46 @@
+#ifndef BACKEND_REPLAY_H
+#define BACKEND_REPLAY_H
+
+#include <stdint.h>
+#include <time.h>
+#include <wlr/backend/interface.h>
+#include <wlr/backend/replay.h>
+
+struct wlr_replay_backend {
+	struct wlr_backend backend;
+	struct wl_display *display;
+	struct wl_list input_devices;
+	struct wl_listener display_destroy;
+	bool started;
+	double speed;
+
+	// The whole recording, minus the header
+	uint8_t *data;
+	size_t size, offset;
+
+	struct wl_event_source *timer;
+	struct timespec start; // CLOCK_MONOTONIC
+};
+
+struct wlr_replay_input_device {
+	struct wlr_input_device wlr_input_device;
+
+	struct wlr_replay_backend *backend;
+	uint32_t id; // in the recording
+};
+
+struct input_record;
+
+struct wlr_replay_input_device *replay_input_device_create(
+	struct wlr_replay_backend *backend, uint32_t id,
+	enum wlr_input_device_type type, const char *name);
+struct wlr_replay_input_device *replay_input_device_from_id(
+	struct wlr_replay_backend *backend, uint32_t id);
+/**
+ * Emits the event of a record on the device. Returns false if the payload
+ * doesn't match the record type.
+ */
+bool replay_input_device_emit(struct wlr_replay_input_device *device,
+	const struct input_record *record, const void *payload);
+
+#endif
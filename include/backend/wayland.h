@@ -2,6 +2,7 @@
 #define BACKEND_WAYLAND_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <wayland-client.h>
 #include <wayland-egl.h>
 #include <wayland-server.h>
@@ -10,12 +11,17 @@
 #include <wlr/render.h>
 #include <wlr/render/egl.h>
 #include <wlr/types/wlr_box.h>
+#include "backend/frame_clock.h"
+
+#define WLR_WL_SHM_BUFFERS_LEN 3
 
 struct wlr_wl_backend {
 	struct wlr_backend backend;
 
 	/* local state */
 	bool started;
+	bool shm_present; // render off-screen and present through wl_shm
+	bool shm_read_bgra; // GL_EXT_read_format_bgra is supported
 	struct wl_display *local_display;
 	struct wl_list devices;
 	struct wl_list outputs;
@@ -30,11 +36,23 @@ struct wlr_wl_backend {
 	struct wl_compositor *compositor;
 	struct zxdg_shell_v6 *shell;
 	struct wl_shm *shm;
+	struct wp_presentation *presentation;
+	uint32_t presentation_clock;
 	struct wl_seat *seat;
 	struct wl_pointer *pointer;
 	char *seat_name;
 };
 
+struct wlr_wl_shm_buffer {
+	struct wl_buffer *buffer;
+	void *data;
+	size_t size;
+	int32_t width, height, stride;
+	bool busy; // attached, waiting for wl_buffer.release
+	// Accumulated damage since this buffer was last drawn to
+	pixman_region32_t damage;
+};
+
 struct wlr_wl_backend_output {
 	struct wlr_output wlr_output;
 
@@ -44,6 +62,14 @@ struct wlr_wl_backend_output {
 	struct zxdg_toplevel_v6 *xdg_toplevel;
 	struct wl_egl_window *egl_window;
 	struct wl_callback *frame_callback;
+	struct wp_presentation_feedback *presentation_feedback;
+	struct frame_clock frame_clock;
+
+	// Only used when the backend presents through wl_shm
+	struct wlr_wl_shm_buffer shm_buffers[WLR_WL_SHM_BUFFERS_LEN];
+	// Pixels of a damage rectangle as returned by glReadPixels
+	void *shm_scratch;
+	size_t shm_scratch_size;
 
 	struct {
 		struct wl_shm_pool *pool;
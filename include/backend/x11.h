@@ -2,19 +2,44 @@
 #define BACKEND_X11_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <wayland-server.h>
 #include <wlr/render/egl.h>
+#include <wlr/types/wlr_box.h>
 #include <X11/Xlib-xcb.h>
+#include <xcb/render.h>
 #include <xcb/xcb.h>
+#include "backend/frame_clock.h"
+
+// Maximum number of cursor images kept on the X server
+#define WLR_X11_CURSOR_CACHE_SIZE 16
 
 struct wlr_x11_backend;
 
+// A cursor image uploaded to the X server
+struct wlr_x11_cursor {
+	uint64_t hash; // of the pixels
+	uint32_t width, height;
+	uint32_t *pixels; // copy of the image, to tell hash collisions apart
+	xcb_render_picture_t picture;
+
+	int32_t hotspot_x, hotspot_y;
+	xcb_cursor_t cursor;
+
+	struct wl_list link; // wlr_x11_backend::cursors, most recently used first
+};
+
 struct wlr_x11_output {
 	struct wlr_output wlr_output;
 	struct wlr_x11_backend *x11;
+	struct wl_list link; // wlr_x11_backend::outputs
 
 	xcb_window_t win;
 	EGLSurface surf;
+
+	struct frame_clock frame_clock;
+
+	struct wlr_x11_cursor *cursor; // NULL if the cursor isn't set
 };
 
 struct wlr_x11_atom {
@@ -30,7 +55,10 @@ struct wlr_x11_backend {
 	xcb_connection_t *xcb_conn;
 	xcb_screen_t *screen;
 
-	struct wlr_x11_output output;
+	bool started;
+	struct wl_list outputs; // wlr_x11_output::link
+	size_t requested_outputs;
+	int last_output_num;
 
 	struct wlr_keyboard keyboard;
 	struct wlr_input_device keyboard_dev;
@@ -41,7 +69,13 @@ struct wlr_x11_backend {
 	struct wlr_egl egl;
 	struct wlr_renderer *renderer;
 	struct wl_event_source *event_source;
-	struct wl_event_source *frame_timer;
+
+	// Major opcode of the Present extension, zero if it isn't available
+	uint8_t present_opcode;
+
+	// Zero if the Render extension can't create cursors
+	xcb_render_pictformat_t argb32;
+	struct wl_list cursors; // wlr_x11_cursor::link
 
 	struct {
 		struct wlr_x11_atom wm_protocols;
@@ -56,4 +90,11 @@ struct wlr_x11_backend {
 	struct wl_listener display_destroy;
 };
 
+struct wlr_x11_output *wlr_x11_output_for_window(struct wlr_x11_backend *x11,
+	xcb_window_t window);
+// Returns the bounding box of all outputs in the layout
+void wlr_x11_output_layout_get_box(struct wlr_x11_backend *x11,
+	struct wlr_box *box);
+void wlr_x11_cursor_cache_finish(struct wlr_x11_backend *x11);
+
 #endif
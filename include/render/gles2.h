@@ -27,6 +27,13 @@ struct wlr_gles2_renderer {
 	struct wlr_renderer wlr_renderer;
 
 	struct wlr_egl *egl;
+	struct wlr_output *output; // output being rendered
+
+	// Gamma ramps of outputs without a hardware LUT, bound to texture unit 1
+	GLuint gamma_tex;
+	struct wlr_output *gamma_output; // output whose ramps are in gamma_tex
+	uint32_t gamma_serial; // wlr_output::gamma::serial of gamma_tex
+	struct wl_listener gamma_output_destroy;
 };
 
 struct wlr_gles2_texture {
@@ -44,6 +51,7 @@ struct shaders {
 	GLuint quad;
 	GLuint ellipse;
 	GLuint external;
+	bool gamma; // value of the gamma uniform in all programs
 };
 
 extern struct shaders shaders;
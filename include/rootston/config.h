@@ -3,6 +3,7 @@
 
 #include <wlr/types/wlr_input_device.h>
 #include <wlr/types/wlr_output_layout.h>
+#include <wlr/types/wlr_surface.h>
 
 #define ROOTS_CONFIG_DEFAULT_SEAT_NAME "seat0"
 
@@ -12,6 +13,7 @@ struct roots_output_config {
 	enum wl_output_transform transform;
 	int x, y;
 	float scale;
+	bool adaptive_sync;
 	struct wl_list link;
 	struct {
 		int width, height;
@@ -60,6 +62,8 @@ struct roots_cursor_config {
 
 struct roots_config {
 	bool xwayland;
+	bool debug_overlay;
+	enum wlr_surface_damage_check damage_check;
 
 	struct wl_list outputs;
 	struct wl_list devices;
@@ -68,6 +72,7 @@ struct roots_config {
 	struct wl_list cursors;
 	char *config_path;
 	char *startup_cmd;
+	char *record_path;
 };
 
 /**
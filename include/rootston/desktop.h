@@ -5,10 +5,12 @@
 #include <wayland-server.h>
 #include <wlr/config.h>
 #include <wlr/types/wlr_compositor.h>
+#include <wlr/types/wlr_frame_scheduler.h>
 #include <wlr/types/wlr_gamma_control.h>
 #include <wlr/types/wlr_idle.h>
 #include <wlr/types/wlr_list.h>
 #include <wlr/types/wlr_output_layout.h>
+#include <wlr/types/wlr_output_power.h>
 #include <wlr/types/wlr_output.h>
 #include <wlr/types/wlr_primary_selection.h>
 #include <wlr/types/wlr_screenshooter.h>
@@ -24,7 +26,9 @@ struct roots_desktop {
 	struct wl_list views; // roots_view::link
 
 	struct wl_list outputs; // roots_output::link
+	struct wl_list transactions; // roots_transaction::link
 	struct timespec last_frame;
+	bool debug_overlay;
 
 	struct roots_server *server;
 	struct roots_config *config;
@@ -33,15 +37,19 @@ struct roots_desktop {
 	struct wlr_xcursor_manager *xcursor_manager;
 
 	struct wlr_compositor *compositor;
+	struct wlr_frame_scheduler *frame_scheduler;
 	struct wlr_wl_shell *wl_shell;
 	struct wlr_xdg_shell_v6 *xdg_shell_v6;
 	struct wlr_xdg_shell *xdg_shell;
 	struct wlr_gamma_control_manager *gamma_control_manager;
+	struct wlr_output_power_manager *output_power_manager;
 	struct wlr_screenshooter *screenshooter;
 	struct wlr_server_decoration_manager *server_decoration_manager;
 	struct wlr_primary_selection_device_manager *primary_selection_device_manager;
 	struct wlr_idle *idle;
 
+	struct wl_event_source *damage_check_timer;
+
 	struct wl_listener new_output;
 	struct wl_listener layout_change;
 	struct wl_listener xdg_shell_v6_surface;
@@ -4,6 +4,7 @@
 #include <wayland-server.h>
 #include <wlr/types/wlr_cursor.h>
 #include <wlr/types/wlr_input_device.h>
+#include <wlr/types/wlr_input_recorder.h>
 #include <wlr/types/wlr_seat.h>
 #include "rootston/config.h"
 #include "rootston/cursor.h"
@@ -13,6 +14,7 @@
 struct roots_input {
 	struct roots_config *config;
 	struct roots_server *server;
+	struct wlr_input_recorder *recorder;
 
 	struct wl_listener new_input;
 
@@ -5,6 +5,7 @@
 #include <time.h>
 #include <wayland-server.h>
 #include <wlr/types/wlr_output_damage.h>
+#include <wlr/types/wlr_output_stats.h>
 
 struct roots_desktop;
 
@@ -17,6 +18,12 @@ struct roots_output {
 
 	struct timespec last_frame;
 	struct wlr_output_damage *damage;
+	struct wlr_output_stats *stats;
+
+	// Damage flashed by the debug overlay and not repainted yet, in output
+	// buffer coordinates
+	pixman_region32_t debug_flash;
+	struct wl_event_source *debug_flash_timer;
 
 	struct wl_listener destroy;
 	struct wl_listener frame;
@@ -0,0 +1,58 @@
+#ifndef ROOTSTON_TRANSACTION_H
+#define ROOTSTON_TRANSACTION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <wayland-server.h>
+#include <wlr/types/wlr_box.h>
+
+struct roots_desktop;
+struct roots_output;
+struct roots_view;
+
+/**
+ * A set of view geometry changes which are presented together. Outputs showing
+ * one of the views aren't repainted until every client has committed a buffer
+ * for its new geometry, or until the transaction times out.
+ */
+struct roots_transaction {
+	struct roots_desktop *desktop;
+	struct wl_list link; // roots_desktop::transactions
+	struct wl_list views; // roots_transaction_view::link
+	struct wl_event_source *timer;
+	bool committed;
+};
+
+struct roots_transaction_view {
+	struct roots_transaction *transaction;
+	struct roots_view *view;
+	struct wl_list link; // roots_transaction::views
+
+	struct wlr_box before, after; // layout coordinates
+	bool ready;
+
+	struct wl_listener view_destroy;
+	struct wl_listener surface_commit;
+};
+
+struct roots_transaction *roots_transaction_create(
+	struct roots_desktop *desktop);
+/**
+ * Moves and resizes a view as part of the transaction.
+ */
+void roots_transaction_move_resize(struct roots_transaction *transaction,
+	struct roots_view *view, double x, double y, uint32_t width,
+	uint32_t height);
+/**
+ * Starts waiting for the clients. The transaction is destroyed once applied.
+ */
+void roots_transaction_commit(struct roots_transaction *transaction);
+
+/**
+ * Returns true if the output shouldn't be repainted because a transaction
+ * involving one of its views is in progress.
+ */
+bool roots_transaction_blocks_output(struct roots_desktop *desktop,
+	struct roots_output *output);
+
+#endif
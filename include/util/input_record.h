@@ -0,0 +1,119 @@
+#ifndef UTIL_INPUT_RECORD_H
+#define UTIL_INPUT_RECORD_H
+
+#include <stdint.h>
+
+/*
+ * Input recordings are written by wlr_input_recorder and read by the replay
+ * backend. The file starts with a header, followed by records. Each record is
+ * a struct input_record followed by `size` bytes of payload. Everything is in
+ * host byte order.
+ */
+
+#define INPUT_RECORD_MAGIC "wlrinput"
+#define INPUT_RECORD_VERSION 1
+
+struct input_record_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+};
+
+enum input_record_type {
+	INPUT_RECORD_DEVICE_ADD, // enum wlr_input_device_type + name
+	INPUT_RECORD_DEVICE_REMOVE, // no payload
+	INPUT_RECORD_KEYBOARD_KEY,
+	INPUT_RECORD_KEYBOARD_MODIFIERS,
+	INPUT_RECORD_POINTER_MOTION,
+	INPUT_RECORD_POINTER_MOTION_ABSOLUTE, // struct input_record_position
+	INPUT_RECORD_POINTER_BUTTON, // struct input_record_button
+	INPUT_RECORD_POINTER_AXIS,
+	INPUT_RECORD_POINTER_FRAME, // no payload
+	INPUT_RECORD_TOUCH_DOWN, // struct input_record_touch
+	INPUT_RECORD_TOUCH_UP, // struct input_record_touch_id
+	INPUT_RECORD_TOUCH_MOTION, // struct input_record_touch
+	INPUT_RECORD_TOUCH_CANCEL, // struct input_record_touch_id
+	INPUT_RECORD_TABLET_TOOL_AXIS,
+	INPUT_RECORD_TABLET_TOOL_PROXIMITY, // struct input_record_position
+	INPUT_RECORD_TABLET_TOOL_TIP, // struct input_record_position
+	INPUT_RECORD_TABLET_TOOL_BUTTON, // struct input_record_button
+	INPUT_RECORD_TABLET_PAD_BUTTON, // struct input_record_button
+	INPUT_RECORD_TABLET_PAD_RING, // struct input_record_pad_axis
+	INPUT_RECORD_TABLET_PAD_STRIP, // struct input_record_pad_axis
+};
+
+struct input_record {
+	uint64_t time_usec; // since the start of the recording
+	uint32_t device;
+	uint16_t type; // enum input_record_type
+	uint16_t size;
+};
+
+struct input_record_device {
+	uint32_t type;
+	char name[]; // not NUL-terminated
+};
+
+struct input_record_key {
+	uint32_t keycode;
+	uint32_t state;
+	uint32_t update_state;
+};
+
+struct input_record_modifiers {
+	uint32_t depressed, latched, locked, group;
+};
+
+struct input_record_motion {
+	double delta_x, delta_y;
+};
+
+struct input_record_position {
+	uint32_t state; // unused for absolute pointer motion
+	uint32_t reserved;
+	double x_mm, y_mm;
+	double width_mm, height_mm;
+};
+
+struct input_record_button {
+	uint32_t button;
+	uint32_t state;
+};
+
+struct input_record_axis {
+	uint32_t source;
+	uint32_t orientation;
+	double delta;
+};
+
+struct input_record_touch {
+	int32_t touch_id;
+	uint32_t reserved;
+	double x_mm, y_mm;
+	double width_mm, height_mm;
+};
+
+struct input_record_touch_id {
+	int32_t touch_id;
+};
+
+struct input_record_tool_axis {
+	uint32_t updated_axes;
+	uint32_t reserved;
+	double x_mm, y_mm;
+	double width_mm, height_mm;
+	double pressure;
+	double distance;
+	double tilt_x, tilt_y;
+	double rotation;
+	double slider;
+	double wheel_delta;
+};
+
+struct input_record_pad_axis {
+	uint32_t source;
+	uint32_t index;
+	double position;
+};
+
+#endif
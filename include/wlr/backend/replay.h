@@ -0,0 +1,20 @@
+#ifndef WLR_BACKEND_REPLAY_H
+#define WLR_BACKEND_REPLAY_H
+
+#include <wlr/backend.h>
+#include <wlr/types/wlr_input_device.h>
+
+/**
+ * Creates a backend which plays back input events recorded with
+ * wlr_input_recorder. Playback starts when the backend is started.
+ */
+struct wlr_backend *wlr_replay_backend_create(struct wl_display *display,
+	const char *path);
+/**
+ * Sets the playback speed, relative to the recording. Defaults to 1.
+ */
+void wlr_replay_backend_set_speed(struct wlr_backend *backend, double speed);
+bool wlr_backend_is_replay(struct wlr_backend *backend);
+bool wlr_input_device_is_replay(struct wlr_input_device *device);
+
+#endif
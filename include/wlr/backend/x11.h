@@ -7,9 +7,21 @@
 #include <wlr/types/wlr_input_device.h>
 #include <wlr/types/wlr_output.h>
 
+/**
+ * Creates a new wlr_x11_backend. This backend will be created with no outputs;
+ * you must use wlr_x11_output_create to add them.
+ */
 struct wlr_backend *wlr_x11_backend_create(struct wl_display *display,
 	const char *x11_display);
 
+/**
+ * Adds a new output to this backend, as a new X11 window. You may remove
+ * outputs by destroying them. Note that if called before initializing the
+ * backend, this will return NULL and your outputs will be created during
+ * initialization (and given to you via the output_add signal).
+ */
+struct wlr_output *wlr_x11_output_create(struct wlr_backend *backend);
+
 bool wlr_backend_is_x11(struct wlr_backend *backend);
 bool wlr_input_device_is_x11(struct wlr_input_device *device);
 bool wlr_output_is_x11(struct wlr_output *output);
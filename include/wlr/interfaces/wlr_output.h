@@ -20,9 +20,12 @@ struct wlr_output_impl {
 	void (*destroy)(struct wlr_output *output);
 	bool (*make_current)(struct wlr_output *output, int *buffer_age);
 	bool (*swap_buffers)(struct wlr_output *output, pixman_region32_t *damage);
-	void (*set_gamma)(struct wlr_output *output,
+	bool (*set_gamma)(struct wlr_output *output,
 		uint32_t size, uint16_t *r, uint16_t *g, uint16_t *b);
 	uint32_t (*get_gamma_size)(struct wlr_output *output);
+	bool (*set_dpms)(struct wlr_output *output,
+		enum wlr_output_dpms_mode mode);
+	bool (*enable_adaptive_sync)(struct wlr_output *output, bool enabled);
 };
 
 void wlr_output_init(struct wlr_output *output, struct wlr_backend *backend,
@@ -34,5 +37,12 @@ void wlr_output_update_custom_mode(struct wlr_output *output, int32_t width,
 void wlr_output_update_enabled(struct wlr_output *output, bool enabled);
 void wlr_output_update_needs_swap(struct wlr_output *output);
 void wlr_output_send_frame(struct wlr_output *output);
+/**
+ * Notifies that a frame has been displayed. If the refresh rate measured by the
+ * backend is known, it is passed as `refresh` (mHz) and updates the output's
+ * refresh rate.
+ */
+void wlr_output_send_present(struct wlr_output *output, struct timespec *when,
+	unsigned seq, int32_t refresh);
 
 #endif
@@ -3,17 +3,24 @@
 
 #include <wayland-server.h>
 #include <wlr/render.h>
+#include <wlr/types/wlr_surface.h>
 
 struct wlr_compositor {
 	struct wl_global *wl_global;
 	struct wl_list wl_resources;
 	struct wlr_renderer *renderer;
 	struct wl_list surfaces;
+	// Upload surface buffers only when they are rendered, see
+	// wlr_surface::defer_upload
+	bool defer_texture_uploads;
+	// Debugging aid checking client damage, see wlr_surface::damage_check
+	enum wlr_surface_damage_check damage_check;
 
 	struct wl_listener display_destroy;
 
 	struct {
 		struct wl_signal new_surface;
+		struct wl_signal destroy;
 	} events;
 };
 
@@ -3,6 +3,7 @@
 
 #include <wayland-server.h>
 #include <wlr/types/wlr_seat.h>
+#include <wlr/types/wlr_selection_cache.h>
 
 extern const struct
 wlr_pointer_grab_interface wlr_data_device_pointer_drag_interface;
@@ -52,6 +53,8 @@ struct wlr_data_source {
 	bool accepted;
 	struct wlr_data_offer *offer;
 	struct wlr_seat_client *seat_client;
+	// set while the source is the selection of a seat with a cache
+	struct wlr_selection_cache *cache;
 
 	// drag'n'drop status
 	enum wl_data_device_manager_dnd_action current_dnd_action;
@@ -129,6 +132,14 @@ void wlr_seat_client_send_selection(struct wlr_seat_client *seat_client);
 void wlr_seat_set_selection(struct wlr_seat *seat,
 		struct wlr_data_source *source, uint32_t serial);
 
+/**
+ * Caches the data of the seat selection in the compositor. Pastes are served
+ * from the cache and the selection is kept when the source client goes away.
+ * Pass NULL to disable caching.
+ */
+void wlr_seat_set_selection_cache(struct wlr_seat *seat,
+		struct wlr_selection_cache *cache);
+
 void wlr_data_source_init(struct wlr_data_source *source);
 
 void wlr_data_source_finish(struct wlr_data_source *source);
@@ -0,0 +1,91 @@
+#ifndef WLR_TYPES_WLR_FRAME_SCHEDULER_H
+#define WLR_TYPES_WLR_FRAME_SCHEDULER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <wayland-server.h>
+#include <wlr/types/wlr_compositor.h>
+#include <wlr/types/wlr_output.h>
+#include <wlr/types/wlr_surface.h>
+
+/**
+ * Decides when surfaces of a compositor receive their frame callbacks.
+ *
+ * Each surface is tied to the output with the highest refresh rate it has been
+ * marked visible on. When that output renders a frame, all of its surfaces get
+ * their callbacks at once. Surfaces which are not visible on any output, or
+ * whose output stopped rendering, get their callbacks every `idle_interval`
+ * milliseconds instead, so that hidden clients don't stall but don't draw at
+ * full speed either.
+ */
+struct wlr_frame_scheduler {
+	struct wlr_compositor *compositor;
+	struct wl_list surfaces; // wlr_frame_scheduler_surface::link
+	struct wl_list outputs; // wlr_frame_scheduler_output::link
+	struct wl_event_source *idle_timer;
+	int idle_interval; // milliseconds
+
+	struct wl_listener new_surface;
+	struct wl_listener compositor_destroy;
+
+	void *data;
+};
+
+struct wlr_frame_scheduler_output {
+	struct wlr_frame_scheduler *scheduler;
+	struct wlr_output *output;
+	struct wl_list link; // wlr_frame_scheduler::outputs
+	struct wl_list surfaces; // wlr_frame_scheduler_surface::output_link
+
+	struct wl_listener output_destroy;
+};
+
+struct wlr_frame_scheduler_surface {
+	struct wlr_frame_scheduler *scheduler;
+	struct wlr_surface *surface;
+	struct wl_list link; // wlr_frame_scheduler::surfaces
+
+	// Output driving the frame callbacks, NULL if the surface is hidden
+	struct wlr_frame_scheduler_output *output;
+	struct wl_list output_link; // wlr_frame_scheduler_output::surfaces
+	// Whether the surface has been marked visible on `output` since its last
+	// frame
+	bool visible;
+	int64_t last_frame; // milliseconds, CLOCK_MONOTONIC
+
+	struct wl_listener surface_destroy;
+};
+
+/**
+ * Creates a frame scheduler for the surfaces of this compositor. It is
+ * destroyed with the compositor.
+ */
+struct wlr_frame_scheduler *wlr_frame_scheduler_create(
+	struct wl_display *display, struct wlr_compositor *compositor);
+void wlr_frame_scheduler_destroy(struct wlr_frame_scheduler *scheduler);
+
+/**
+ * Sets the interval between frame callbacks of hidden surfaces, in
+ * milliseconds. Defaults to one second.
+ */
+void wlr_frame_scheduler_set_idle_interval(
+	struct wlr_frame_scheduler *scheduler, int interval);
+
+/**
+ * Marks a surface as visible on an output for its next frame. This should be
+ * called for every visible surface each time the output renders, whether the
+ * surface is damaged or not, before wlr_frame_scheduler_output_frame.
+ */
+void wlr_frame_scheduler_surface_visible(struct wlr_frame_scheduler *scheduler,
+	struct wlr_surface *surface, struct wlr_output *output);
+
+/**
+ * Sends frame callbacks to the surfaces tied to this output which have been
+ * marked visible since its last frame. Surfaces which haven't are detached
+ * from the output, and can be picked up by another one.
+ */
+void wlr_frame_scheduler_output_frame(struct wlr_frame_scheduler *scheduler,
+	struct wlr_output *output, const struct timespec *when);
+
+#endif
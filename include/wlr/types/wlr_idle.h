@@ -16,6 +16,7 @@
 struct wlr_idle {
 	struct wl_global *wl_global;
 	struct wl_list idle_timers; // wlr_idle_timeout::link
+	struct wl_list seats; // wlr_idle_seat::link
 	struct wl_event_loop *event_loop;
 
 	struct wl_listener display_destroy;
@@ -26,17 +27,34 @@ struct wlr_idle {
 	void *data;
 };
 
+/**
+ * Activity state of a seat. Timers are not re-armed on each activity
+ * notification: when a timer expires, it compares its timeout against the last
+ * activity timestamp and re-arms itself for the remaining time if needed.
+ */
+struct wlr_idle_seat {
+	struct wlr_idle *idle;
+	struct wlr_seat *seat;
+	struct wl_list link; // wlr_idle::seats
+	struct wl_list timers; // wlr_idle_timeout::seat_link
+
+	int64_t last_activity; // milliseconds, CLOCK_MONOTONIC
+	size_t idle_timer_count;
+
+	struct wl_listener seat_destroy;
+};
+
 struct wlr_idle_timeout {
 	struct wl_resource *resource;
 	struct wl_list link;
 	struct wlr_seat *seat;
+	struct wlr_idle_seat *idle_seat;
+	struct wl_list seat_link; // wlr_idle_seat::timers
 
 	struct wl_event_source *idle_source;
 	bool idle_state;
 	uint32_t timeout; // milliseconds
-
-	struct wl_listener input_listener;
-	struct wl_listener seat_destroy;
+	int64_t last_activity; // simulated by the client, milliseconds
 
 	void *data;
 };
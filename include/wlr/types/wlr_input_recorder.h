@@ -0,0 +1,40 @@
+#ifndef WLR_TYPES_WLR_INPUT_RECORDER_H
+#define WLR_TYPES_WLR_INPUT_RECORDER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <wayland-server.h>
+#include <wlr/types/wlr_input_device.h>
+
+/**
+ * Records the events of input devices to a file, with timestamps. Recordings
+ * can be played back with the replay backend.
+ */
+struct wlr_input_recorder {
+	FILE *file;
+	struct timespec start; // CLOCK_MONOTONIC
+	uint32_t last_device_id;
+	struct wl_list devices; // wlr_input_recorder_device::link
+
+	struct wl_listener display_destroy;
+
+	void *data;
+};
+
+/**
+ * Creates a recorder writing to the file at `path`. The file is truncated.
+ */
+struct wlr_input_recorder *wlr_input_recorder_create(
+	struct wl_display *display, const char *path);
+
+void wlr_input_recorder_destroy(struct wlr_input_recorder *recorder);
+
+/**
+ * Starts recording the events of this input device. Recording stops when the
+ * device is destroyed.
+ */
+void wlr_input_recorder_add_device(struct wlr_input_recorder *recorder,
+	struct wlr_input_device *device);
+
+#endif
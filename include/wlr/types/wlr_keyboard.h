@@ -31,6 +31,7 @@ enum wlr_keyboard_modifier {
 #define WLR_KEYBOARD_KEYS_CAP 32
 
 struct wlr_keyboard_impl;
+struct wlr_keyboard_keymap_file;
 
 struct wlr_keyboard_modifiers {
 	xkb_mod_mask_t depressed;
@@ -43,9 +44,11 @@ struct wlr_keyboard {
 	struct wlr_keyboard_impl *impl;
 	// TODO: Should this store key repeat info too?
 
+	// Shared by all keyboards with the same keymap
+	struct wlr_keyboard_keymap_file *keymap_file;
 	int keymap_fd;
 	size_t keymap_size;
-	struct xkb_keymap *keymap;
+	struct xkb_keymap *keymap; // same object for identical keymaps
 	struct xkb_state *xkb_state;
 	xkb_led_index_t led_indexes[WLR_LED_COUNT];
 	xkb_mod_index_t mod_indexes[WLR_MODIFIER_COUNT];
@@ -81,6 +84,10 @@ struct wlr_event_keyboard_key {
 	enum wlr_key_state state;
 };
 
+/**
+ * Sets the keyboard keymap. If another keyboard already uses an identical
+ * keymap, its xkb_keymap and keymap file are shared.
+ */
 void wlr_keyboard_set_keymap(struct wlr_keyboard *kb,
 	struct xkb_keymap *keymap);
 /**
@@ -36,6 +36,12 @@ struct wlr_output_cursor {
 	} events;
 };
 
+enum wlr_output_dpms_mode {
+	WLR_OUTPUT_DPMS_ON,
+	WLR_OUTPUT_DPMS_STANDBY,
+	WLR_OUTPUT_DPMS_OFF,
+};
+
 struct wlr_output_impl;
 
 /**
@@ -68,6 +74,11 @@ struct wlr_output {
 	int32_t refresh; // mHz, may be zero
 
 	bool enabled;
+	// while not on, no frame is rendered but damage is still accumulated
+	enum wlr_output_dpms_mode dpms_mode;
+	// refresh as soon as a buffer is swapped, up to the refresh rate of the
+	// current mode
+	bool adaptive_sync;
 	float scale;
 	enum wl_output_subpixel subpixel;
 	enum wl_output_transform transform;
@@ -78,11 +89,22 @@ struct wlr_output {
 	bool frame_pending;
 	float transform_matrix[16];
 
+	// last ramps applied by wlr_output_set_gamma
+	struct {
+		uint32_t size; // zero if unset or not applied
+		uint16_t *r, *g, *b;
+		// the backend has no hardware LUT, the renderer applies the ramps
+		bool software;
+		uint32_t serial; // incremented each time the ramps change
+	} gamma;
+
 	struct {
 		struct wl_signal frame;
+		struct wl_signal present;
 		struct wl_signal needs_swap;
 		struct wl_signal swap_buffers;
 		struct wl_signal enable;
+		struct wl_signal dpms;
 		struct wl_signal mode;
 		struct wl_signal scale;
 		struct wl_signal transform;
@@ -107,6 +129,14 @@ struct wlr_output {
 	void *data;
 };
 
+struct wlr_output_event_present {
+	struct wlr_output *output;
+	// Time when the last frame was displayed, CLOCK_MONOTONIC
+	struct timespec *when;
+	// Vertical retrace counter, zero if unknown
+	unsigned seq;
+};
+
 struct wlr_surface;
 
 void wlr_output_enable(struct wlr_output *output, bool enable);
@@ -150,8 +180,28 @@ bool wlr_output_swap_buffers(struct wlr_output *output, struct timespec *when,
 /**
  * Manually schedules a `frame` event. If a `frame` event is already pending,
  * it is a no-op.
+ *
+ * The event is sent as soon as the output can display a new buffer. With
+ * adaptive sync, this doesn't wait for the next refresh cycle.
  */
 void wlr_output_schedule_frame(struct wlr_output *output);
+/**
+ * Sets the output power state. While the output isn't on, no `frame` event is
+ * emitted. Turning it back on damages the whole output.
+ */
+bool wlr_output_set_dpms(struct wlr_output *output,
+	enum wlr_output_dpms_mode mode);
+/**
+ * Enables or disables adaptive sync (variable refresh rate). The change is
+ * applied with the next buffer swap. Returns false if the output doesn't
+ * support it.
+ */
+bool wlr_output_enable_adaptive_sync(struct wlr_output *output, bool enabled);
+/**
+ * Sets the gamma ramps of the output. Ramps identical to the current ones are
+ * ignored. If the backend has no hardware LUT, the ramps are applied by the
+ * renderer and the size must be the one returned by wlr_output_get_gamma_size.
+ */
 void wlr_output_set_gamma(struct wlr_output *output,
 	uint32_t size, uint16_t *r, uint16_t *g, uint16_t *b);
 uint32_t wlr_output_get_gamma_size(struct wlr_output *output);
@@ -5,12 +5,14 @@
 #include <time.h>
 #include <wlr/types/wlr_output.h>
 
+struct wlr_output_stats;
+
 /**
  * Damage tracking requires to keep track of previous frames' damage. To allow
- * damage tracking to work with triple buffering, a history of two frames is
- * required.
+ * damage tracking to work with swapchains of up to four buffers (e.g. triple
+ * buffering with a queued frame), a history of three frames is required.
  */
-#define WLR_OUTPUT_DAMAGE_PREVIOUS_LEN 2
+#define WLR_OUTPUT_DAMAGE_PREVIOUS_LEN 3
 
 /**
  * Tracks damage for an output.
@@ -29,6 +31,8 @@ struct wlr_output_damage {
 	pixman_region32_t previous[WLR_OUTPUT_DAMAGE_PREVIOUS_LEN];
 	size_t previous_idx;
 
+	struct wlr_output_stats *stats; // may be NULL
+
 	struct {
 		struct wl_signal frame;
 		struct wl_signal destroy;
@@ -38,6 +42,7 @@ struct wlr_output_damage {
 	struct wl_listener output_mode;
 	struct wl_listener output_transform;
 	struct wl_listener output_scale;
+	struct wl_listener output_dpms;
 	struct wl_listener output_needs_swap;
 	struct wl_listener output_frame;
 };
@@ -0,0 +1,39 @@
+#ifndef WLR_TYPES_WLR_OUTPUT_POWER_H
+#define WLR_TYPES_WLR_OUTPUT_POWER_H
+
+#include <wayland-server.h>
+#include <wlr/types/wlr_output.h>
+
+/**
+ * Lets clients such as idle daemons change the DPMS state of outputs.
+ */
+struct wlr_output_power_manager {
+	struct wl_global *wl_global;
+	struct wl_list output_powers; // wlr_output_power::link
+
+	struct wl_listener display_destroy;
+
+	void *data;
+};
+
+struct wlr_output_power {
+	struct wl_resource *resource;
+	struct wlr_output *output;
+	struct wl_list link;
+
+	struct wl_listener output_destroy_listener;
+	struct wl_listener output_dpms_listener;
+
+	struct {
+		struct wl_signal destroy;
+	} events;
+
+	void *data;
+};
+
+struct wlr_output_power_manager *wlr_output_power_manager_create(
+	struct wl_display *display);
+void wlr_output_power_manager_destroy(
+	struct wlr_output_power_manager *manager);
+
+#endif
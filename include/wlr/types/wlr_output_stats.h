@@ -0,0 +1,82 @@
+#ifndef WLR_TYPES_WLR_OUTPUT_STATS_H
+#define WLR_TYPES_WLR_OUTPUT_STATS_H
+
+#include <pixman.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <wayland-server.h>
+
+#define WLR_OUTPUT_STATS_LEN 128
+
+struct wlr_output_damage;
+
+struct wlr_output_frame_stats {
+	struct timespec start; // when rendering started, CLOCK_MONOTONIC
+	uint32_t damage_area; // repainted pixels
+	uint32_t damage_rects;
+	uint32_t surfaces_drawn;
+	uint32_t surfaces_skipped; // on the output but not damaged
+	uint64_t upload_bytes; // copied to textures while rendering
+	int64_t render_nsec; // from making the output current to swapping buffers
+	int64_t swap_nsec; // spent swapping buffers
+
+	// Only valid once the frame has been displayed
+	bool presented;
+	int64_t present_nsec; // from the start of rendering to display
+	bool missed_vblank; // displayed later than the first possible refresh
+};
+
+/**
+ * Records what rendering the frames of an output costs. The last
+ * WLR_OUTPUT_STATS_LEN frames rendered with the output damage are kept, each
+ * one is recorded when its buffers are swapped.
+ */
+struct wlr_output_stats {
+	struct wlr_output_damage *output_damage;
+
+	struct wlr_output_frame_stats frames[WLR_OUTPUT_STATS_LEN];
+	size_t frames_idx; // next frame to record
+	size_t frames_len;
+
+	// The frame being rendered, NULL otherwise. Compositors fill the surface
+	// and upload fields.
+	struct wlr_output_frame_stats *current;
+	// The last swapped frame, until it is displayed
+	struct wlr_output_frame_stats *pending_present;
+
+	struct wl_listener output_damage_destroy;
+	struct wl_listener output_present;
+
+	void *data;
+};
+
+/**
+ * Starts recording frame statistics. The statistics are destroyed with the
+ * output damage.
+ */
+struct wlr_output_stats *wlr_output_stats_create(
+	struct wlr_output_damage *output_damage);
+void wlr_output_stats_destroy(struct wlr_output_stats *stats);
+/**
+ * Returns a recorded frame, `age` being 0 for the last one, or NULL if fewer
+ * frames have been recorded.
+ */
+const struct wlr_output_frame_stats *wlr_output_stats_get_frame(
+	struct wlr_output_stats *stats, size_t age);
+
+/**
+ * Called by the output damage when it is made current, with the region to
+ * repaint.
+ */
+void wlr_output_stats_begin_frame(struct wlr_output_stats *stats,
+	pixman_region32_t *damage);
+/**
+ * Called by the output damage after swapping buffers. `swap_start` is the time
+ * when swapping started.
+ */
+void wlr_output_stats_end_frame(struct wlr_output_stats *stats,
+	const struct timespec *swap_start, bool swapped);
+
+#endif
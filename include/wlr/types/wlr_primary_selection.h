@@ -3,6 +3,7 @@
 
 #include <wayland-server.h>
 #include <wlr/types/wlr_seat.h>
+#include <wlr/types/wlr_selection_cache.h>
 
 struct wlr_primary_selection_device_manager {
 	struct wl_global *global;
@@ -26,6 +27,8 @@ struct wlr_primary_selection_source {
 	// source status
 	struct wlr_primary_selection_offer *offer;
 	struct wlr_seat_client *seat_client;
+	// set while the source is the selection of a seat with a cache
+	struct wlr_selection_cache *cache;
 
 	struct {
 		struct wl_signal destroy;
@@ -51,6 +54,12 @@ void wlr_primary_selection_device_manager_destroy(
 void wlr_seat_client_send_primary_selection(struct wlr_seat_client *seat_client);
 void wlr_seat_set_primary_selection(struct wlr_seat *seat,
 	struct wlr_primary_selection_source *source, uint32_t serial);
+/**
+ * Caches the data of the seat primary selection in the compositor. See
+ * wlr_seat_set_selection_cache.
+ */
+void wlr_seat_set_primary_selection_cache(struct wlr_seat *seat,
+	struct wlr_selection_cache *cache);
 
 void wlr_primary_selection_source_init(
 	struct wlr_primary_selection_source *source);
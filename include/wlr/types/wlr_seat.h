@@ -145,6 +145,8 @@ struct wlr_seat_pointer_state {
 struct wlr_seat_keyboard_state {
 	struct wlr_seat *seat;
 	struct wlr_keyboard *keyboard;
+	// Last keymap sent to clients, not resent when switching keyboards
+	struct xkb_keymap *keymap;
 
 	struct wlr_seat_client *focused_client;
 	struct wlr_surface *focused_surface;
@@ -187,6 +189,9 @@ struct wlr_seat {
 	struct wlr_primary_selection_source *primary_selection_source;
 	uint32_t primary_selection_serial;
 
+	struct wlr_selection_cache *selection_cache;
+	struct wlr_selection_cache *primary_selection_cache;
+
 	struct wlr_seat_pointer_state pointer_state;
 	struct wlr_seat_keyboard_state keyboard_state;
 	struct wlr_seat_touch_state touch_state;
@@ -194,6 +199,8 @@ struct wlr_seat {
 	struct wl_listener display_destroy;
 	struct wl_listener selection_data_source_destroy;
 	struct wl_listener primary_selection_source_destroy;
+	struct wl_listener selection_cache_destroy;
+	struct wl_listener primary_selection_cache_destroy;
 
 	struct {
 		struct wl_signal pointer_grab_begin;
@@ -0,0 +1,134 @@
+#ifndef WLR_TYPES_WLR_SELECTION_CACHE_H
+#define WLR_TYPES_WLR_SELECTION_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <wayland-server.h>
+
+/**
+ * A compositor-side copy of the data offered by a selection source, for one
+ * MIME type. The data is stored in an anonymous file and sent to clients
+ * without going through the source client again.
+ */
+struct wlr_selection_cache_entry {
+	struct wlr_selection_cache *cache;
+	char *mime_type;
+
+	int fd; // anonymous file holding the data
+	size_t size;
+	bool complete; // false while the data is being captured
+
+	// capture state
+	int pipe_fd;
+	struct wl_event_source *pipe_source;
+	struct wl_list waiting; // wlr_selection_cache_transfer::link
+
+	struct wl_list link; // wlr_selection_cache::entries
+};
+
+/**
+ * A pending send of a cache entry to a client file descriptor.
+ */
+struct wlr_selection_cache_transfer {
+	struct wlr_selection_cache *cache;
+	int fd; // destination
+	int data_fd; // duplicate of the entry's file descriptor
+	size_t size;
+	off_t offset;
+	struct wl_event_source *event_source;
+
+	struct wl_list link; // wlr_selection_cache::transfers
+};
+
+typedef void (*wlr_selection_cache_send_func_t)(void *data,
+	const char *mime_type, int32_t fd);
+
+/**
+ * Caches the contents of the current selection of a seat, so that repeated
+ * pastes don't require the source client to serialize the data again and so
+ * that the selection survives the source client.
+ *
+ * Attach it to a seat with wlr_seat_set_selection_cache or
+ * wlr_seat_set_primary_selection_cache. The cache is invalidated each time
+ * the selection changes.
+ */
+struct wlr_selection_cache {
+	struct wl_event_loop *event_loop;
+
+	size_t max_size; // memory budget for all entries, in bytes
+	size_t max_entry_size; // maximum size of a single entry, in bytes
+	bool eager; // capture all MIME types as soon as the selection is set
+
+	size_t size; // current size of all entries, in bytes
+	struct wl_list entries; // wlr_selection_cache_entry::link, most recently
+	                        // used first
+	struct wl_list transfers; // wlr_selection_cache_transfer::link
+	// char *, MIME types of the current selection whose data exceeds
+	// max_entry_size, requests for them go straight to the source
+	struct wl_array uncacheable;
+
+	// source of the data being captured, reset on invalidation
+	wlr_selection_cache_send_func_t send;
+	void *send_data;
+
+	struct wl_listener display_destroy;
+
+	struct {
+		struct wl_signal invalidate;
+		struct wl_signal evict; // wlr_selection_cache_entry
+		struct wl_signal destroy;
+	} events;
+
+	void *data;
+};
+
+struct wlr_selection_cache *wlr_selection_cache_create(
+	struct wl_display *display, size_t max_size);
+
+void wlr_selection_cache_destroy(struct wlr_selection_cache *cache);
+
+/**
+ * Changes the memory budget of the cache, evicting least recently used
+ * entries if necessary.
+ */
+void wlr_selection_cache_set_max_size(struct wlr_selection_cache *cache,
+	size_t max_size, size_t max_entry_size);
+
+/**
+ * Drops all entries and sets the source of the data to cache. Called when
+ * the selection changes. If `send` is NULL, nothing will be captured until the
+ * next call. In eager mode, the given MIME types are captured right away.
+ */
+void wlr_selection_cache_invalidate(struct wlr_selection_cache *cache,
+	wlr_selection_cache_send_func_t send, void *send_data,
+	struct wl_array *mime_types);
+
+/**
+ * Stops capturing from the current source. Incomplete entries are dropped and
+ * complete ones are kept. Called when the source of the selection goes away.
+ */
+void wlr_selection_cache_detach(struct wlr_selection_cache *cache);
+
+/**
+ * Evicts the entry for the given MIME type. Returns false if there is no such
+ * entry.
+ */
+bool wlr_selection_cache_evict(struct wlr_selection_cache *cache,
+	const char *mime_type);
+
+/**
+ * Sends the data for the given MIME type to the file descriptor, which is
+ * always consumed. If the data isn't cached yet, it is captured from the
+ * current source first. If the data cannot be cached, the request is
+ * forwarded to the source.
+ */
+void wlr_selection_cache_receive(struct wlr_selection_cache *cache,
+	const char *mime_type, int32_t fd);
+
+/**
+ * Returns true if the cache holds complete data for at least one MIME type.
+ */
+bool wlr_selection_cache_has_data(struct wlr_selection_cache *cache);
+
+#endif
@@ -23,8 +23,19 @@ struct wlr_frame_callback {
 #define WLR_SURFACE_INVALID_SUBSURFACE_POSITION 128
 #define WLR_SURFACE_INVALID_FRAME_CALLBACK_LIST 256
 
+/**
+ * A snapshot of the double-buffered state of a surface. Requests fill the
+ * pending state, which becomes the current state on commit. States are swapped
+ * by pointer, only the fields which haven't been committed are carried over
+ * from the previous current state.
+ *
+ * Damage is stored as received from the client, in surface coordinates for
+ * `surface_damage` and in buffer coordinates for `buffer_damage`. Use
+ * wlr_surface_get_effective_damage and wlr_surface_get_buffer_damage to get
+ * the whole damage in either coordinate space.
+ */
 struct wlr_surface_state {
-	uint32_t invalid;
+	uint32_t invalid; // WLR_SURFACE_INVALID_*, the fields that were committed
 	struct wl_resource *buffer;
 	struct wl_listener buffer_destroy_listener;
 	int32_t sx, sy;
@@ -47,7 +58,7 @@ struct wlr_subsurface {
 	struct wlr_surface *surface;
 	struct wlr_surface *parent;
 
-	struct wlr_surface_state *cached;
+	struct wlr_surface_state *cached; // commits waiting for the parent
 	bool has_cache;
 
 	bool synchronized;
@@ -63,6 +74,14 @@ struct wlr_subsurface {
 	} events;
 };
 
+enum wlr_surface_damage_check {
+	WLR_SURFACE_DAMAGE_CHECK_NONE,
+	// Count the damaged pixels which actually changed
+	WLR_SURFACE_DAMAGE_CHECK_REPORT,
+	// Also drop the damage of tiles which didn't change
+	WLR_SURFACE_DAMAGE_CHECK_SHRINK,
+};
+
 struct wlr_surface {
 	struct wl_resource *resource;
 	struct wlr_renderer *renderer;
@@ -73,6 +92,31 @@ struct wlr_surface {
 	float buffer_to_surface_matrix[16];
 	float surface_to_buffer_matrix[16];
 
+	// If set, committed buffers are uploaded when wlr_surface_get_texture is
+	// called rather than on commit
+	bool defer_upload;
+	struct {
+		struct wl_resource *buffer; // committed, not uploaded yet
+		struct wl_listener buffer_destroy;
+		pixman_region32_t damage; // buffer coordinates
+		bool full; // the whole buffer needs to be uploaded
+	} upload;
+	// Bytes copied to the texture so far, DMA-BUF and EGL buffers aren't
+	// copied
+	uint64_t upload_bytes;
+
+	// If set, the damage of committed shm buffers is compared with their
+	// contents. This keeps a copy of the last buffer.
+	enum wlr_surface_damage_check damage_check;
+	struct {
+		uint8_t *data;
+		int32_t width, height, stride;
+	} shadow;
+	struct {
+		uint64_t claimed; // damaged pixels, in buffer coordinates
+		uint64_t changed; // damaged pixels which actually changed
+	} damage_stats;
+
 	struct {
 		struct wl_signal commit;
 		struct wl_signal new_subsurface;
@@ -112,6 +156,27 @@ void wlr_surface_get_matrix(struct wlr_surface *surface,
 		const float (*projection)[16],
 		const float (*transform)[16]);
 
+/**
+ * Get the damage of the last commit in surface-local coordinates. This
+ * includes the buffer damage converted to surface coordinates, and damage
+ * induced by resizing and moving the surface.
+ */
+void wlr_surface_get_effective_damage(struct wlr_surface *surface,
+		pixman_region32_t *damage);
+
+/**
+ * Get the damage of the last commit in buffer coordinates. This includes the
+ * surface damage converted to buffer coordinates.
+ */
+void wlr_surface_get_buffer_damage(struct wlr_surface *surface,
+		pixman_region32_t *damage);
+
+
+/**
+ * Get the texture of this surface, to render it. If uploads are deferred, this
+ * uploads the damaged parts of the last committed buffer and releases it.
+ */
+struct wlr_texture *wlr_surface_get_texture(struct wlr_surface *surface);
 
 /**
  * Set the lifetime role for this surface. Returns 0 on success or -1 if the
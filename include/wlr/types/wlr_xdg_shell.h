@@ -113,6 +113,9 @@ struct wlr_xdg_surface {
 	struct wl_event_source *configure_idle;
 	uint32_t configure_next_serial;
 	struct wl_list configure_list;
+	// A configure is waiting for the client to ack the previous ones
+	bool configure_throttled;
+	struct wl_list configure_free_list; // unused configure records
 
 	char *title;
 	char *app_id;
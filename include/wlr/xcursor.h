@@ -50,14 +50,20 @@ struct wlr_xcursor {
 	uint32_t total_delay; /* length of the animation in ms */
 };
 
+struct wlr_xcursor_theme_index;
+
 /**
  * Container for an Xcursor theme.
  */
 struct wlr_xcursor_theme {
 	unsigned int cursor_count;
-	struct wlr_xcursor **cursors;
+	struct wlr_xcursor **cursors; // cursors looked up so far
 	char *name;
 	int size;
+
+	// private state
+
+	struct wlr_xcursor_theme_index *index; // shared with sibling themes
 };
 
 /**
@@ -66,9 +72,21 @@ struct wlr_xcursor_theme {
  * client-side cursors is not available or you wish to override client-side
  * cursors for a particular UI interaction (such as using a grab cursor when
  * moving a window around).
+ *
+ * Only the list of available cursors is built here. Cursor files are mapped
+ * and decoded the first time they are requested with
+ * wlr_xcursor_theme_get_cursor.
  */
 struct wlr_xcursor_theme *wlr_xcursor_theme_load(const char *name, int size);
 
+/**
+ * Loads the same xcursor theme as the given one at another cursor size. The
+ * new theme shares its cursor index with the original one, and cursor images
+ * are decoded only once for all themes resolving to the same nominal size.
+ */
+struct wlr_xcursor_theme *wlr_xcursor_theme_load_sibling(
+	struct wlr_xcursor_theme *theme, int size);
+
 void wlr_xcursor_theme_destroy(struct wlr_xcursor_theme *theme);
 
 /**
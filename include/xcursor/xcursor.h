@@ -26,6 +26,8 @@
 #ifndef XCURSOR_H
 #define XCURSOR_H
 
+#include <stddef.h>
+
 typedef int		XcursorBool;
 typedef unsigned int	XcursorUInt;
 
@@ -58,8 +60,34 @@ XcursorLibraryLoadImages (const char *file, const char *theme, int size);
 void
 XcursorImagesDestroy (XcursorImages *images);
 
+struct _XcursorFileHeader;
+
+/*
+ * A cursor file mapped into memory. Only the file header is parsed when the
+ * file is opened, images are decoded on demand.
+ */
+struct xcursor_mapped_file {
+	const unsigned char *data;
+	size_t size;
+	size_t pos;
+	struct _XcursorFileHeader *header;
+};
+
+int
+xcursor_mapped_file_open(struct xcursor_mapped_file *file, const char *path);
+
+void
+xcursor_mapped_file_close(struct xcursor_mapped_file *file);
+
+XcursorDim
+xcursor_mapped_file_best_size(struct xcursor_mapped_file *file, int size);
+
+XcursorImages *
+xcursor_mapped_file_load_images(struct xcursor_mapped_file *file,
+		XcursorDim nominal_size);
+
 void
-xcursor_load_theme(const char *theme, int size,
-		    void (*load_callback)(XcursorImages *, void *),
-		    void *user_data);
+xcursor_index_theme(const char *theme,
+		void (*index_callback)(const char *, const char *, void *),
+		void *user_data);
 #endif
@@ -105,8 +105,92 @@ static void init_globals() {
 	init_default_shaders();
 }
 
+static void set_gamma_uniforms(GLuint program, bool enabled) {
+	if (program == 0) {
+		return;
+	}
+	GL_CALL(glUseProgram(program));
+	GL_CALL(glUniform1i(glGetUniformLocation(program, "gamma"), enabled));
+	GL_CALL(glUniform1i(glGetUniformLocation(program, "gamma_lut"), 1));
+}
+
+static void upload_gamma_lut(struct wlr_gles2_renderer *renderer,
+		struct wlr_output *output) {
+	uint32_t size = output->gamma.size;
+	uint8_t data[4 * size];
+	for (uint32_t i = 0; i < size; ++i) {
+		data[4 * i] = output->gamma.r[i] >> 8;
+		data[4 * i + 1] = output->gamma.g[i] >> 8;
+		data[4 * i + 2] = output->gamma.b[i] >> 8;
+		data[4 * i + 3] = 0xFF;
+	}
+
+	GL_CALL(glActiveTexture(GL_TEXTURE1));
+	if (renderer->gamma_tex == 0) {
+		GL_CALL(glGenTextures(1, &renderer->gamma_tex));
+		GL_CALL(glBindTexture(GL_TEXTURE_2D, renderer->gamma_tex));
+		GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+			GL_LINEAR));
+		GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,
+			GL_LINEAR));
+		GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,
+			GL_CLAMP_TO_EDGE));
+		GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,
+			GL_CLAMP_TO_EDGE));
+	}
+	GL_CALL(glBindTexture(GL_TEXTURE_2D, renderer->gamma_tex));
+	GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size, 1, 0, GL_RGBA,
+		GL_UNSIGNED_BYTE, data));
+	GL_CALL(glActiveTexture(GL_TEXTURE0));
+
+	if (renderer->gamma_output != output) {
+		if (renderer->gamma_output != NULL) {
+			wl_list_remove(&renderer->gamma_output_destroy.link);
+		}
+		renderer->gamma_output = output;
+		wl_signal_add(&output->events.destroy,
+			&renderer->gamma_output_destroy);
+	}
+	renderer->gamma_serial = output->gamma.serial;
+}
+
+static void handle_gamma_output_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_gles2_renderer *renderer =
+		wl_container_of(listener, renderer, gamma_output_destroy);
+	wl_list_remove(&renderer->gamma_output_destroy.link);
+	renderer->gamma_output = NULL;
+}
+
+/**
+ * Applies the gamma ramps of outputs without a hardware LUT in the shaders.
+ * Outputs with a hardware LUT don't pay for it.
+ */
+static void update_gamma(struct wlr_gles2_renderer *renderer,
+		struct wlr_output *output) {
+	bool gamma = output->gamma.software && output->gamma.size > 0;
+	if (gamma && (renderer->gamma_output != output ||
+			renderer->gamma_serial != output->gamma.serial)) {
+		upload_gamma_lut(renderer, output);
+	}
+
+	if (shaders.gamma != gamma) {
+		set_gamma_uniforms(shaders.rgba, gamma);
+		set_gamma_uniforms(shaders.rgbx, gamma);
+		set_gamma_uniforms(shaders.quad, gamma);
+		set_gamma_uniforms(shaders.ellipse, gamma);
+		set_gamma_uniforms(shaders.external, gamma);
+		shaders.gamma = gamma;
+	}
+}
+
 static void wlr_gles2_begin(struct wlr_renderer *wlr_renderer,
 		struct wlr_output *output) {
+	struct wlr_gles2_renderer *renderer =
+		(struct wlr_gles2_renderer *)wlr_renderer;
+	renderer->output = output;
+	update_gamma(renderer, output);
+
 	GL_CALL(glViewport(0, 0, output->width, output->height));
 
 	// enable transparency
@@ -118,12 +202,34 @@ static void wlr_gles2_begin(struct wlr_renderer *wlr_renderer,
 }
 
 static void wlr_gles2_end(struct wlr_renderer *wlr_renderer) {
-	// no-op
+	struct wlr_gles2_renderer *renderer =
+		(struct wlr_gles2_renderer *)wlr_renderer;
+	renderer->output = NULL;
+}
+
+static float gamma_ramp_apply(const uint16_t *ramp, uint32_t size,
+		float value) {
+	if (value <= 0) {
+		return ramp[0] / 65535.0f;
+	} else if (value >= 1) {
+		return ramp[size - 1] / 65535.0f;
+	}
+	return ramp[(uint32_t)(value * (size - 1) + 0.5f)] / 65535.0f;
 }
 
 static void wlr_gles2_clear(struct wlr_renderer *wlr_renderer,
 		const float (*color)[4]) {
-	glClearColor((*color)[0], (*color)[1], (*color)[2], (*color)[3]);
+	struct wlr_gles2_renderer *renderer =
+		(struct wlr_gles2_renderer *)wlr_renderer;
+	float r = (*color)[0], g = (*color)[1], b = (*color)[2];
+	if (shaders.gamma && renderer->output != NULL) {
+		// Clearing doesn't go through the shaders
+		struct wlr_output *output = renderer->output;
+		r = gamma_ramp_apply(output->gamma.r, output->gamma.size, r);
+		g = gamma_ramp_apply(output->gamma.g, output->gamma.size, g);
+		b = gamma_ramp_apply(output->gamma.b, output->gamma.size, b);
+	}
+	glClearColor(r, g, b, (*color)[3]);
 	glClear(GL_COLOR_BUFFER_BIT);
 }
 
@@ -275,6 +381,7 @@ struct wlr_renderer *wlr_gles2_renderer_create(struct wlr_backend *backend) {
 	wlr_renderer_init(&renderer->wlr_renderer, &wlr_renderer_impl);
 
 	renderer->egl = wlr_backend_get_egl(backend);
+	renderer->gamma_output_destroy.notify = handle_gamma_output_destroy;
 
 	return &renderer->wlr_renderer;
 }
@@ -1,6 +1,18 @@
 #include <GLES2/gl2.h>
 #include "render/gles2.h"
 
+// Software gamma ramps, looked up in a 256x1 texture
+#define GAMMA_SRC \
+"uniform bool gamma;" \
+"uniform sampler2D gamma_lut;" \
+"vec4 apply_gamma(vec4 c) {" \
+"  if (!gamma) return c;" \
+"  vec3 i = c.rgb * (255.0 / 256.0) + 0.5 / 256.0;" \
+"  return vec4(texture2D(gamma_lut, vec2(i.r, 0.5)).r," \
+"    texture2D(gamma_lut, vec2(i.g, 0.5)).g," \
+"    texture2D(gamma_lut, vec2(i.b, 0.5)).b, c.a);" \
+"}"
+
 // Colored quads
 const GLchar quad_vertex_src[] =
 "uniform mat4 proj;"
@@ -32,8 +44,9 @@ const GLchar quad_fragment_src[] =
 "precision mediump float;"
 "varying vec4 v_color;"
 "varying vec2 v_texcoord;"
+GAMMA_SRC
 "void main() {"
-"  gl_FragColor = v_color;"
+"  gl_FragColor = apply_gamma(v_color);"
 "}";
 
 // Colored ellipses
@@ -41,10 +54,11 @@ const GLchar ellipse_fragment_src[] =
 "precision mediump float;"
 "varying vec4 v_color;"
 "varying vec2 v_texcoord;"
+GAMMA_SRC
 "void main() {"
 "  float l = length(v_texcoord - vec2(0.5, 0.5));"
 "  if (l > 0.5) discard;"
-"  gl_FragColor = v_color;"
+"  gl_FragColor = apply_gamma(v_color);"
 "}";
 
 // Textured quads
@@ -77,8 +91,9 @@ const GLchar fragment_src_rgba[] =
 "varying vec2 v_texcoord;"
 "uniform sampler2D tex;"
 "uniform float alpha;"
+GAMMA_SRC
 "void main() {"
-"	gl_FragColor = alpha * texture2D(tex, v_texcoord);"
+"	gl_FragColor = apply_gamma(alpha * texture2D(tex, v_texcoord));"
 "}";
 
 const GLchar fragment_src_rgbx[] =
@@ -86,9 +101,10 @@ const GLchar fragment_src_rgbx[] =
 "varying vec2 v_texcoord;"
 "uniform sampler2D tex;"
 "uniform float alpha;"
+GAMMA_SRC
 "void main() {"
-"   gl_FragColor.rgb = alpha * texture2D(tex, v_texcoord).rgb;"
-"   gl_FragColor.a = alpha;"
+"   gl_FragColor = apply_gamma(vec4(alpha * texture2D(tex, v_texcoord).rgb,"
+"      alpha));"
 "}";
 
 const GLchar fragment_src_external[] =
@@ -96,7 +112,8 @@ const GLchar fragment_src_external[] =
 "precision mediump float;"
 "varying vec2 v_texcoord;"
 "uniform samplerExternalOES texture0;"
+GAMMA_SRC
 "void main() {"
 "  vec4 col = texture2D(texture0, v_texcoord);"
-"  gl_FragColor = vec4(col.rgb, col.a);"
+"  gl_FragColor = apply_gamma(vec4(col.rgb, col.a));"
 "}";
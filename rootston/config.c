@@ -19,13 +19,15 @@
 
 static void usage(const char *name, int ret) {
 	fprintf(stderr,
-		"usage: %s [-C <FILE>] [-E <COMMAND>]\n"
+		"usage: %s [-C <FILE>] [-E <COMMAND>] [-R <FILE>]\n"
 		"\n"
 		" -C <FILE>      Path to the configuration file\n"
 		"                (default: rootston.ini).\n"
 		"                See `rootston.ini.example` for config\n"
 		"                file documentation.\n"
-		" -E <COMMAND>   Command that will be ran at startup.\n" , name);
+		" -E <COMMAND>   Command that will be ran at startup.\n"
+		" -R <FILE>      Record input events to this file. Set\n"
+		"                WLR_REPLAY to the file to play them back.\n" , name);
 
 	exit(ret);
 }
@@ -243,6 +245,24 @@ static int config_ini_handler(void *user, const char *section, const char *name,
 			} else {
 				wlr_log(L_ERROR, "got unknown xwayland value: %s", value);
 			}
+		} else if (strcmp(name, "debug-overlay") == 0) {
+			if (strcasecmp(value, "true") == 0) {
+				config->debug_overlay = true;
+			} else if (strcasecmp(value, "false") == 0) {
+				config->debug_overlay = false;
+			} else {
+				wlr_log(L_ERROR, "got unknown debug-overlay value: %s", value);
+			}
+		} else if (strcmp(name, "damage-check") == 0) {
+			if (strcasecmp(value, "none") == 0) {
+				config->damage_check = WLR_SURFACE_DAMAGE_CHECK_NONE;
+			} else if (strcasecmp(value, "report") == 0) {
+				config->damage_check = WLR_SURFACE_DAMAGE_CHECK_REPORT;
+			} else if (strcasecmp(value, "shrink") == 0) {
+				config->damage_check = WLR_SURFACE_DAMAGE_CHECK_SHRINK;
+			} else {
+				wlr_log(L_ERROR, "got unknown damage-check value: %s", value);
+			}
 		} else {
 			wlr_log(L_ERROR, "got unknown core config: %s", name);
 		}
@@ -302,6 +322,15 @@ static int config_ini_handler(void *user, const char *section, const char *name,
 			} else {
 				wlr_log(L_ERROR, "got unknown transform value: %s", value);
 			}
+		} else if (strcmp(name, "adaptive-sync") == 0) {
+			if (strcasecmp(value, "true") == 0) {
+				oc->adaptive_sync = true;
+			} else if (strcasecmp(value, "false") == 0) {
+				oc->adaptive_sync = false;
+			} else {
+				wlr_log(L_ERROR, "got invalid output adaptive-sync value: %s",
+					value);
+			}
 		} else if (strcmp(name, "mode") == 0) {
 			char *end;
 			oc->mode.width = strtol(value, &end, 10);
@@ -394,7 +423,7 @@ struct roots_config *roots_config_create_from_args(int argc, char *argv[]) {
 	wl_list_init(&config->bindings);
 
 	int c;
-	while ((c = getopt(argc, argv, "C:E:h")) != -1) {
+	while ((c = getopt(argc, argv, "C:E:R:h")) != -1) {
 		switch (c) {
 		case 'C':
 			config->config_path = strdup(optarg);
@@ -402,6 +431,9 @@ struct roots_config *roots_config_create_from_args(int argc, char *argv[]) {
 		case 'E':
 			config->startup_cmd = strdup(optarg);
 			break;
+		case 'R':
+			config->record_path = strdup(optarg);
+			break;
 		case 'h':
 		case '?':
 			usage(argv[0], c != 'h');
@@ -489,6 +521,7 @@ void roots_config_destroy(struct roots_config *config) {
 	}
 
 	free(config->config_path);
+	free(config->record_path);
 	free(config);
 }
 
@@ -1,5 +1,6 @@
 #define _POSIX_C_SOURCE 199309L
 #include <assert.h>
+#include <inttypes.h>
 #include <math.h>
 #include <stdlib.h>
 #include <time.h>
@@ -10,6 +11,7 @@
 #include <wlr/types/wlr_gamma_control.h>
 #include <wlr/types/wlr_idle.h>
 #include <wlr/types/wlr_output_layout.h>
+#include <wlr/types/wlr_output_power.h>
 #include <wlr/types/wlr_primary_selection.h>
 #include <wlr/types/wlr_server_decoration.h>
 #include <wlr/types/wlr_wl_shell.h>
@@ -19,9 +21,12 @@
 #include <wlr/util/log.h>
 #include "rootston/seat.h"
 #include "rootston/server.h"
+#include "rootston/transaction.h"
 #include "rootston/view.h"
 #include "rootston/xcursor.h"
 
+#define DAMAGE_CHECK_REPORT_INTERVAL 10000 // ms
+
 void view_get_box(const struct roots_view *view, struct wlr_box *box) {
 	box->x = view->x;
 	box->y = view->y;
@@ -152,6 +157,18 @@ void view_move_resize(struct roots_view *view, double x, double y,
 	view_resize(view, width, height);
 }
 
+/**
+ * Moves and resizes a view, and presents its new geometry only once the
+ * client has drawn it.
+ */
+static void view_move_resize_atomic(struct roots_view *view, double x, double y,
+		uint32_t width, uint32_t height) {
+	struct roots_transaction *transaction =
+		roots_transaction_create(view->desktop);
+	roots_transaction_move_resize(transaction, view, x, y, width, height);
+	roots_transaction_commit(transaction);
+}
+
 static struct wlr_output *view_get_output(struct roots_view *view) {
 	struct wlr_box view_box;
 	view_get_box(view, &view_box);
@@ -189,16 +206,16 @@ void view_maximize(struct roots_view *view, bool maximized) {
 		struct wlr_box *output_box =
 			wlr_output_layout_get_box(view->desktop->layout, output);
 
-		view_move_resize(view, output_box->x, output_box->y, output_box->width,
-			output_box->height);
+		view_move_resize_atomic(view, output_box->x, output_box->y,
+			output_box->width, output_box->height);
 		view_rotate(view, 0);
 	}
 
 	if (view->maximized && !maximized) {
 		view->maximized = false;
 
-		view_move_resize(view, view->saved.x, view->saved.y, view->saved.width,
-			view->saved.height);
+		view_move_resize_atomic(view, view->saved.x, view->saved.y,
+			view->saved.width, view->saved.height);
 		view_rotate(view, view->saved.rotation);
 	}
 }
@@ -238,8 +255,8 @@ void view_set_fullscreen(struct roots_view *view, bool fullscreen,
 
 		struct wlr_box *output_box =
 			wlr_output_layout_get_box(view->desktop->layout, output);
-		view_move_resize(view, output_box->x, output_box->y, output_box->width,
-			output_box->height);
+		view_move_resize_atomic(view, output_box->x, output_box->y,
+			output_box->width, output_box->height);
 		view_rotate(view, 0);
 
 		roots_output->fullscreen_view = view;
@@ -248,8 +265,8 @@ void view_set_fullscreen(struct roots_view *view, bool fullscreen,
 	}
 
 	if (was_fullscreen && !fullscreen) {
-		view_move_resize(view, view->saved.x, view->saved.y, view->saved.width,
-			view->saved.height);
+		view_move_resize_atomic(view, view->saved.x, view->saved.y,
+			view->saved.width, view->saved.height);
 		view_rotate(view, view->saved.rotation);
 
 		output_damage_whole(view->fullscreen_output);
@@ -597,17 +614,101 @@ static void handle_layout_change(struct wl_listener *listener, void *data) {
 	double center_x = center_output_box->x + center_output_box->width/2;
 	double center_y = center_output_box->y + center_output_box->height/2;
 
+	// Maximized and fullscreen views follow their output, resize them all at
+	// once
+	struct roots_transaction *transaction = roots_transaction_create(desktop);
+
 	struct roots_view *view;
 	wl_list_for_each(view, &desktop->views, link) {
 		struct wlr_box box;
 		view_get_box(view, &box);
 
+		struct wlr_output *output = NULL;
+		if (view->fullscreen_output != NULL) {
+			output = view->fullscreen_output->wlr_output;
+		} else if (view->maximized) {
+			output = view_get_output(view);
+		}
+		struct wlr_box *output_box = output != NULL ?
+			wlr_output_layout_get_box(desktop->layout, output) : NULL;
+		if (output_box != NULL) {
+			if (output_box->x != view->x || output_box->y != view->y ||
+					output_box->width != box.width ||
+					output_box->height != box.height) {
+				roots_transaction_move_resize(transaction, view,
+					output_box->x, output_box->y,
+					output_box->width, output_box->height);
+			}
+			continue;
+		}
+
 		if (wlr_output_layout_intersects(desktop->layout, NULL, &box)) {
 			continue;
 		}
 
 		view_move(view, center_x - box.width/2, center_y - box.height/2);
 	}
+
+	roots_transaction_commit(transaction);
+}
+
+/**
+ * Logs how many of the pixels damaged by each client actually changed, and
+ * resets the statistics.
+ */
+static int handle_damage_check_timer(void *data) {
+	struct roots_desktop *desktop = data;
+	struct wl_list *surfaces = &desktop->compositor->surfaces;
+
+	struct wl_resource *resource;
+	wl_resource_for_each(resource, surfaces) {
+		struct wl_client *client = wl_resource_get_client(resource);
+
+		// Only report each client once, from its first surface
+		bool reported = false;
+		struct wl_resource *prev;
+		wl_resource_for_each(prev, surfaces) {
+			if (prev == resource) {
+				break;
+			}
+			if (wl_resource_get_client(prev) == client) {
+				reported = true;
+				break;
+			}
+		}
+		if (reported) {
+			continue;
+		}
+
+		uint64_t claimed = 0, changed = 0;
+		struct wl_resource *other;
+		wl_resource_for_each(other, surfaces) {
+			if (wl_resource_get_client(other) == client) {
+				struct wlr_surface *surface =
+					wlr_surface_from_resource(other);
+				claimed += surface->damage_stats.claimed;
+				changed += surface->damage_stats.changed;
+			}
+		}
+		if (claimed == 0) {
+			continue;
+		}
+
+		pid_t pid;
+		wl_client_get_credentials(client, &pid, NULL, NULL);
+		wlr_log(L_INFO, "Client %d damaged %"PRIu64" pixels, %"PRIu64
+			" changed (%"PRIu64"%%)", pid, claimed, changed,
+			changed * 100 / claimed);
+	}
+
+	wl_resource_for_each(resource, surfaces) {
+		struct wlr_surface *surface = wlr_surface_from_resource(resource);
+		surface->damage_stats.claimed = surface->damage_stats.changed = 0;
+	}
+
+	wl_event_source_timer_update(desktop->damage_check_timer,
+		DAMAGE_CHECK_REPORT_INTERVAL);
+	return 0;
 }
 
 struct roots_desktop *desktop_create(struct roots_server *server,
@@ -621,12 +722,14 @@ struct roots_desktop *desktop_create(struct roots_server *server,
 
 	wl_list_init(&desktop->views);
 	wl_list_init(&desktop->outputs);
+	wl_list_init(&desktop->transactions);
 
 	desktop->new_output.notify = handle_new_output;
 	wl_signal_add(&server->backend->events.new_output, &desktop->new_output);
 
 	desktop->server = server;
 	desktop->config = config;
+	desktop->debug_overlay = config->debug_overlay;
 
 	desktop->layout = wlr_output_layout_create();
 	desktop->layout_change.notify = handle_layout_change;
@@ -634,6 +737,21 @@ struct roots_desktop *desktop_create(struct roots_server *server,
 
 	desktop->compositor = wlr_compositor_create(server->wl_display,
 		server->renderer);
+	// Only upload buffers of surfaces which are actually rendered
+	desktop->compositor->defer_texture_uploads = true;
+	desktop->frame_scheduler = wlr_frame_scheduler_create(server->wl_display,
+		desktop->compositor);
+	desktop->compositor->damage_check = config->damage_check;
+	if (config->damage_check != WLR_SURFACE_DAMAGE_CHECK_NONE) {
+		struct wl_event_loop *loop =
+			wl_display_get_event_loop(server->wl_display);
+		desktop->damage_check_timer = wl_event_loop_add_timer(loop,
+			handle_damage_check_timer, desktop);
+		if (desktop->damage_check_timer != NULL) {
+			wl_event_source_timer_update(desktop->damage_check_timer,
+				DAMAGE_CHECK_REPORT_INTERVAL);
+		}
+	}
 
 	desktop->xdg_shell_v6 = wlr_xdg_shell_v6_create(server->wl_display);
 	wl_signal_add(&desktop->xdg_shell_v6->events.new_surface,
@@ -694,6 +812,8 @@ struct roots_desktop *desktop_create(struct roots_server *server,
 
 	desktop->gamma_control_manager = wlr_gamma_control_manager_create(
 		server->wl_display);
+	desktop->output_power_manager = wlr_output_power_manager_create(
+		server->wl_display);
 	desktop->screenshooter = wlr_screenshooter_create(server->wl_display);
 	desktop->server_decoration_manager =
 		wlr_server_decoration_manager_create(server->wl_display);
@@ -62,6 +62,10 @@ static void handle_new_input(struct wl_listener *listener, void *data) {
 
 	roots_seat_add_device(seat, device);
 
+	if (input->recorder) {
+		wlr_input_recorder_add_device(input->recorder, device);
+	}
+
 	if (dc && wlr_input_device_is_libinput(device)) {
 		struct libinput_device *libinput_dev =
 			wlr_libinput_get_device_handle(device);
@@ -89,6 +93,11 @@ struct roots_input *input_create(struct roots_server *server,
 
 	wl_list_init(&input->seats);
 
+	if (config->record_path) {
+		input->recorder = wlr_input_recorder_create(server->wl_display,
+			config->record_path);
+	}
+
 	input->new_input.notify = handle_new_input;
 	wl_signal_add(&server->backend->events.new_input, &input->new_input);
 
@@ -2,6 +2,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <wayland-server.h>
 #include <wlr/backend/multi.h>
@@ -128,6 +129,13 @@ static void keyboard_binding_execute(struct roots_keyboard *keyboard,
 		wl_list_for_each(output, &keyboard->input->server->desktop->outputs, link) {
 			wlr_output_enable(output->wlr_output, outputs_enabled);
 		}
+	} else if (strcmp(command, "toggle_debug_overlay") == 0) {
+		struct roots_desktop *desktop = keyboard->input->server->desktop;
+		desktop->debug_overlay = !desktop->debug_overlay;
+		struct roots_output *output;
+		wl_list_for_each(output, &desktop->outputs, link) {
+			output_damage_whole(output);
+		}
 	} else {
 		wlr_log(L_ERROR, "unknown binding command: %s", command);
 	}
@@ -327,6 +335,61 @@ static void keyboard_config_merge(struct roots_keyboard_config *config,
 	}
 }
 
+static bool config_str_equal(const char *a, const char *b) {
+	if (a == NULL || b == NULL) {
+		return a == b;
+	}
+	return strcmp(a, b) == 0;
+}
+
+/**
+ * Finds the keymap of a keyboard with the same RMLVO names, so that it doesn't
+ * need to be compiled again.
+ */
+static struct xkb_keymap *find_keymap(struct roots_input *input,
+		struct roots_keyboard_config *config) {
+	struct roots_seat *seat;
+	wl_list_for_each(seat, &input->seats, link) {
+		struct roots_keyboard *keyboard;
+		wl_list_for_each(keyboard, &seat->keyboards, link) {
+			struct roots_keyboard_config *other = keyboard->config;
+			if (keyboard->device->keyboard->keymap != NULL &&
+					config_str_equal(config->rules, other->rules) &&
+					config_str_equal(config->model, other->model) &&
+					config_str_equal(config->layout, other->layout) &&
+					config_str_equal(config->variant, other->variant) &&
+					config_str_equal(config->options, other->options)) {
+				return keyboard->device->keyboard->keymap;
+			}
+		}
+	}
+	return NULL;
+}
+
+static struct xkb_keymap *compile_keymap(
+		struct roots_keyboard_config *config) {
+	struct xkb_rule_names rules = { 0 };
+	rules.rules = config->rules;
+	rules.model = config->model;
+	rules.layout = config->layout;
+	rules.variant = config->variant;
+	rules.options = config->options;
+	struct xkb_context *context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+	if (context == NULL) {
+		wlr_log(L_ERROR, "Cannot create XKB context");
+		return NULL;
+	}
+
+	struct xkb_keymap *keymap = xkb_map_new_from_names(context, &rules,
+		XKB_KEYMAP_COMPILE_NO_FLAGS);
+	xkb_context_unref(context);
+	if (keymap == NULL) {
+		wlr_log(L_ERROR, "Cannot create XKB keymap");
+		return NULL;
+	}
+	return keymap;
+}
+
 struct roots_keyboard *roots_keyboard_create(struct wlr_input_device *device,
 		struct roots_input *input) {
 	struct roots_keyboard *keyboard = calloc(sizeof(struct roots_keyboard), 1);
@@ -356,29 +419,18 @@ struct roots_keyboard *roots_keyboard_create(struct wlr_input_device *device,
 	keyboard_config_merge(config, &env_config);
 	keyboard->config = config;
 
-	struct xkb_rule_names rules = { 0 };
-	rules.rules = config->rules;
-	rules.model = config->model;
-	rules.layout = config->layout;
-	rules.variant = config->variant;
-	rules.options = config->options;
-	struct xkb_context *context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
-	if (context == NULL) {
-		wlr_log(L_ERROR, "Cannot create XKB context");
-		return NULL;
-	}
-
-	struct xkb_keymap *keymap = xkb_map_new_from_names(context, &rules,
-		XKB_KEYMAP_COMPILE_NO_FLAGS);
-	if (keymap == NULL) {
-		xkb_context_unref(context);
-		wlr_log(L_ERROR, "Cannot create XKB keymap");
-		return NULL;
+	struct xkb_keymap *keymap = find_keymap(input, config);
+	if (keymap != NULL) {
+		xkb_keymap_ref(keymap);
+	} else {
+		keymap = compile_keymap(config);
+		if (keymap == NULL) {
+			return NULL;
+		}
 	}
 
 	wlr_keyboard_set_keymap(device->keyboard, keymap);
 	xkb_keymap_unref(keymap);
-	xkb_context_unref(context);
 
 	int repeat_rate = (config->repeat_rate > 0) ? config->repeat_rate : 25;
 	int repeat_delay = (config->repeat_delay > 0) ? config->repeat_delay : 600;
@@ -14,6 +14,12 @@
 #include "rootston/config.h"
 #include "rootston/output.h"
 #include "rootston/server.h"
+#include "rootston/transaction.h"
+
+#define DEBUG_GRAPH_BAR_WIDTH 2
+#define DEBUG_GRAPH_HEIGHT 100
+#define DEBUG_GRAPH_NSEC_PER_PIXEL 250000 // full height is 25ms
+#define DEBUG_FLASH_DURATION 100 // ms
 
 typedef void (*surface_iterator_func_t)(struct wlr_surface *surface,
 	double lx, double ly, float rotation, void *data);
@@ -185,7 +191,6 @@ static void xwayland_children_for_each_surface(
 
 struct render_data {
 	struct roots_output *output;
-	struct timespec *when;
 	pixman_region32_t *damage;
 };
 
@@ -239,7 +244,6 @@ static void render_surface(struct wlr_surface *surface, double lx, double ly,
 		float rotation, void *_data) {
 	struct render_data *data = _data;
 	struct roots_output *output = data->output;
-	struct timespec *when = data->when;
 	struct wlr_renderer *renderer =
 		wlr_backend_get_renderer(output->wlr_output->backend);
 	assert(renderer);
@@ -264,7 +268,12 @@ static void render_surface(struct wlr_surface *surface, double lx, double ly,
 		rotated.width, rotated.height);
 	pixman_region32_intersect(&damage, &damage, data->damage);
 	bool damaged = pixman_region32_not_empty(&damage);
+	struct wlr_output_frame_stats *frame_stats =
+		output->stats != NULL ? output->stats->current : NULL;
 	if (!damaged) {
+		if (frame_stats != NULL) {
+			++frame_stats->surfaces_skipped;
+		}
 		goto damage_finish;
 	}
 
@@ -274,15 +283,19 @@ static void render_surface(struct wlr_surface *surface, double lx, double ly,
 	wlr_matrix_project_box(&matrix, &box, transform, rotation,
 		&output->wlr_output->transform_matrix);
 
+	uint64_t upload_bytes = surface->upload_bytes;
+	struct wlr_texture *texture = wlr_surface_get_texture(surface);
+	if (frame_stats != NULL) {
+		++frame_stats->surfaces_drawn;
+		frame_stats->upload_bytes += surface->upload_bytes - upload_bytes;
+	}
 	int nrects;
 	pixman_box32_t *rects = pixman_region32_rectangles(&damage, &nrects);
 	for (int i = 0; i < nrects; ++i) {
 		scissor_output(output, &rects[i]);
-		wlr_render_with_matrix(renderer, surface->texture, &matrix);
+		wlr_render_with_matrix(renderer, texture, &matrix);
 	}
 
-	wlr_surface_send_frame_done(surface, when);
-
 damage_finish:
 	pixman_region32_fini(&damage);
 }
@@ -384,6 +397,236 @@ static bool has_standalone_surface(struct roots_view *view) {
 	return true;
 }
 
+struct frame_data {
+	struct roots_output *output;
+	pixman_region32_t *occluded; // layout coordinates, may be NULL
+};
+
+static void mark_surface_visible(struct wlr_surface *surface,
+		double lx, double ly, float rotation, void *_data) {
+	struct frame_data *data = _data;
+	struct roots_output *output = data->output;
+	struct roots_desktop *desktop = output->desktop;
+
+	if (!wlr_surface_has_buffer(surface)) {
+		return;
+	}
+
+	struct wlr_box box;
+	bool intersects = surface_intersect_output(surface, desktop->layout,
+		output->wlr_output, lx, ly, rotation, &box);
+	if (!intersects) {
+		return;
+	}
+
+	if (data->occluded != NULL) {
+		pixman_region32_t visible;
+		pixman_region32_init_rect(&visible, lx, ly,
+			surface->current->width, surface->current->height);
+		pixman_region32_subtract(&visible, &visible, data->occluded);
+		bool occluded = !pixman_region32_not_empty(&visible);
+		pixman_region32_fini(&visible);
+		if (occluded) {
+			return;
+		}
+	}
+
+	wlr_frame_scheduler_surface_visible(desktop->frame_scheduler, surface,
+		output->wlr_output);
+}
+
+static void add_surface_occlusion(struct wlr_surface *surface,
+		double lx, double ly, float rotation, void *_data) {
+	struct frame_data *data = _data;
+
+	if (rotation != 0 || !wlr_surface_has_buffer(surface)) {
+		return;
+	}
+
+	pixman_region32_t opaque;
+	pixman_region32_init(&opaque);
+	pixman_region32_intersect_rect(&opaque, &surface->current->opaque, 0, 0,
+		surface->current->width, surface->current->height);
+	pixman_region32_translate(&opaque, lx, ly);
+	pixman_region32_union(data->occluded, data->occluded, &opaque);
+	pixman_region32_fini(&opaque);
+}
+
+/**
+ * Lets the frame scheduler send frame callbacks to the surfaces visible on this
+ * output, whether they were damaged or not. Surfaces covered by opaque surfaces
+ * of views above them are considered hidden.
+ */
+static void send_frame_done(struct roots_output *output,
+		const struct timespec *when) {
+	struct roots_desktop *desktop = output->desktop;
+	struct roots_server *server = desktop->server;
+
+	struct frame_data data = {
+		.output = output,
+	};
+
+	if (output->fullscreen_view != NULL) {
+		struct roots_view *view = output->fullscreen_view;
+		view_for_each_surface(view, mark_surface_visible, &data);
+#ifdef WLR_HAS_XWAYLAND
+		if (view->type == ROOTS_XWAYLAND_VIEW) {
+			xwayland_children_for_each_surface(view->xwayland_surface,
+				mark_surface_visible, &data);
+		}
+#endif
+		goto frame;
+	}
+
+	struct roots_seat *seat;
+	wl_list_for_each(seat, &server->input->seats, link) {
+		struct roots_drag_icon *drag_icon;
+		wl_list_for_each(drag_icon, &seat->drag_icons, link) {
+			if (!drag_icon->wlr_drag_icon->mapped) {
+				continue;
+			}
+			surface_for_each_surface(drag_icon->wlr_drag_icon->surface,
+				drag_icon->x, drag_icon->y, 0, mark_surface_visible, &data);
+		}
+	}
+
+	pixman_region32_t occluded;
+	pixman_region32_init(&occluded);
+	data.occluded = &occluded;
+
+	// Views are sorted from top to bottom
+	struct roots_view *view;
+	wl_list_for_each(view, &desktop->views, link) {
+		if (view->fullscreen_output != NULL &&
+				view->fullscreen_output != output) {
+			continue;
+		}
+		view_for_each_surface(view, mark_surface_visible, &data);
+		view_for_each_surface(view, add_surface_occlusion, &data);
+	}
+
+	pixman_region32_fini(&occluded);
+
+frame:
+	wlr_frame_scheduler_output_frame(desktop->frame_scheduler,
+		output->wlr_output, when);
+}
+
+static void get_debug_graph_box(struct roots_output *output,
+		struct wlr_box *box) {
+	int ow, oh;
+	wlr_output_transformed_resolution(output->wlr_output, &ow, &oh);
+	box->width = WLR_OUTPUT_STATS_LEN * DEBUG_GRAPH_BAR_WIDTH;
+	box->height = DEBUG_GRAPH_HEIGHT;
+	box->x = 0;
+	box->y = oh - box->height;
+}
+
+static void render_debug_box(struct roots_output *output,
+		struct wlr_box *box, const float (*color)[4]) {
+	struct wlr_renderer *renderer =
+		wlr_backend_get_renderer(output->wlr_output->backend);
+	pixman_box32_t rect = {
+		.x1 = box->x,
+		.y1 = box->y,
+		.x2 = box->x + box->width,
+		.y2 = box->y + box->height,
+	};
+	scissor_output(output, &rect);
+
+	float matrix[16];
+	wlr_matrix_project_box(&matrix, box, WL_OUTPUT_TRANSFORM_NORMAL, 0,
+		&output->wlr_output->transform_matrix);
+	wlr_render_colored_quad(renderer, color, &matrix);
+}
+
+/**
+ * Draws the time spent on the last frames, and flashes the damage clients
+ * submitted since the last frame. `damage` is the region being repainted.
+ */
+static void render_debug_overlay(struct roots_output *output,
+		pixman_region32_t *damage) {
+	struct wlr_output *wlr_output = output->wlr_output;
+
+	// Damage being repainted because of a previous flash isn't flashed again,
+	// so that flashes end
+	pixman_region32_t flash;
+	pixman_region32_init(&flash);
+	pixman_region32_subtract(&flash, &output->damage->current,
+		&output->debug_flash);
+
+	float flash_color[] = { 1.0, 0.0, 1.0, 0.3 };
+	int nrects;
+	pixman_box32_t *rects = pixman_region32_rectangles(&flash, &nrects);
+	for (int i = 0; i < nrects; ++i) {
+		struct wlr_box box = {
+			.x = rects[i].x1,
+			.y = rects[i].y1,
+			.width = rects[i].x2 - rects[i].x1,
+			.height = rects[i].y2 - rects[i].y1,
+		};
+		render_debug_box(output, &box, &flash_color);
+	}
+
+	pixman_region32_subtract(&output->debug_flash, &output->debug_flash,
+		damage);
+	pixman_region32_union(&output->debug_flash, &output->debug_flash, &flash);
+	pixman_region32_fini(&flash);
+	if (output->debug_flash_timer != NULL &&
+			pixman_region32_not_empty(&output->debug_flash)) {
+		wl_event_source_timer_update(output->debug_flash_timer,
+			DEBUG_FLASH_DURATION);
+	}
+
+	struct wlr_box graph_box;
+	get_debug_graph_box(output, &graph_box);
+	float background_color[] = { 0.0, 0.0, 0.0, 0.6 };
+	render_debug_box(output, &graph_box, &background_color);
+
+	float bar_color[] = { 0.2, 0.8, 0.2, 0.8 };
+	float missed_color[] = { 0.9, 0.2, 0.2, 0.8 };
+	for (size_t age = 0; ; ++age) {
+		const struct wlr_output_frame_stats *frame =
+			wlr_output_stats_get_frame(output->stats, age);
+		if (frame == NULL) {
+			break;
+		}
+
+		int64_t height = (frame->render_nsec + frame->swap_nsec) /
+			DEBUG_GRAPH_NSEC_PER_PIXEL;
+		if (height < 1) {
+			height = 1;
+		} else if (height > graph_box.height) {
+			height = graph_box.height;
+		}
+		struct wlr_box bar_box = {
+			.x = graph_box.x + graph_box.width -
+				(age + 1) * DEBUG_GRAPH_BAR_WIDTH,
+			.y = graph_box.y + graph_box.height - height,
+			.width = DEBUG_GRAPH_BAR_WIDTH,
+			.height = height,
+		};
+		render_debug_box(output, &bar_box,
+			frame->missed_vblank ? &missed_color : &bar_color);
+	}
+
+	// Mark the refresh period
+	if (wlr_output->refresh > 0) {
+		int64_t period = (int64_t)1000000000000 / wlr_output->refresh;
+		int y = period / DEBUG_GRAPH_NSEC_PER_PIXEL;
+		if (y < graph_box.height) {
+			struct wlr_box line_box = {
+				.x = graph_box.x,
+				.y = graph_box.y + graph_box.height - y,
+				.width = graph_box.width,
+				.height = 1,
+			};
+			float line_color[] = { 1.0, 1.0, 1.0, 0.8 };
+			render_debug_box(output, &line_box, &line_color);
+		}
+	}
+}
+
 static void render_output(struct roots_output *output) {
 	struct wlr_output *wlr_output = output->wlr_output;
 	struct roots_desktop *desktop = output->desktop;
@@ -398,6 +641,13 @@ static void render_output(struct roots_output *output) {
 	struct timespec now;
 	clock_gettime(CLOCK_MONOTONIC, &now);
 
+	if (roots_transaction_blocks_output(desktop, output)) {
+		// Keep showing the previous state until all views of the transaction
+		// are ready, but let clients draw the new one
+		send_frame_done(output, &now);
+		return;
+	}
+
 	float clear_color[] = {0.25f, 0.25f, 0.25f, 1.0f};
 
 	// Check if we can delegate the fullscreen surface to the output
@@ -439,9 +689,18 @@ static void render_output(struct roots_output *output) {
 		goto damage_finish;
 	}
 
+	bool debug_overlay = desktop->debug_overlay && output->stats != NULL &&
+		wlr_output->fullscreen_surface == NULL;
+	if (debug_overlay) {
+		// The frame time graph is redrawn with each frame
+		struct wlr_box graph_box;
+		get_debug_graph_box(output, &graph_box);
+		pixman_region32_union_rect(&damage, &damage, graph_box.x, graph_box.y,
+			graph_box.width, graph_box.height);
+	}
+
 	struct render_data data = {
 		.output = output,
-		.when = &now,
 		.damage = &damage,
 	};
 
@@ -503,6 +762,9 @@ static void render_output(struct roots_output *output) {
 	}
 
 renderer_end:
+	if (debug_overlay) {
+		render_debug_overlay(output, &damage);
+	}
 	wlr_renderer_scissor(renderer, NULL);
 	wlr_renderer_end(renderer);
 	if (!wlr_output_damage_swap_buffers(output->damage, &now, &damage)) {
@@ -512,6 +774,7 @@ renderer_end:
 
 damage_finish:
 	pixman_region32_fini(&damage);
+	send_frame_done(output, &now);
 }
 
 static void output_damage_handle_frame(struct wl_listener *listener,
@@ -617,10 +880,10 @@ static void damage_from_surface(struct wlr_surface *surface,
 	surface_intersect_output(surface, output->desktop->layout,
 		wlr_output, lx, ly, rotation, &box);
 
+	pixman_region32_t damage;
+	pixman_region32_init(&damage);
+	wlr_surface_get_effective_damage(surface, &damage);
 	if (rotation == 0) {
-		pixman_region32_t damage;
-		pixman_region32_init(&damage);
-		pixman_region32_copy(&damage, &surface->current->surface_damage);
 		wlr_region_scale(&damage, &damage, wlr_output->scale);
 		if (ceil(wlr_output->scale) > surface->current->scale) {
 			// When scaling up a surface, it'll become blurry so we need to
@@ -631,8 +894,7 @@ static void damage_from_surface(struct wlr_surface *surface,
 		pixman_region32_translate(&damage, box.x, box.y);
 		wlr_output_damage_add(output->damage, &damage);
 	} else {
-		pixman_box32_t *extents =
-			pixman_region32_extents(&surface->current->surface_damage);
+		pixman_box32_t *extents = pixman_region32_extents(&damage);
 		struct wlr_box damage_box = {
 			.x = box.x + extents->x1 * wlr_output->scale,
 			.y = box.y + extents->y1 * wlr_output->scale,
@@ -642,6 +904,7 @@ static void damage_from_surface(struct wlr_surface *surface,
 		wlr_box_rotated_bounds(&damage_box, -rotation, &damage_box);
 		wlr_output_damage_add_box(output->damage, &damage_box);
 	}
+	pixman_region32_fini(&damage);
 }
 
 void output_damage_from_view(struct roots_output *output,
@@ -691,9 +954,20 @@ static void output_handle_destroy(struct wl_listener *listener, void *data) {
 	wl_list_remove(&output->link);
 	wl_list_remove(&output->destroy.link);
 	wl_list_remove(&output->frame.link);
+	if (output->debug_flash_timer != NULL) {
+		wl_event_source_remove(output->debug_flash_timer);
+	}
+	pixman_region32_fini(&output->debug_flash);
 	free(output);
 }
 
+static int output_handle_debug_flash_timer(void *data) {
+	struct roots_output *output = data;
+	// Repaint the flashed regions
+	wlr_output_damage_add(output->damage, &output->debug_flash);
+	return 0;
+}
+
 void handle_new_output(struct wl_listener *listener, void *data) {
 	struct roots_desktop *desktop = wl_container_of(listener, desktop,
 		new_output);
@@ -719,6 +993,12 @@ void handle_new_output(struct wl_listener *listener, void *data) {
 	wl_list_insert(&desktop->outputs, &output->link);
 
 	output->damage = wlr_output_damage_create(wlr_output);
+	output->stats = wlr_output_stats_create(output->damage);
+	pixman_region32_init(&output->debug_flash);
+	struct wl_event_loop *loop =
+		wl_display_get_event_loop(desktop->server->wl_display);
+	output->debug_flash_timer = wl_event_loop_add_timer(loop,
+		output_handle_debug_flash_timer, output);
 
 	output->destroy.notify = output_handle_destroy;
 	wl_signal_add(&wlr_output->events.destroy, &output->destroy);
@@ -734,6 +1014,11 @@ void handle_new_output(struct wl_listener *listener, void *data) {
 			}
 			wlr_output_set_scale(wlr_output, output_config->scale);
 			wlr_output_set_transform(wlr_output, output_config->transform);
+			if (output_config->adaptive_sync &&
+					!wlr_output_enable_adaptive_sync(wlr_output, true)) {
+				wlr_log(L_ERROR, "Adaptive sync is not supported by output %s",
+					wlr_output->name);
+			}
 			wlr_output_layout_add(desktop->layout, wlr_output, output_config->x,
 				output_config->y);
 		} else {
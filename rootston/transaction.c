@@ -0,0 +1,238 @@
+#include <stdlib.h>
+#include <wayland-server.h>
+#include <wlr/types/wlr_output_layout.h>
+#include <wlr/util/log.h>
+#include "rootston/desktop.h"
+#include "rootston/output.h"
+#include "rootston/server.h"
+#include "rootston/transaction.h"
+#include "rootston/view.h"
+
+// Maximum time to wait for clients, in milliseconds
+#define TRANSACTION_TIMEOUT 200
+
+static void transaction_view_destroy(
+		struct roots_transaction_view *txn_view) {
+	wl_list_remove(&txn_view->view_destroy.link);
+	wl_list_remove(&txn_view->surface_commit.link);
+	wl_list_remove(&txn_view->link);
+	free(txn_view);
+}
+
+static void transaction_destroy(struct roots_transaction *transaction) {
+	struct roots_transaction_view *txn_view, *tmp;
+	wl_list_for_each_safe(txn_view, tmp, &transaction->views, link) {
+		transaction_view_destroy(txn_view);
+	}
+	if (transaction->timer != NULL) {
+		wl_event_source_remove(transaction->timer);
+	}
+	wl_list_remove(&transaction->link);
+	free(transaction);
+}
+
+/**
+ * Repaints all views of the transaction at once and destroys it.
+ */
+static void transaction_apply(struct roots_transaction *transaction) {
+	struct roots_transaction_view *txn_view;
+	wl_list_for_each(txn_view, &transaction->views, link) {
+		view_damage_whole(txn_view->view);
+	}
+	transaction_destroy(transaction);
+}
+
+static void transaction_update(struct roots_transaction *transaction) {
+	if (!transaction->committed) {
+		return;
+	}
+
+	struct roots_transaction_view *txn_view;
+	wl_list_for_each(txn_view, &transaction->views, link) {
+		if (!txn_view->ready) {
+			return;
+		}
+	}
+	transaction_apply(transaction);
+}
+
+static bool view_configure_done(struct roots_view *view) {
+	switch (view->type) {
+	case ROOTS_XDG_SHELL_V6_VIEW:
+		return view->roots_xdg_surface_v6->
+			pending_move_resize_configure_serial == 0;
+	case ROOTS_XDG_SHELL_VIEW:
+		return view->roots_xdg_surface->
+			pending_move_resize_configure_serial == 0;
+	case ROOTS_WL_SHELL_VIEW:
+#ifdef WLR_HAS_XWAYLAND
+	case ROOTS_XWAYLAND_VIEW:
+#endif
+		// These protocols have no configure serials, the client's next
+		// commit is its answer
+		break;
+	}
+	return false;
+}
+
+static bool transaction_view_is_ready(
+		struct roots_transaction_view *txn_view) {
+	struct wlr_box box;
+	view_get_box(txn_view->view, &box);
+	if (box.width == txn_view->after.width &&
+			box.height == txn_view->after.height) {
+		return true;
+	}
+	return view_configure_done(txn_view->view);
+}
+
+static void transaction_view_handle_view_destroy(struct wl_listener *listener,
+		void *data) {
+	struct roots_transaction_view *txn_view =
+		wl_container_of(listener, txn_view, view_destroy);
+	struct roots_transaction *transaction = txn_view->transaction;
+	transaction_view_destroy(txn_view);
+	transaction_update(transaction);
+}
+
+static void transaction_view_handle_surface_commit(
+		struct wl_listener *listener, void *data) {
+	struct roots_transaction_view *txn_view =
+		wl_container_of(listener, txn_view, surface_commit);
+	if (txn_view->ready) {
+		return;
+	}
+
+	switch (txn_view->view->type) {
+	case ROOTS_XDG_SHELL_V6_VIEW:
+	case ROOTS_XDG_SHELL_VIEW:
+		txn_view->ready = view_configure_done(txn_view->view);
+		break;
+	case ROOTS_WL_SHELL_VIEW:
+#ifdef WLR_HAS_XWAYLAND
+	case ROOTS_XWAYLAND_VIEW:
+#endif
+		txn_view->ready = true;
+		break;
+	}
+	transaction_update(txn_view->transaction);
+}
+
+static int transaction_handle_timeout(void *data) {
+	struct roots_transaction *transaction = data;
+	wlr_log(L_DEBUG, "Transaction timed out, applying it anyway");
+	transaction_apply(transaction);
+	return 0;
+}
+
+static struct roots_transaction_view *transaction_get_view(
+		struct roots_transaction *transaction, struct roots_view *view) {
+	struct roots_transaction_view *txn_view;
+	wl_list_for_each(txn_view, &transaction->views, link) {
+		if (txn_view->view == view) {
+			return txn_view;
+		}
+	}
+
+	txn_view = calloc(1, sizeof(struct roots_transaction_view));
+	if (txn_view == NULL) {
+		return NULL;
+	}
+	txn_view->transaction = transaction;
+	txn_view->view = view;
+	view_get_box(view, &txn_view->before);
+
+	txn_view->view_destroy.notify = transaction_view_handle_view_destroy;
+	wl_signal_add(&view->events.destroy, &txn_view->view_destroy);
+	txn_view->surface_commit.notify = transaction_view_handle_surface_commit;
+	wl_signal_add(&view->wlr_surface->events.commit,
+		&txn_view->surface_commit);
+
+	wl_list_insert(&transaction->views, &txn_view->link);
+	return txn_view;
+}
+
+struct roots_transaction *roots_transaction_create(
+		struct roots_desktop *desktop) {
+	struct roots_transaction *transaction =
+		calloc(1, sizeof(struct roots_transaction));
+	if (transaction == NULL) {
+		wlr_log(L_ERROR, "Allocation failed");
+		return NULL;
+	}
+	transaction->desktop = desktop;
+	wl_list_init(&transaction->views);
+	wl_list_insert(&desktop->transactions, &transaction->link);
+	return transaction;
+}
+
+void roots_transaction_move_resize(struct roots_transaction *transaction,
+		struct roots_view *view, double x, double y, uint32_t width,
+		uint32_t height) {
+	if (transaction == NULL) {
+		view_move_resize(view, x, y, width, height);
+		return;
+	}
+
+	struct roots_transaction_view *txn_view =
+		transaction_get_view(transaction, view);
+	if (txn_view == NULL) {
+		view_move_resize(view, x, y, width, height);
+		return;
+	}
+	txn_view->after.x = x;
+	txn_view->after.y = y;
+	txn_view->after.width = width;
+	txn_view->after.height = height;
+	txn_view->ready = false;
+
+	view_move_resize(view, x, y, width, height);
+}
+
+void roots_transaction_commit(struct roots_transaction *transaction) {
+	if (transaction == NULL) {
+		return;
+	}
+	transaction->committed = true;
+
+	// Views which don't need to redraw don't need to be waited for
+	struct roots_transaction_view *txn_view;
+	wl_list_for_each(txn_view, &transaction->views, link) {
+		txn_view->ready = transaction_view_is_ready(txn_view);
+	}
+
+	struct wl_event_loop *loop =
+		wl_display_get_event_loop(transaction->desktop->server->wl_display);
+	transaction->timer = wl_event_loop_add_timer(loop,
+		transaction_handle_timeout, transaction);
+	if (transaction->timer != NULL) {
+		wl_event_source_timer_update(transaction->timer, TRANSACTION_TIMEOUT);
+	}
+
+	transaction_update(transaction);
+}
+
+bool roots_transaction_blocks_output(struct roots_desktop *desktop,
+		struct roots_output *output) {
+	struct roots_transaction *transaction;
+	wl_list_for_each(transaction, &desktop->transactions, link) {
+		if (!transaction->committed) {
+			continue;
+		}
+
+		struct roots_transaction_view *txn_view;
+		wl_list_for_each(txn_view, &transaction->views, link) {
+			struct wlr_box box;
+			view_get_box(txn_view->view, &box);
+			if (wlr_output_layout_intersects(desktop->layout,
+					output->wlr_output, &txn_view->before) ||
+					wlr_output_layout_intersects(desktop->layout,
+					output->wlr_output, &txn_view->after) ||
+					wlr_output_layout_intersects(desktop->layout,
+					output->wlr_output, &box)) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
@@ -109,8 +109,18 @@ static void resize(struct roots_view *view, uint32_t width, uint32_t height) {
 	apply_size_constraints(surface, width, height, &constrained_width,
 		&constrained_height);
 
-	wlr_xdg_toplevel_set_size(surface, constrained_width,
-		constrained_height);
+	uint32_t serial = wlr_xdg_toplevel_set_size(surface,
+		constrained_width, constrained_height);
+	if (serial > 0) {
+		// Remember the configure even though the position doesn't change,
+		// so that transactions wait for the client to resize
+		struct roots_xdg_surface *roots_surface = view->roots_xdg_surface;
+		if (roots_surface->pending_move_resize_configure_serial == 0) {
+			view->pending_move_resize.update_x = false;
+			view->pending_move_resize.update_y = false;
+		}
+		roots_surface->pending_move_resize_configure_serial = serial;
+	}
 }
 
 static void move_resize(struct roots_view *view, double x, double y,
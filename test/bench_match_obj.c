@@ -0,0 +1,156 @@
+/*
+ * Benchmarks match_obj against the old backtracking solver on synthetic
+ * possible_crtcs masks.
+ *
+ * Usage: bench_match_obj [max CRTCs]
+ */
+#define _POSIX_C_SOURCE 200112L
+#include <gbm.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "backend/drm/util.h"
+#include "match_obj_old.h"
+
+#define MAX_LEN 16
+// The old solver is exponential, it isn't run on larger instances
+#define OLD_MAX_LEN 8
+// Minimum time spent measuring each solver on each instance
+#define MIN_DURATION 100000000 // ns
+
+struct problem {
+	const char *name;
+	size_t num_objs, num_res;
+	uint32_t objs[MAX_LEN];
+	uint32_t res[MAX_LEN];
+};
+
+typedef size_t (*solver_func_t)(size_t num_objs,
+	const uint32_t objs[static restrict num_objs], size_t num_res,
+	const uint32_t res[static restrict num_res],
+	uint32_t out[static restrict num_res]);
+
+static volatile size_t sink;
+
+static int64_t now_nsec(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (int64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+/**
+ * Every connector can be driven by every CRTC, nothing is assigned yet. This
+ * is the first modeset on most hardware.
+ */
+static void make_full(struct problem *p, size_t n) {
+	p->name = "full";
+	p->num_objs = p->num_res = n;
+	for (size_t j = 0; j < n; ++j) {
+		p->objs[j] = (n < 32 ? (1u << n) : 0) - 1;
+	}
+	for (size_t i = 0; i < n; ++i) {
+		p->res[i] = UNMATCHED;
+	}
+}
+
+/**
+ * Connector j can use CRTCs j and j + 1. The previous solution used CRTC j for
+ * connector j, but the first connector was unplugged and replaced by a new one
+ * which needs every assignment to shift.
+ */
+static void make_chain(struct problem *p, size_t n) {
+	p->name = "chain";
+	p->num_objs = p->num_res = n;
+	for (size_t j = 0; j < n; ++j) {
+		p->objs[j] = (1u << j) | (j + 1 < n ? 1u << (j + 1) : 0);
+	}
+	p->objs[0] = 1u << (n - 1);
+	for (size_t i = 0; i < n; ++i) {
+		p->res[i] = i;
+	}
+	p->res[n - 1] = UNMATCHED;
+}
+
+/**
+ * Random masks with two CRTCs per connector, half of the connectors were
+ * assigned before.
+ */
+static void make_sparse(struct problem *p, size_t n) {
+	p->name = "sparse";
+	p->num_objs = p->num_res = n;
+	srand(n);
+	for (size_t j = 0; j < n; ++j) {
+		p->objs[j] = (1u << (rand() % n)) | (1u << (rand() % n));
+	}
+	for (size_t i = 0; i < n; ++i) {
+		p->res[i] = UNMATCHED;
+	}
+	for (size_t j = 0; j < n; j += 2) {
+		for (size_t i = 0; i < n; ++i) {
+			if ((p->objs[j] & (1u << i)) && p->res[i] == UNMATCHED) {
+				p->res[i] = j;
+				break;
+			}
+		}
+	}
+}
+
+/**
+ * Every connector can only be driven by the first half of the CRTCs, so some
+ * stay unmatched. The old solver can't exit early on these.
+ */
+static void make_starved(struct problem *p, size_t n) {
+	p->name = "starved";
+	p->num_objs = p->num_res = n;
+	for (size_t j = 0; j < n; ++j) {
+		p->objs[j] = (1u << (n / 2)) - 1;
+	}
+	for (size_t i = 0; i < n; ++i) {
+		p->res[i] = UNMATCHED;
+	}
+}
+
+static double measure(solver_func_t solver, const struct problem *p) {
+	uint32_t out[MAX_LEN];
+	size_t iterations = 0;
+	int64_t start = now_nsec(), elapsed;
+	do {
+		sink += solver(p->num_objs, p->objs, p->num_res, p->res, out);
+		++iterations;
+		elapsed = now_nsec() - start;
+	} while (elapsed < MIN_DURATION);
+	return (double)elapsed / iterations;
+}
+
+int main(int argc, char *argv[]) {
+	size_t max_len = argc > 1 ? strtoul(argv[1], NULL, 0) : 16;
+	if (max_len > MAX_LEN) {
+		max_len = MAX_LEN;
+	}
+
+	void (*makers[])(struct problem *p, size_t n) = {
+		make_full,
+		make_chain,
+		make_sparse,
+		make_starved,
+	};
+
+	printf("%-8s %6s %14s %14s\n", "masks", "CRTCs", "old (ns/call)",
+		"new (ns/call)");
+	for (size_t m = 0; m < sizeof(makers) / sizeof(makers[0]); ++m) {
+		for (size_t n = 2; n <= max_len; n *= 2) {
+			struct problem p;
+			makers[m](&p, n);
+
+			double new_ns = measure(match_obj, &p);
+			if (n <= OLD_MAX_LEN) {
+				double old_ns = measure(match_obj_old, &p);
+				printf("%-8s %6zu %14.0f %14.0f\n", p.name, n, old_ns, new_ns);
+			} else {
+				printf("%-8s %6zu %14s %14.0f\n", p.name, n, "-", new_ns);
+			}
+		}
+	}
+	return 0;
+}
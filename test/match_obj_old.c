@@ -0,0 +1,143 @@
+/*
+ * The exhaustive backtracking solver match_obj used before it became a
+ * min-cost matching, kept as a reference for the tests and benchmarks.
+ */
+#include <gbm.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "backend/drm/util.h"
+#include "match_obj_old.h"
+
+static inline bool is_taken(size_t n, const uint32_t arr[static n], uint32_t key) {
+	for (size_t i = 0; i < n; ++i) {
+		if (arr[i] == key) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * Store all of the non-recursive state in a struct, so we aren't literally
+ * passing 12 arguments to a function.
+ */
+struct match_state {
+	const size_t num_objs;
+	const uint32_t *restrict objs;
+	const size_t num_res;
+	size_t score;
+	size_t replaced;
+	uint32_t *restrict res;
+	uint32_t *restrict best;
+	const uint32_t *restrict orig;
+	bool exit_early;
+};
+
+/*
+ * skips: The number of SKIP elements encountered so far.
+ * score: The number of resources we've matched so far.
+ * replaced: The number of changes from the original solution.
+ * i: The index of the current element.
+ *
+ * This tries to match a solution as close to st->orig as it can.
+ *
+ * Returns whether we've set a new best element with this solution.
+ */
+static bool match_obj_(struct match_state *st, size_t skips, size_t score, size_t replaced, size_t i) {
+	// Finished
+	if (i >= st->num_res) {
+		if (score > st->score || (score == st->score && replaced < st->replaced)) {
+			st->score = score;
+			st->replaced = replaced;
+			memcpy(st->best, st->res, sizeof(st->best[0]) * st->num_res);
+
+			if (st->score == st->num_objs && st->replaced == 0) {
+				st->exit_early = true;
+			}
+			st->exit_early = (st->score == st->num_res - skips
+					|| st->score == st->num_objs)
+					&& st->replaced == 0;
+
+			return true;
+		} else {
+			return false;
+		}
+	}
+
+	if (st->orig[i] == SKIP) {
+		st->res[i] = SKIP;
+		return match_obj_(st, skips + 1, score, replaced, i + 1);
+	}
+
+	/*
+	 * Attempt to use the current solution first, to try and avoid
+	 * recalculating everything
+	 */
+
+	if (st->orig[i] != UNMATCHED && !is_taken(i, st->res, st->orig[i])) {
+		st->res[i] = st->orig[i];
+		if (match_obj_(st, skips, score + 1, replaced, i + 1)) {
+			return true;
+		}
+	}
+
+	if (st->orig[i] != UNMATCHED) {
+		++replaced;
+	}
+
+	bool is_best = false;
+	for (st->res[i] = 0; st->res[i] < st->num_objs; ++st->res[i]) {
+		// We tried this earlier
+		if (st->res[i] == st->orig[i]) {
+			continue;
+		}
+
+		// Not compatable
+		if (!(st->objs[st->res[i]] & (1 << i))) {
+			continue;
+		}
+
+		// Already taken
+		if (is_taken(i, st->res, st->res[i])) {
+			continue;
+		}
+
+		if (match_obj_(st, skips, score + 1, replaced, i + 1)) {
+			is_best = true;
+		}
+
+		if (st->exit_early) {
+			return true;
+		}
+	}
+
+	if (is_best) {
+		return true;
+	}
+
+	// Maybe this resource can't be matched
+	st->res[i] = UNMATCHED;
+	return match_obj_(st, skips, score, replaced, i + 1);
+}
+
+size_t match_obj_old(size_t num_objs, const uint32_t objs[static restrict num_objs],
+		size_t num_res, const uint32_t res[static restrict num_res],
+		uint32_t out[static restrict num_res]) {
+	uint32_t solution[num_res];
+
+	struct match_state st = {
+		.num_objs = num_objs,
+		.num_res = num_res,
+		.score = 0,
+		.replaced = SIZE_MAX,
+		.objs = objs,
+		.res = solution,
+		.best = out,
+		.orig = res,
+		.exit_early = false,
+	};
+
+	match_obj_(&st, 0, 0, 0, 0);
+	return st.score;
+}
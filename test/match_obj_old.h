@@ -0,0 +1,15 @@
+#ifndef TEST_MATCH_OBJ_OLD_H
+#define TEST_MATCH_OBJ_OLD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Same contract as match_obj, solved by backtracking with an early exit.
+ */
+size_t match_obj_old(size_t num_objs,
+		const uint32_t objs[static restrict num_objs], size_t num_res,
+		const uint32_t res[static restrict num_res],
+		uint32_t out[static restrict num_res]);
+
+#endif
@@ -0,0 +1,247 @@
+/*
+ * Randomized property test for match_obj. Every solution must be a valid
+ * matching, at least as good as the one of the old backtracking solver, and
+ * optimal for instances small enough to be solved by brute force.
+ *
+ * Usage: test_match_obj [seed] [cases]
+ */
+#include <gbm.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "backend/drm/util.h"
+#include "match_obj_old.h"
+
+#define MAX_LEN 7
+#define DEFAULT_CASES 200000
+// Instances up to this many resource/object pairs are also brute-forced
+#define BRUTE_FORCE_MAX 20
+
+struct problem {
+	size_t num_objs, num_res;
+	uint32_t objs[MAX_LEN];
+	uint32_t res[MAX_LEN];
+};
+
+struct solution {
+	size_t score;
+	size_t replaced;
+	uint32_t out[MAX_LEN];
+};
+
+static uint32_t rng_state;
+
+static uint32_t rng_next(void) {
+	// xorshift32
+	uint32_t x = rng_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return rng_state = x;
+}
+
+static uint32_t rng_below(uint32_t n) {
+	return rng_next() % n;
+}
+
+static void generate(struct problem *p) {
+	p->num_res = 1 + rng_below(MAX_LEN);
+	p->num_objs = 1 + rng_below(MAX_LEN);
+
+	uint32_t all = (1u << p->num_res) - 1;
+	for (size_t j = 0; j < p->num_objs; ++j) {
+		uint32_t mask = rng_next();
+		// Vary the density, real hardware ranges from one to all CRTCs
+		switch (rng_below(4)) {
+		case 0:
+			mask &= rng_next() & rng_next();
+			break;
+		case 1:
+			mask &= rng_next();
+			break;
+		case 2:
+			break;
+		case 3:
+			mask = all;
+			break;
+		}
+		p->objs[j] = mask & all;
+	}
+
+	// A previous solution, each object is used at most once. It doesn't
+	// need to be compatible anymore.
+	bool used[MAX_LEN] = { false };
+	for (size_t i = 0; i < p->num_res; ++i) {
+		uint32_t r = rng_below(8);
+		p->res[i] = UNMATCHED;
+		if (r == 0) {
+			p->res[i] = SKIP;
+		} else if (r >= 4) {
+			uint32_t j = rng_below(p->num_objs);
+			if (!used[j]) {
+				p->res[i] = j;
+				used[j] = true;
+			}
+		}
+	}
+}
+
+static size_t count_replaced(const struct problem *p, const uint32_t *out) {
+	size_t replaced = 0;
+	for (size_t i = 0; i < p->num_res; ++i) {
+		if (p->res[i] != UNMATCHED && p->res[i] != SKIP &&
+				out[i] != p->res[i]) {
+			++replaced;
+		}
+	}
+	return replaced;
+}
+
+static bool is_valid(const struct problem *p, const struct solution *s) {
+	bool used[MAX_LEN] = { false };
+	size_t matched = 0;
+	for (size_t i = 0; i < p->num_res; ++i) {
+		uint32_t j = s->out[i];
+		if (p->res[i] == SKIP || j == SKIP) {
+			if (p->res[i] != j) {
+				return false;
+			}
+			continue;
+		}
+		if (j == UNMATCHED) {
+			continue;
+		}
+		if (j >= p->num_objs || used[j]) {
+			return false;
+		}
+		if (j != p->res[i] && !(p->objs[j] & (1u << i))) {
+			return false;
+		}
+		used[j] = true;
+		++matched;
+	}
+	return matched == s->score;
+}
+
+/**
+ * Returns whether a is strictly better than b: more matches, or as many with
+ * fewer changes from the previous solution.
+ */
+static bool is_better(const struct solution *a, const struct solution *b) {
+	return a->score > b->score ||
+		(a->score == b->score && a->replaced < b->replaced);
+}
+
+static void brute_force(const struct problem *p, size_t i, bool *used,
+		struct solution *cur, struct solution *best) {
+	if (i == p->num_res) {
+		cur->replaced = count_replaced(p, cur->out);
+		if (is_better(cur, best)) {
+			*best = *cur;
+		}
+		return;
+	}
+
+	if (p->res[i] == SKIP) {
+		cur->out[i] = SKIP;
+		brute_force(p, i + 1, used, cur, best);
+		return;
+	}
+
+	cur->out[i] = UNMATCHED;
+	brute_force(p, i + 1, used, cur, best);
+
+	for (uint32_t j = 0; j < p->num_objs; ++j) {
+		if (used[j] || (j != p->res[i] && !(p->objs[j] & (1u << i)))) {
+			continue;
+		}
+		used[j] = true;
+		cur->out[i] = j;
+		cur->score++;
+		brute_force(p, i + 1, used, cur, best);
+		cur->score--;
+		used[j] = false;
+	}
+}
+
+static void print_problem(const struct problem *p) {
+	fprintf(stderr, "objs:");
+	for (size_t j = 0; j < p->num_objs; ++j) {
+		fprintf(stderr, " 0x%02x", p->objs[j]);
+	}
+	fprintf(stderr, "\nres: ");
+	for (size_t i = 0; i < p->num_res; ++i) {
+		fprintf(stderr, " %d", (int32_t)p->res[i]);
+	}
+	fprintf(stderr, "\n");
+}
+
+static void print_solution(const char *name, const struct solution *s,
+		size_t num_res) {
+	fprintf(stderr, "%s: score %zu, replaced %zu, out:", name, s->score,
+		s->replaced);
+	for (size_t i = 0; i < num_res; ++i) {
+		fprintf(stderr, " %d", (int32_t)s->out[i]);
+	}
+	fprintf(stderr, "\n");
+}
+
+int main(int argc, char *argv[]) {
+	rng_state = argc > 1 ? strtoul(argv[1], NULL, 0) : 1;
+	if (rng_state == 0) {
+		rng_state = 1;
+	}
+	size_t cases = argc > 2 ? strtoul(argv[2], NULL, 0) : DEFAULT_CASES;
+
+	size_t better = 0, brute_forced = 0;
+	for (size_t n = 0; n < cases; ++n) {
+		struct problem p;
+		generate(&p);
+
+		struct solution new = {0}, old = {0};
+		new.score = match_obj(p.num_objs, p.objs, p.num_res, p.res, new.out);
+		new.replaced = count_replaced(&p, new.out);
+		old.score = match_obj_old(p.num_objs, p.objs, p.num_res, p.res,
+			old.out);
+		old.replaced = count_replaced(&p, old.out);
+
+		const char *error = NULL;
+		struct solution best = { .replaced = SIZE_MAX };
+		if (!is_valid(&p, &new)) {
+			error = "invalid solution";
+		} else if (!is_valid(&p, &old)) {
+			error = "invalid solution from the old solver";
+		} else if (is_better(&old, &new)) {
+			error = "worse than the old solver";
+		} else if (p.num_res * p.num_objs <= BRUTE_FORCE_MAX) {
+			bool used[MAX_LEN] = { false };
+			struct solution cur = {0};
+			brute_force(&p, 0, used, &cur, &best);
+			++brute_forced;
+			if (is_better(&best, &new)) {
+				error = "not optimal";
+			}
+		}
+
+		if (error != NULL) {
+			fprintf(stderr, "case %zu: %s\n", n, error);
+			print_problem(&p);
+			print_solution("new", &new, p.num_res);
+			print_solution("old", &old, p.num_res);
+			if (best.replaced != SIZE_MAX) {
+				print_solution("optimum", &best, p.num_res);
+			}
+			return 1;
+		}
+
+		if (is_better(&new, &old)) {
+			++better;
+		}
+	}
+
+	printf("%zu cases, %zu brute-forced, %zu (%.1f%%) better than the old "
+		"solver\n", cases, brute_forced, better,
+		cases ? 100.0 * better / cases : 0.0);
+	return 0;
+}
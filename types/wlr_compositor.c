@@ -38,6 +38,8 @@ static void wl_compositor_create_surface(struct wl_client *client,
 		return;
 	}
 	surface->compositor_data = compositor;
+	surface->defer_upload = compositor->defer_texture_uploads;
+	surface->damage_check = compositor->damage_check;
 	surface->compositor_listener.notify = &destroy_surface_listener;
 	wl_resource_add_destroy_listener(surface_resource,
 		&surface->compositor_listener);
@@ -90,6 +92,7 @@ void wlr_compositor_destroy(struct wlr_compositor *compositor) {
 	if (compositor == NULL) {
 		return;
 	}
+	wlr_signal_emit_safe(&compositor->events.destroy, compositor);
 	wl_list_remove(&compositor->display_destroy.link);
 	wl_global_destroy(compositor->wl_global);
 	free(compositor);
@@ -195,6 +198,7 @@ struct wlr_compositor *wlr_compositor_create(struct wl_display *display,
 	wl_list_init(&compositor->wl_resources);
 	wl_list_init(&compositor->surfaces);
 	wl_signal_init(&compositor->events.new_surface);
+	wl_signal_init(&compositor->events.destroy);
 
 	compositor->display_destroy.notify = handle_display_destroy;
 	wl_display_add_destroy_listener(display, &compositor->display_destroy);
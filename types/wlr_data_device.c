@@ -115,7 +115,11 @@ static void data_offer_receive(struct wl_client *client,
 	struct wlr_data_offer *offer = data_offer_from_resource(resource);
 
 	if (offer->source && offer == offer->source->offer) {
-		offer->source->send(offer->source, mime_type, fd);
+		if (offer->source->cache != NULL) {
+			wlr_selection_cache_receive(offer->source->cache, mime_type, fd);
+		} else {
+			offer->source->send(offer->source, mime_type, fd);
+		}
 	} else {
 		close(fd);
 	}
@@ -294,12 +298,103 @@ void wlr_seat_client_send_selection(struct wlr_seat_client *seat_client) {
 	}
 }
 
+/**
+ * A compositor-side data source serving the cached selection after the
+ * original source went away.
+ */
+struct cached_data_source {
+	struct wlr_data_source source;
+};
+
+static void cached_data_source_send(struct wlr_data_source *source,
+		const char *mime_type, int32_t fd) {
+	// Only reached once the cache has been detached from the seat
+	close(fd);
+}
+
+static void cached_data_source_cancel(struct wlr_data_source *wlr_source) {
+	struct cached_data_source *source = (struct cached_data_source *)wlr_source;
+	wlr_data_source_finish(&source->source);
+	free(source);
+}
+
+static struct wlr_data_source *cached_data_source_create(
+		struct wlr_selection_cache *cache) {
+	if (!wlr_selection_cache_has_data(cache)) {
+		return NULL;
+	}
+
+	struct cached_data_source *source =
+		calloc(1, sizeof(struct cached_data_source));
+	if (source == NULL) {
+		return NULL;
+	}
+	wlr_data_source_init(&source->source);
+	source->source.send = cached_data_source_send;
+	source->source.cancel = cached_data_source_cancel;
+
+	struct wlr_selection_cache_entry *entry;
+	wl_list_for_each(entry, &cache->entries, link) {
+		if (!entry->complete) {
+			continue;
+		}
+		char **p = wl_array_add(&source->source.mime_types, sizeof(*p));
+		if (p == NULL) {
+			break;
+		}
+		*p = strdup(entry->mime_type);
+		if (*p == NULL) {
+			source->source.mime_types.size -= sizeof(*p);
+			break;
+		}
+	}
+
+	return &source->source;
+}
+
+static void data_source_cache_send(void *data, const char *mime_type,
+		int32_t fd) {
+	struct wlr_data_source *source = data;
+	source->send(source, mime_type, fd);
+}
+
+static void seat_selection_cache_invalidate(struct wlr_seat *seat) {
+	struct wlr_data_source *source = seat->selection_data_source;
+	if (source != NULL) {
+		source->cache = seat->selection_cache;
+	}
+	if (seat->selection_cache == NULL ||
+			(source != NULL && source->send == cached_data_source_send)) {
+		return;
+	}
+	if (source != NULL) {
+		wlr_selection_cache_invalidate(seat->selection_cache,
+			data_source_cache_send, source, &source->mime_types);
+	} else {
+		wlr_selection_cache_invalidate(seat->selection_cache, NULL, NULL, NULL);
+	}
+}
+
 static void seat_client_selection_data_source_destroy(
 		struct wl_listener *listener, void *data) {
 	struct wlr_seat *seat =
 		wl_container_of(listener, seat, selection_data_source_destroy);
 	struct wlr_seat_client *seat_client = seat->keyboard_state.focused_client;
 
+	wl_list_remove(&seat->selection_data_source_destroy.link);
+	seat->selection_data_source = NULL;
+
+	if (seat->selection_cache != NULL) {
+		// Keep serving the data captured so far
+		wlr_selection_cache_detach(seat->selection_cache);
+		struct wlr_data_source *cached =
+			cached_data_source_create(seat->selection_cache);
+		if (cached != NULL) {
+			wlr_seat_set_selection(seat, cached, seat->selection_serial);
+			return;
+		}
+	}
+
 	if (seat_client && seat->keyboard_state.focused_surface) {
 		struct wl_resource *resource;
 		wl_resource_for_each(resource, &seat_client->data_devices) {
@@ -307,7 +402,7 @@ static void seat_client_selection_data_source_destroy(
 		}
 	}
 
-	seat->selection_data_source = NULL;
+	seat_selection_cache_invalidate(seat);
 
 	wlr_signal_emit_safe(&seat->events.selection, seat);
 }
@@ -325,13 +420,17 @@ void wlr_seat_set_selection(struct wlr_seat *seat,
 	}
 
 	if (seat->selection_data_source) {
-		seat->selection_data_source->cancel(seat->selection_data_source);
-		seat->selection_data_source = NULL;
+		// cancelling a cached source destroys it right away
+		struct wlr_data_source *old_source = seat->selection_data_source;
 		wl_list_remove(&seat->selection_data_source_destroy.link);
+		seat->selection_data_source = NULL;
+		old_source->cache = NULL;
+		old_source->cancel(old_source);
 	}
 
 	seat->selection_data_source = source;
 	seat->selection_serial = serial;
+	seat_selection_cache_invalidate(seat);
 
 	struct wlr_seat_client *focused_client =
 		seat->keyboard_state.focused_client;
@@ -350,6 +449,60 @@ void wlr_seat_set_selection(struct wlr_seat *seat,
 	}
 }
 
+/**
+ * Clears the selection if it is served from the cache, which is about to go
+ * away. The serial check of wlr_seat_set_selection doesn't apply, nothing
+ * newer than the cached selection has been set.
+ */
+static void seat_clear_cached_selection(struct wlr_seat *seat) {
+	struct wlr_data_source *source = seat->selection_data_source;
+	if (source == NULL || source->send != cached_data_source_send) {
+		return;
+	}
+
+	// cancelling a cached source destroys it right away
+	wl_list_remove(&seat->selection_data_source_destroy.link);
+	seat->selection_data_source = NULL;
+	source->cache = NULL;
+	source->cancel(source);
+
+	struct wlr_seat_client *focused_client =
+		seat->keyboard_state.focused_client;
+	if (focused_client) {
+		wlr_seat_client_send_selection(focused_client);
+	}
+
+	wlr_signal_emit_safe(&seat->events.selection, seat);
+}
+
+static void seat_handle_selection_cache_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_seat *seat =
+		wl_container_of(listener, seat, selection_cache_destroy);
+	wlr_seat_set_selection_cache(seat, NULL);
+}
+
+void wlr_seat_set_selection_cache(struct wlr_seat *seat,
+		struct wlr_selection_cache *cache) {
+	if (seat->selection_cache == cache) {
+		return;
+	}
+
+	if (seat->selection_cache != NULL) {
+		seat_clear_cached_selection(seat);
+		wl_list_remove(&seat->selection_cache_destroy.link);
+		wlr_selection_cache_invalidate(seat->selection_cache, NULL, NULL, NULL);
+	}
+
+	seat->selection_cache = cache;
+	if (cache != NULL) {
+		seat->selection_cache_destroy.notify =
+			seat_handle_selection_cache_destroy;
+		wl_signal_add(&cache->events.destroy, &seat->selection_cache_destroy);
+	}
+	seat_selection_cache_invalidate(seat);
+}
+
 static const struct wl_data_device_interface data_device_impl;
 
 static struct wlr_seat_client *seat_client_from_data_device_resource(
@@ -0,0 +1,279 @@
+#define _POSIX_C_SOURCE 200112L
+#include <stdlib.h>
+#include <time.h>
+#include <wayland-server.h>
+#include <wlr/types/wlr_frame_scheduler.h>
+#include <wlr/util/log.h>
+
+#define DEFAULT_IDLE_INTERVAL 1000 // ms
+
+static int64_t timespec_to_msec(const struct timespec *a) {
+	return (int64_t)a->tv_sec * 1000 + a->tv_nsec / 1000000;
+}
+
+static void scheduler_surface_set_output(
+		struct wlr_frame_scheduler_surface *sched_surface,
+		struct wlr_frame_scheduler_output *sched_output) {
+	if (sched_surface->output == sched_output) {
+		return;
+	}
+	wl_list_remove(&sched_surface->output_link);
+	wl_list_init(&sched_surface->output_link);
+	sched_surface->output = sched_output;
+	sched_surface->visible = false;
+	if (sched_output != NULL) {
+		wl_list_insert(&sched_output->surfaces, &sched_surface->output_link);
+	}
+}
+
+static void scheduler_output_destroy(
+		struct wlr_frame_scheduler_output *sched_output) {
+	struct wlr_frame_scheduler_surface *sched_surface, *tmp;
+	wl_list_for_each_safe(sched_surface, tmp, &sched_output->surfaces,
+			output_link) {
+		scheduler_surface_set_output(sched_surface, NULL);
+	}
+	wl_list_remove(&sched_output->output_destroy.link);
+	wl_list_remove(&sched_output->link);
+	free(sched_output);
+}
+
+static void scheduler_output_handle_output_destroy(
+		struct wl_listener *listener, void *data) {
+	struct wlr_frame_scheduler_output *sched_output =
+		wl_container_of(listener, sched_output, output_destroy);
+	scheduler_output_destroy(sched_output);
+}
+
+static struct wlr_frame_scheduler_output *scheduler_get_output(
+		struct wlr_frame_scheduler *scheduler, struct wlr_output *output,
+		bool create) {
+	struct wlr_frame_scheduler_output *sched_output;
+	wl_list_for_each(sched_output, &scheduler->outputs, link) {
+		if (sched_output->output == output) {
+			return sched_output;
+		}
+	}
+	if (!create) {
+		return NULL;
+	}
+
+	sched_output = calloc(1, sizeof(struct wlr_frame_scheduler_output));
+	if (sched_output == NULL) {
+		wlr_log(L_ERROR, "Allocation failed");
+		return NULL;
+	}
+	sched_output->scheduler = scheduler;
+	sched_output->output = output;
+	wl_list_init(&sched_output->surfaces);
+	sched_output->output_destroy.notify =
+		scheduler_output_handle_output_destroy;
+	wl_signal_add(&output->events.destroy, &sched_output->output_destroy);
+	wl_list_insert(&scheduler->outputs, &sched_output->link);
+	return sched_output;
+}
+
+static void scheduler_surface_send_frame_done(
+		struct wlr_frame_scheduler_surface *sched_surface,
+		const struct timespec *when) {
+	sched_surface->last_frame = timespec_to_msec(when);
+	wlr_surface_send_frame_done(sched_surface->surface, when);
+}
+
+static void scheduler_surface_destroy(
+		struct wlr_frame_scheduler_surface *sched_surface) {
+	scheduler_surface_set_output(sched_surface, NULL);
+	wl_list_remove(&sched_surface->surface_destroy.link);
+	wl_list_remove(&sched_surface->link);
+	free(sched_surface);
+}
+
+static void scheduler_surface_handle_surface_destroy(
+		struct wl_listener *listener, void *data) {
+	struct wlr_frame_scheduler_surface *sched_surface =
+		wl_container_of(listener, sched_surface, surface_destroy);
+	scheduler_surface_destroy(sched_surface);
+}
+
+static struct wlr_frame_scheduler_surface *scheduler_surface_from_surface(
+		struct wlr_frame_scheduler *scheduler, struct wlr_surface *surface) {
+	// The surface destroy listener leads to the scheduler state in constant
+	// time
+	struct wl_listener *listener = wl_signal_get(&surface->events.destroy,
+		scheduler_surface_handle_surface_destroy);
+	if (listener == NULL) {
+		return NULL;
+	}
+	struct wlr_frame_scheduler_surface *sched_surface =
+		wl_container_of(listener, sched_surface, surface_destroy);
+	if (sched_surface->scheduler != scheduler) {
+		return NULL;
+	}
+	return sched_surface;
+}
+
+static void scheduler_add_surface(struct wlr_frame_scheduler *scheduler,
+		struct wlr_surface *surface) {
+	struct wlr_frame_scheduler_surface *sched_surface =
+		calloc(1, sizeof(struct wlr_frame_scheduler_surface));
+	if (sched_surface == NULL) {
+		wlr_log(L_ERROR, "Allocation failed");
+		return;
+	}
+	sched_surface->scheduler = scheduler;
+	sched_surface->surface = surface;
+	wl_list_init(&sched_surface->output_link);
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	sched_surface->last_frame = timespec_to_msec(&now);
+
+	sched_surface->surface_destroy.notify =
+		scheduler_surface_handle_surface_destroy;
+	wl_signal_add(&surface->events.destroy, &sched_surface->surface_destroy);
+
+	wl_list_insert(&scheduler->surfaces, &sched_surface->link);
+}
+
+static int handle_idle_timer(void *data) {
+	struct wlr_frame_scheduler *scheduler = data;
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	int64_t now_msec = timespec_to_msec(&now);
+
+	// Catch surfaces which are hidden, and surfaces whose output stopped
+	// rendering frames
+	struct wlr_frame_scheduler_surface *sched_surface;
+	wl_list_for_each(sched_surface, &scheduler->surfaces, link) {
+		if (now_msec - sched_surface->last_frame >= scheduler->idle_interval) {
+			scheduler_surface_send_frame_done(sched_surface, &now);
+		}
+	}
+
+	wl_event_source_timer_update(scheduler->idle_timer,
+		scheduler->idle_interval);
+	return 0;
+}
+
+void wlr_frame_scheduler_set_idle_interval(
+		struct wlr_frame_scheduler *scheduler, int interval) {
+	if (interval <= 0) {
+		wlr_log(L_ERROR, "Invalid frame scheduler idle interval %d", interval);
+		return;
+	}
+	scheduler->idle_interval = interval;
+	wl_event_source_timer_update(scheduler->idle_timer, interval);
+}
+
+void wlr_frame_scheduler_surface_visible(struct wlr_frame_scheduler *scheduler,
+		struct wlr_surface *surface, struct wlr_output *output) {
+	struct wlr_frame_scheduler_surface *sched_surface =
+		scheduler_surface_from_surface(scheduler, surface);
+	if (sched_surface == NULL) {
+		return;
+	}
+
+	if (sched_surface->output == NULL ||
+			output->refresh > sched_surface->output->output->refresh) {
+		struct wlr_frame_scheduler_output *sched_output =
+			scheduler_get_output(scheduler, output, true);
+		if (sched_output != NULL) {
+			scheduler_surface_set_output(sched_surface, sched_output);
+		}
+	}
+	if (sched_surface->output != NULL &&
+			sched_surface->output->output == output) {
+		sched_surface->visible = true;
+	}
+}
+
+void wlr_frame_scheduler_output_frame(struct wlr_frame_scheduler *scheduler,
+		struct wlr_output *output, const struct timespec *when) {
+	struct wlr_frame_scheduler_output *sched_output =
+		scheduler_get_output(scheduler, output, false);
+	if (sched_output == NULL) {
+		return;
+	}
+
+	struct wlr_frame_scheduler_surface *sched_surface, *tmp;
+	wl_list_for_each_safe(sched_surface, tmp, &sched_output->surfaces,
+			output_link) {
+		if (sched_surface->visible) {
+			sched_surface->visible = false;
+			scheduler_surface_send_frame_done(sched_surface, when);
+		} else {
+			// Not visible on this output anymore
+			scheduler_surface_set_output(sched_surface, NULL);
+		}
+	}
+}
+
+static void handle_new_surface(struct wl_listener *listener, void *data) {
+	struct wlr_frame_scheduler *scheduler =
+		wl_container_of(listener, scheduler, new_surface);
+	struct wlr_surface *surface = data;
+	scheduler_add_surface(scheduler, surface);
+}
+
+void wlr_frame_scheduler_destroy(struct wlr_frame_scheduler *scheduler) {
+	if (scheduler == NULL) {
+		return;
+	}
+	struct wlr_frame_scheduler_surface *sched_surface, *tmp;
+	wl_list_for_each_safe(sched_surface, tmp, &scheduler->surfaces, link) {
+		scheduler_surface_destroy(sched_surface);
+	}
+	struct wlr_frame_scheduler_output *sched_output, *tmp_output;
+	wl_list_for_each_safe(sched_output, tmp_output, &scheduler->outputs,
+			link) {
+		scheduler_output_destroy(sched_output);
+	}
+	wl_list_remove(&scheduler->new_surface.link);
+	wl_list_remove(&scheduler->compositor_destroy.link);
+	wl_event_source_remove(scheduler->idle_timer);
+	free(scheduler);
+}
+
+static void handle_compositor_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_frame_scheduler *scheduler =
+		wl_container_of(listener, scheduler, compositor_destroy);
+	wlr_frame_scheduler_destroy(scheduler);
+}
+
+struct wlr_frame_scheduler *wlr_frame_scheduler_create(
+		struct wl_display *display, struct wlr_compositor *compositor) {
+	struct wlr_frame_scheduler *scheduler =
+		calloc(1, sizeof(struct wlr_frame_scheduler));
+	if (scheduler == NULL) {
+		return NULL;
+	}
+	scheduler->compositor = compositor;
+	scheduler->idle_interval = DEFAULT_IDLE_INTERVAL;
+	wl_list_init(&scheduler->surfaces);
+	wl_list_init(&scheduler->outputs);
+
+	struct wl_event_loop *loop = wl_display_get_event_loop(display);
+	scheduler->idle_timer = wl_event_loop_add_timer(loop, handle_idle_timer,
+		scheduler);
+	if (scheduler->idle_timer == NULL) {
+		free(scheduler);
+		return NULL;
+	}
+	wl_event_source_timer_update(scheduler->idle_timer,
+		scheduler->idle_interval);
+
+	struct wl_resource *resource;
+	wl_resource_for_each(resource, &compositor->surfaces) {
+		scheduler_add_surface(scheduler, wlr_surface_from_resource(resource));
+	}
+
+	scheduler->new_surface.notify = handle_new_surface;
+	wl_signal_add(&compositor->events.new_surface, &scheduler->new_surface);
+	scheduler->compositor_destroy.notify = handle_compositor_destroy;
+	wl_signal_add(&compositor->events.destroy,
+		&scheduler->compositor_destroy);
+
+	return scheduler;
+}
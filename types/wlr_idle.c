@@ -1,6 +1,8 @@
+#define _POSIX_C_SOURCE 200809L
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <wayland-server.h>
 #include <wlr/types/wlr_idle.h>
 #include <wlr/util/log.h>
@@ -9,6 +11,12 @@
 
 static const struct org_kde_kwin_idle_timeout_interface idle_timeout_impl;
 
+static int64_t get_current_time_msec(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
 static struct wlr_idle_timeout *idle_timeout_from_resource(
 		struct wl_resource *resource) {
 	assert(wl_resource_instance_of(resource,
@@ -17,8 +25,10 @@ static struct wlr_idle_timeout *idle_timeout_from_resource(
 }
 
 static void idle_timeout_destroy(struct wlr_idle_timeout *timer) {
-	wl_list_remove(&timer->input_listener.link);
-	wl_list_remove(&timer->seat_destroy.link);
+	if (timer->idle_state) {
+		timer->idle_seat->idle_timer_count--;
+	}
+	wl_list_remove(&timer->seat_link);
 	wl_event_source_remove(timer->idle_source);
 	wl_list_remove(&timer->link);
 	wl_resource_set_user_data(timer->resource, NULL);
@@ -27,30 +37,83 @@ static void idle_timeout_destroy(struct wlr_idle_timeout *timer) {
 
 static int idle_notify(void *data) {
 	struct wlr_idle_timeout *timer = data;
+
+	int64_t last_activity = timer->idle_seat->last_activity;
+	if (timer->last_activity > last_activity) {
+		last_activity = timer->last_activity;
+	}
+	int64_t elapsed = get_current_time_msec() - last_activity;
+	if (elapsed < timer->timeout) {
+		// there was some activity since the timer was armed
+		wl_event_source_timer_update(timer->idle_source,
+			timer->timeout - elapsed);
+		return 0;
+	}
+
 	timer->idle_state = true;
+	timer->idle_seat->idle_timer_count++;
 	org_kde_kwin_idle_timeout_send_idle(timer->resource);
 	return 1;
 }
 
 static void handle_activity(struct wlr_idle_timeout *timer) {
-	// rearm the timer
-	wl_event_source_timer_update(timer->idle_source, timer->timeout);
-	// in case the previous state was sleeping send a resume event and switch state
-	if (timer->idle_state) {
-		timer->idle_state = false;
-		org_kde_kwin_idle_timeout_send_resumed(timer->resource);
+	// only idle timers need to be rearmed, the others will check the last
+	// activity timestamp when they expire
+	if (!timer->idle_state) {
+		return;
 	}
+	timer->idle_state = false;
+	timer->idle_seat->idle_timer_count--;
+	wl_event_source_timer_update(timer->idle_source, timer->timeout);
+	org_kde_kwin_idle_timeout_send_resumed(timer->resource);
 }
 
-static void handle_timer_resource_destroy(struct wl_resource *timer_resource) {
-	struct wlr_idle_timeout *timer = idle_timeout_from_resource(timer_resource);
-	if (timer != NULL) {
+static void idle_seat_destroy(struct wlr_idle_seat *idle_seat) {
+	struct wlr_idle_timeout *timer, *tmp;
+	wl_list_for_each_safe(timer, tmp, &idle_seat->timers, seat_link) {
 		idle_timeout_destroy(timer);
 	}
+	wl_list_remove(&idle_seat->seat_destroy.link);
+	wl_list_remove(&idle_seat->link);
+	free(idle_seat);
 }
 
 static void handle_seat_destroy(struct wl_listener *listener, void *data) {
-	struct wlr_idle_timeout *timer = wl_container_of(listener, timer, seat_destroy);
+	struct wlr_idle_seat *idle_seat =
+		wl_container_of(listener, idle_seat, seat_destroy);
+	idle_seat_destroy(idle_seat);
+}
+
+static struct wlr_idle_seat *idle_seat_get(struct wlr_idle *idle,
+		struct wlr_seat *seat, bool create) {
+	struct wlr_idle_seat *idle_seat;
+	wl_list_for_each(idle_seat, &idle->seats, link) {
+		if (idle_seat->seat == seat) {
+			return idle_seat;
+		}
+	}
+	if (!create) {
+		return NULL;
+	}
+
+	idle_seat = calloc(1, sizeof(struct wlr_idle_seat));
+	if (idle_seat == NULL) {
+		return NULL;
+	}
+	idle_seat->idle = idle;
+	idle_seat->seat = seat;
+	idle_seat->last_activity = get_current_time_msec();
+	wl_list_init(&idle_seat->timers);
+
+	idle_seat->seat_destroy.notify = handle_seat_destroy;
+	wl_signal_add(&seat->events.destroy, &idle_seat->seat_destroy);
+
+	wl_list_insert(&idle->seats, &idle_seat->link);
+	return idle_seat;
+}
+
+static void handle_timer_resource_destroy(struct wl_resource *timer_resource) {
+	struct wlr_idle_timeout *timer = idle_timeout_from_resource(timer_resource);
 	if (timer != NULL) {
 		idle_timeout_destroy(timer);
 	}
@@ -64,6 +127,10 @@ static void release_idle_timeout(struct wl_client *client,
 static void simulate_activity(struct wl_client *client,
 		struct wl_resource *resource){
 	struct wlr_idle_timeout *timer = idle_timeout_from_resource(resource);
+	if (timer == NULL) {
+		return;
+	}
+	timer->last_activity = get_current_time_msec();
 	handle_activity(timer);
 }
 
@@ -81,15 +148,6 @@ static struct wlr_idle *idle_from_resource(
 	return wl_resource_get_user_data(resource);
 }
 
-static void handle_input_notification(struct wl_listener *listener, void *data) {
-	struct wlr_idle_timeout *timer =
-		wl_container_of(listener, timer, input_listener);
-	struct wlr_seat *seat = data;
-	if (timer->seat == seat) {
-		handle_activity(timer);
-	}
-}
-
 static void create_idle_timer(struct wl_client *client,
 		struct wl_resource *idle_resource, uint32_t id,
 		struct wl_resource *seat_resource, uint32_t timeout) {
@@ -97,6 +155,13 @@ static void create_idle_timer(struct wl_client *client,
 	struct wlr_seat_client *client_seat =
 		wlr_seat_client_from_resource(seat_resource);
 
+	struct wlr_idle_seat *idle_seat =
+		idle_seat_get(idle, client_seat->seat, true);
+	if (idle_seat == NULL) {
+		wl_resource_post_no_memory(idle_resource);
+		return;
+	}
+
 	struct wlr_idle_timeout *timer =
 		calloc(1, sizeof(struct wlr_idle_timeout));
 	if (!timer) {
@@ -104,8 +169,10 @@ static void create_idle_timer(struct wl_client *client,
 		return;
 	}
 	timer->seat = client_seat->seat;
+	timer->idle_seat = idle_seat;
 	timer->timeout = timeout;
 	timer->idle_state = false;
+	timer->last_activity = get_current_time_msec();
 	timer->resource = wl_resource_create(client,
 		&org_kde_kwin_idle_timeout_interface,
 		wl_resource_get_version(idle_resource), id);
@@ -117,19 +184,14 @@ static void create_idle_timer(struct wl_client *client,
 	wl_resource_set_implementation(timer->resource, &idle_timeout_impl, timer,
 			handle_timer_resource_destroy);
 	wl_list_insert(&idle->idle_timers, &timer->link);
+	wl_list_insert(&idle_seat->timers, &timer->seat_link);
 
-	timer->seat_destroy.notify = handle_seat_destroy;
-	wl_signal_add(&timer->seat->events.destroy, &timer->seat_destroy);
-
-	timer->input_listener.notify = handle_input_notification;
-	wl_signal_add(&idle->events.activity_notify, &timer->input_listener);
 	// create the timer
 	timer->idle_source =
 		wl_event_loop_add_timer(idle->event_loop, idle_notify, timer);
 	if (timer->idle_source == NULL) {
 		wl_list_remove(&timer->link);
-		wl_list_remove(&timer->input_listener.link);
-		wl_list_remove(&timer->seat_destroy.link);
+		wl_list_remove(&timer->seat_link);
 		wl_resource_set_user_data(timer->resource, NULL);
 		free(timer);
 		wl_resource_post_no_memory(idle_resource);
@@ -162,9 +224,9 @@ void wlr_idle_destroy(struct wlr_idle *idle) {
 		return;
 	}
 	wl_list_remove(&idle->display_destroy.link);
-	struct wlr_idle_timeout *timer, *tmp;
-	wl_list_for_each_safe(timer, tmp, &idle->idle_timers, link) {
-		idle_timeout_destroy(timer);
+	struct wlr_idle_seat *idle_seat, *tmp;
+	wl_list_for_each_safe(idle_seat, tmp, &idle->seats, link) {
+		idle_seat_destroy(idle_seat);
 	}
 	wl_global_destroy(idle->wl_global);
 	free(idle);
@@ -181,6 +243,7 @@ struct wlr_idle *wlr_idle_create(struct wl_display *display) {
 		return NULL;
 	}
 	wl_list_init(&idle->idle_timers);
+	wl_list_init(&idle->seats);
 	wl_signal_init(&idle->events.activity_notify);
 
 	idle->event_loop = wl_display_get_event_loop(display);
@@ -204,5 +267,15 @@ struct wlr_idle *wlr_idle_create(struct wl_display *display) {
 }
 
 void wlr_idle_notify_activity(struct wlr_idle *idle, struct wlr_seat *seat) {
+	struct wlr_idle_seat *idle_seat = idle_seat_get(idle, seat, false);
+	if (idle_seat != NULL) {
+		idle_seat->last_activity = get_current_time_msec();
+		if (idle_seat->idle_timer_count > 0) {
+			struct wlr_idle_timeout *timer;
+			wl_list_for_each(timer, &idle_seat->timers, seat_link) {
+				handle_activity(timer);
+			}
+		}
+	}
 	wlr_signal_emit_safe(&idle->events.activity_notify, seat);
 }
@@ -0,0 +1,408 @@
+#define _POSIX_C_SOURCE 200112L
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wayland-server.h>
+#include <wlr/types/wlr_input_device.h>
+#include <wlr/types/wlr_input_recorder.h>
+#include <wlr/types/wlr_keyboard.h>
+#include <wlr/types/wlr_pointer.h>
+#include <wlr/types/wlr_tablet_pad.h>
+#include <wlr/types/wlr_tablet_tool.h>
+#include <wlr/types/wlr_touch.h>
+#include <wlr/util/log.h>
+#include "util/input_record.h"
+
+#define RECORDER_DEVICE_LISTENERS_LEN 5
+
+struct wlr_input_recorder_device;
+
+struct recorder_listener {
+	struct wl_listener listener;
+	struct wlr_input_recorder_device *device;
+	enum input_record_type type;
+};
+
+struct wlr_input_recorder_device {
+	struct wlr_input_recorder *recorder;
+	struct wlr_input_device *device;
+	uint32_t id;
+	struct wl_list link; // wlr_input_recorder::devices
+
+	struct recorder_listener listeners[RECORDER_DEVICE_LISTENERS_LEN];
+	size_t listeners_len;
+	struct wl_listener device_destroy;
+};
+
+static void write_record(struct wlr_input_recorder *recorder, uint32_t device,
+		enum input_record_type type, const void *payload, size_t size) {
+	if (recorder->file == NULL) {
+		return;
+	}
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	int64_t usec = (int64_t)(now.tv_sec - recorder->start.tv_sec) * 1000000 +
+		(now.tv_nsec - recorder->start.tv_nsec) / 1000;
+
+	struct input_record record = {
+		.time_usec = usec > 0 ? usec : 0,
+		.device = device,
+		.type = type,
+		.size = size,
+	};
+	if (fwrite(&record, sizeof(record), 1, recorder->file) != 1 ||
+			(size > 0 && fwrite(payload, size, 1, recorder->file) != 1)) {
+		wlr_log_errno(L_ERROR, "Failed to write input record, "
+			"stopping recording");
+		fclose(recorder->file);
+		recorder->file = NULL;
+	}
+}
+
+static void handle_event(struct wl_listener *listener, void *data) {
+	struct recorder_listener *rl = wl_container_of(listener, rl, listener);
+	struct wlr_input_recorder_device *dev = rl->device;
+
+	union {
+		struct input_record_key key;
+		struct input_record_modifiers modifiers;
+		struct input_record_motion motion;
+		struct input_record_position position;
+		struct input_record_button button;
+		struct input_record_axis axis;
+		struct input_record_touch touch;
+		struct input_record_touch_id touch_id;
+		struct input_record_tool_axis tool_axis;
+		struct input_record_pad_axis pad_axis;
+	} p;
+	memset(&p, 0, sizeof(p));
+	size_t size = 0;
+
+	switch (rl->type) {
+	case INPUT_RECORD_KEYBOARD_KEY: {
+		struct wlr_event_keyboard_key *key = data;
+		p.key.keycode = key->keycode;
+		p.key.state = key->state;
+		p.key.update_state = key->update_state;
+		size = sizeof(p.key);
+		break;
+	}
+	case INPUT_RECORD_KEYBOARD_MODIFIERS: {
+		struct wlr_keyboard *keyboard = data;
+		p.modifiers.depressed = keyboard->modifiers.depressed;
+		p.modifiers.latched = keyboard->modifiers.latched;
+		p.modifiers.locked = keyboard->modifiers.locked;
+		p.modifiers.group = keyboard->modifiers.group;
+		size = sizeof(p.modifiers);
+		break;
+	}
+	case INPUT_RECORD_POINTER_MOTION: {
+		struct wlr_event_pointer_motion *motion = data;
+		p.motion.delta_x = motion->delta_x;
+		p.motion.delta_y = motion->delta_y;
+		size = sizeof(p.motion);
+		break;
+	}
+	case INPUT_RECORD_POINTER_MOTION_ABSOLUTE: {
+		struct wlr_event_pointer_motion_absolute *motion_abs = data;
+		p.position.x_mm = motion_abs->x_mm;
+		p.position.y_mm = motion_abs->y_mm;
+		p.position.width_mm = motion_abs->width_mm;
+		p.position.height_mm = motion_abs->height_mm;
+		size = sizeof(p.position);
+		break;
+	}
+	case INPUT_RECORD_POINTER_BUTTON: {
+		struct wlr_event_pointer_button *button = data;
+		p.button.button = button->button;
+		p.button.state = button->state;
+		size = sizeof(p.button);
+		break;
+	}
+	case INPUT_RECORD_POINTER_AXIS: {
+		struct wlr_event_pointer_axis *axis = data;
+		p.axis.source = axis->source;
+		p.axis.orientation = axis->orientation;
+		p.axis.delta = axis->delta;
+		size = sizeof(p.axis);
+		break;
+	}
+	case INPUT_RECORD_POINTER_FRAME:
+		break;
+	case INPUT_RECORD_TOUCH_DOWN: {
+		struct wlr_event_touch_down *down = data;
+		p.touch.touch_id = down->touch_id;
+		p.touch.x_mm = down->x_mm;
+		p.touch.y_mm = down->y_mm;
+		p.touch.width_mm = down->width_mm;
+		p.touch.height_mm = down->height_mm;
+		size = sizeof(p.touch);
+		break;
+	}
+	case INPUT_RECORD_TOUCH_UP: {
+		struct wlr_event_touch_up *up = data;
+		p.touch_id.touch_id = up->touch_id;
+		size = sizeof(p.touch_id);
+		break;
+	}
+	case INPUT_RECORD_TOUCH_MOTION: {
+		struct wlr_event_touch_motion *touch_motion = data;
+		p.touch.touch_id = touch_motion->touch_id;
+		p.touch.x_mm = touch_motion->x_mm;
+		p.touch.y_mm = touch_motion->y_mm;
+		p.touch.width_mm = touch_motion->width_mm;
+		p.touch.height_mm = touch_motion->height_mm;
+		size = sizeof(p.touch);
+		break;
+	}
+	case INPUT_RECORD_TOUCH_CANCEL: {
+		struct wlr_event_touch_cancel *cancel = data;
+		p.touch_id.touch_id = cancel->touch_id;
+		size = sizeof(p.touch_id);
+		break;
+	}
+	case INPUT_RECORD_TABLET_TOOL_AXIS: {
+		struct wlr_event_tablet_tool_axis *tool_axis = data;
+		p.tool_axis.updated_axes = tool_axis->updated_axes;
+		p.tool_axis.x_mm = tool_axis->x_mm;
+		p.tool_axis.y_mm = tool_axis->y_mm;
+		p.tool_axis.width_mm = tool_axis->width_mm;
+		p.tool_axis.height_mm = tool_axis->height_mm;
+		p.tool_axis.pressure = tool_axis->pressure;
+		p.tool_axis.distance = tool_axis->distance;
+		p.tool_axis.tilt_x = tool_axis->tilt_x;
+		p.tool_axis.tilt_y = tool_axis->tilt_y;
+		p.tool_axis.rotation = tool_axis->rotation;
+		p.tool_axis.slider = tool_axis->slider;
+		p.tool_axis.wheel_delta = tool_axis->wheel_delta;
+		size = sizeof(p.tool_axis);
+		break;
+	}
+	case INPUT_RECORD_TABLET_TOOL_PROXIMITY: {
+		struct wlr_event_tablet_tool_proximity *proximity = data;
+		p.position.state = proximity->state;
+		p.position.x_mm = proximity->x_mm;
+		p.position.y_mm = proximity->y_mm;
+		p.position.width_mm = proximity->width_mm;
+		p.position.height_mm = proximity->height_mm;
+		size = sizeof(p.position);
+		break;
+	}
+	case INPUT_RECORD_TABLET_TOOL_TIP: {
+		struct wlr_event_tablet_tool_tip *tip = data;
+		p.position.state = tip->state;
+		p.position.x_mm = tip->x_mm;
+		p.position.y_mm = tip->y_mm;
+		p.position.width_mm = tip->width_mm;
+		p.position.height_mm = tip->height_mm;
+		size = sizeof(p.position);
+		break;
+	}
+	case INPUT_RECORD_TABLET_TOOL_BUTTON: {
+		struct wlr_event_tablet_tool_button *tool_button = data;
+		p.button.button = tool_button->button;
+		p.button.state = tool_button->state;
+		size = sizeof(p.button);
+		break;
+	}
+	case INPUT_RECORD_TABLET_PAD_BUTTON: {
+		struct wlr_event_tablet_pad_button *pad_button = data;
+		p.button.button = pad_button->button;
+		p.button.state = pad_button->state;
+		size = sizeof(p.button);
+		break;
+	}
+	case INPUT_RECORD_TABLET_PAD_RING: {
+		struct wlr_event_tablet_pad_ring *ring = data;
+		p.pad_axis.source = ring->source;
+		p.pad_axis.index = ring->ring;
+		p.pad_axis.position = ring->position;
+		size = sizeof(p.pad_axis);
+		break;
+	}
+	case INPUT_RECORD_TABLET_PAD_STRIP: {
+		struct wlr_event_tablet_pad_strip *strip = data;
+		p.pad_axis.source = strip->source;
+		p.pad_axis.index = strip->strip;
+		p.pad_axis.position = strip->position;
+		size = sizeof(p.pad_axis);
+		break;
+	}
+	case INPUT_RECORD_DEVICE_ADD:
+	case INPUT_RECORD_DEVICE_REMOVE:
+		assert(false);
+		return;
+	}
+
+	write_record(dev->recorder, dev->id, rl->type, &p, size);
+}
+
+static void device_add_listener(struct wlr_input_recorder_device *dev,
+		struct wl_signal *signal, enum input_record_type type) {
+	assert(dev->listeners_len < RECORDER_DEVICE_LISTENERS_LEN);
+	struct recorder_listener *rl = &dev->listeners[dev->listeners_len++];
+	rl->device = dev;
+	rl->type = type;
+	rl->listener.notify = handle_event;
+	wl_signal_add(signal, &rl->listener);
+}
+
+static void recorder_device_destroy(struct wlr_input_recorder_device *dev) {
+	write_record(dev->recorder, dev->id, INPUT_RECORD_DEVICE_REMOVE, NULL, 0);
+	for (size_t i = 0; i < dev->listeners_len; ++i) {
+		wl_list_remove(&dev->listeners[i].listener.link);
+	}
+	wl_list_remove(&dev->device_destroy.link);
+	wl_list_remove(&dev->link);
+	free(dev);
+}
+
+static void handle_device_destroy(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder_device *dev =
+		wl_container_of(listener, dev, device_destroy);
+	recorder_device_destroy(dev);
+}
+
+void wlr_input_recorder_add_device(struct wlr_input_recorder *recorder,
+		struct wlr_input_device *device) {
+	struct wlr_input_recorder_device *dev =
+		calloc(1, sizeof(struct wlr_input_recorder_device));
+	if (dev == NULL) {
+		wlr_log(L_ERROR, "Allocation failed");
+		return;
+	}
+	dev->recorder = recorder;
+	dev->device = device;
+	dev->id = ++recorder->last_device_id;
+
+	switch (device->type) {
+	case WLR_INPUT_DEVICE_KEYBOARD:
+		device_add_listener(dev, &device->keyboard->events.key,
+			INPUT_RECORD_KEYBOARD_KEY);
+		device_add_listener(dev, &device->keyboard->events.modifiers,
+			INPUT_RECORD_KEYBOARD_MODIFIERS);
+		break;
+	case WLR_INPUT_DEVICE_POINTER:
+		device_add_listener(dev, &device->pointer->events.motion,
+			INPUT_RECORD_POINTER_MOTION);
+		device_add_listener(dev, &device->pointer->events.motion_absolute,
+			INPUT_RECORD_POINTER_MOTION_ABSOLUTE);
+		device_add_listener(dev, &device->pointer->events.button,
+			INPUT_RECORD_POINTER_BUTTON);
+		device_add_listener(dev, &device->pointer->events.axis,
+			INPUT_RECORD_POINTER_AXIS);
+		device_add_listener(dev, &device->pointer->events.frame,
+			INPUT_RECORD_POINTER_FRAME);
+		break;
+	case WLR_INPUT_DEVICE_TOUCH:
+		device_add_listener(dev, &device->touch->events.down,
+			INPUT_RECORD_TOUCH_DOWN);
+		device_add_listener(dev, &device->touch->events.up,
+			INPUT_RECORD_TOUCH_UP);
+		device_add_listener(dev, &device->touch->events.motion,
+			INPUT_RECORD_TOUCH_MOTION);
+		device_add_listener(dev, &device->touch->events.cancel,
+			INPUT_RECORD_TOUCH_CANCEL);
+		break;
+	case WLR_INPUT_DEVICE_TABLET_TOOL:
+		device_add_listener(dev, &device->tablet_tool->events.axis,
+			INPUT_RECORD_TABLET_TOOL_AXIS);
+		device_add_listener(dev, &device->tablet_tool->events.proximity,
+			INPUT_RECORD_TABLET_TOOL_PROXIMITY);
+		device_add_listener(dev, &device->tablet_tool->events.tip,
+			INPUT_RECORD_TABLET_TOOL_TIP);
+		device_add_listener(dev, &device->tablet_tool->events.button,
+			INPUT_RECORD_TABLET_TOOL_BUTTON);
+		break;
+	case WLR_INPUT_DEVICE_TABLET_PAD:
+		device_add_listener(dev, &device->tablet_pad->events.button,
+			INPUT_RECORD_TABLET_PAD_BUTTON);
+		device_add_listener(dev, &device->tablet_pad->events.ring,
+			INPUT_RECORD_TABLET_PAD_RING);
+		device_add_listener(dev, &device->tablet_pad->events.strip,
+			INPUT_RECORD_TABLET_PAD_STRIP);
+		break;
+	}
+
+	dev->device_destroy.notify = handle_device_destroy;
+	wl_signal_add(&device->events.destroy, &dev->device_destroy);
+	wl_list_insert(&recorder->devices, &dev->link);
+
+	const char *name = device->name ? device->name : "";
+	size_t name_len = strlen(name);
+	if (name_len > UINT16_MAX - sizeof(struct input_record_device)) {
+		name_len = UINT16_MAX - sizeof(struct input_record_device);
+	}
+	size_t size = sizeof(struct input_record_device) + name_len;
+	struct input_record_device *payload = malloc(size);
+	if (payload == NULL) {
+		wlr_log(L_ERROR, "Allocation failed");
+		return;
+	}
+	payload->type = device->type;
+	memcpy(payload->name, name, name_len);
+	write_record(recorder, dev->id, INPUT_RECORD_DEVICE_ADD, payload, size);
+	free(payload);
+}
+
+static void handle_display_destroy(struct wl_listener *listener, void *data) {
+	struct wlr_input_recorder *recorder =
+		wl_container_of(listener, recorder, display_destroy);
+	wlr_input_recorder_destroy(recorder);
+}
+
+struct wlr_input_recorder *wlr_input_recorder_create(
+		struct wl_display *display, const char *path) {
+	struct wlr_input_recorder *recorder =
+		calloc(1, sizeof(struct wlr_input_recorder));
+	if (recorder == NULL) {
+		wlr_log(L_ERROR, "Allocation failed");
+		return NULL;
+	}
+
+	recorder->file = fopen(path, "wb");
+	if (recorder->file == NULL) {
+		wlr_log_errno(L_ERROR, "Failed to open %s", path);
+		free(recorder);
+		return NULL;
+	}
+
+	struct input_record_header header = {
+		.version = INPUT_RECORD_VERSION,
+	};
+	memcpy(header.magic, INPUT_RECORD_MAGIC, sizeof(header.magic));
+	if (fwrite(&header, sizeof(header), 1, recorder->file) != 1) {
+		wlr_log_errno(L_ERROR, "Failed to write to %s", path);
+		fclose(recorder->file);
+		free(recorder);
+		return NULL;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &recorder->start);
+	wl_list_init(&recorder->devices);
+
+	recorder->display_destroy.notify = handle_display_destroy;
+	wl_display_add_destroy_listener(display, &recorder->display_destroy);
+
+	wlr_log(L_INFO, "Recording input events to %s", path);
+	return recorder;
+}
+
+void wlr_input_recorder_destroy(struct wlr_input_recorder *recorder) {
+	if (recorder == NULL) {
+		return;
+	}
+
+	struct wlr_input_recorder_device *dev, *tmp;
+	wl_list_for_each_safe(dev, tmp, &recorder->devices, link) {
+		recorder_device_destroy(dev);
+	}
+
+	wl_list_remove(&recorder->display_destroy.link);
+	if (recorder->file != NULL) {
+		fclose(recorder->file);
+	}
+	free(recorder);
+}
@@ -136,6 +136,93 @@ void wlr_keyboard_notify_key(struct wlr_keyboard *keyboard,
 	wlr_signal_emit_safe(&keyboard->events.key, event);
 }
 
+/**
+ * A keymap serialized into a file that can be sent to clients. Keyboards with
+ * identical keymaps share the same file and the same xkb_keymap, so that the
+ * keymap is only serialized once and so that a seat can tell that switching
+ * between them doesn't change the keymap.
+ */
+struct wlr_keyboard_keymap_file {
+	struct xkb_keymap *keymap;
+	char *str;
+	int fd;
+	size_t size;
+	int refs;
+	struct wl_list link;
+};
+
+static struct wl_list keymap_files = { &keymap_files, &keymap_files };
+
+static void keymap_file_unref(struct wlr_keyboard_keymap_file *file) {
+	if (file == NULL || --file->refs > 0) {
+		return;
+	}
+	wl_list_remove(&file->link);
+	close(file->fd);
+	free(file->str);
+	xkb_keymap_unref(file->keymap);
+	free(file);
+}
+
+static struct wlr_keyboard_keymap_file *keymap_file_get(
+		struct xkb_keymap *keymap) {
+	struct wlr_keyboard_keymap_file *file;
+	wl_list_for_each(file, &keymap_files, link) {
+		if (file->keymap == keymap) {
+			file->refs++;
+			return file;
+		}
+	}
+
+	char *keymap_str = xkb_keymap_get_as_string(keymap,
+		XKB_KEYMAP_FORMAT_TEXT_V1);
+	if (keymap_str == NULL) {
+		wlr_log(L_ERROR, "Failed to serialize keymap");
+		return NULL;
+	}
+	wl_list_for_each(file, &keymap_files, link) {
+		if (strcmp(file->str, keymap_str) == 0) {
+			free(keymap_str);
+			file->refs++;
+			return file;
+		}
+	}
+
+	file = calloc(1, sizeof(struct wlr_keyboard_keymap_file));
+	if (file == NULL) {
+		wlr_log(L_ERROR, "Allocation failed");
+		free(keymap_str);
+		return NULL;
+	}
+	file->str = keymap_str;
+	file->size = strlen(keymap_str) + 1;
+	file->fd = os_create_anonymous_file(file->size);
+	if (file->fd < 0) {
+		wlr_log(L_ERROR, "creating a keymap file for %zu bytes failed",
+			file->size);
+		goto err;
+	}
+	void *ptr = mmap(NULL, file->size,
+		PROT_READ | PROT_WRITE, MAP_SHARED, file->fd, 0);
+	if (ptr == (void*)-1) {
+		wlr_log(L_ERROR, "failed to mmap() %zu bytes", file->size);
+		close(file->fd);
+		goto err;
+	}
+	strcpy(ptr, keymap_str);
+	munmap(ptr, file->size);
+
+	file->keymap = xkb_keymap_ref(keymap);
+	file->refs = 1;
+	wl_list_insert(&keymap_files, &file->link);
+	return file;
+
+err:
+	free(keymap_str);
+	free(file);
+	return NULL;
+}
+
 void wlr_keyboard_init(struct wlr_keyboard *kb,
 		struct wlr_keyboard_impl *impl) {
 	kb->impl = impl;
@@ -160,7 +247,7 @@ void wlr_keyboard_destroy(struct wlr_keyboard *kb) {
 	}
 	xkb_state_unref(kb->xkb_state);
 	xkb_keymap_unref(kb->keymap);
-	close(kb->keymap_fd);
+	keymap_file_unref(kb->keymap_file);
 	free(kb);
 }
 
@@ -172,10 +259,17 @@ void wlr_keyboard_led_update(struct wlr_keyboard *kb, uint32_t leds) {
 
 void wlr_keyboard_set_keymap(struct wlr_keyboard *kb,
 		struct xkb_keymap *keymap) {
-	char *keymap_str = NULL;
+	struct wlr_keyboard_keymap_file *file = keymap_file_get(keymap);
+	if (file == NULL) {
+		goto err;
+	}
+	keymap_file_unref(kb->keymap_file);
+	kb->keymap_file = file;
+	kb->keymap_fd = file->fd;
+	kb->keymap_size = file->size;
 
 	xkb_keymap_unref(kb->keymap);
-	kb->keymap = xkb_keymap_ref(keymap);
+	kb->keymap = xkb_keymap_ref(file->keymap);
 
 	xkb_state_unref(kb->xkb_state);
 	kb->xkb_state = xkb_state_new(kb->keymap);
@@ -208,26 +302,6 @@ void wlr_keyboard_set_keymap(struct wlr_keyboard *kb,
 		kb->mod_indexes[i] = xkb_map_mod_get_index(kb->keymap, mod_names[i]);
 	}
 
-	keymap_str = xkb_keymap_get_as_string(kb->keymap,
-		XKB_KEYMAP_FORMAT_TEXT_V1);
-	kb->keymap_size = strlen(keymap_str) + 1;
-	if (kb->keymap_fd) {
-		close(kb->keymap_fd);
-	}
-	kb->keymap_fd = os_create_anonymous_file(kb->keymap_size);
-	if (kb->keymap_fd < 0) {
-		wlr_log(L_ERROR, "creating a keymap file for %zu bytes failed", kb->keymap_size);
-		goto err;
-	}
-	void *ptr = mmap(NULL, kb->keymap_size,
-		PROT_READ | PROT_WRITE, MAP_SHARED, kb->keymap_fd, 0);
-	if (ptr == (void*)-1) {
-		wlr_log(L_ERROR, "failed to mmap() %zu bytes", kb->keymap_size);
-		goto err;
-	}
-	strcpy(ptr, keymap_str);
-	free(keymap_str);
-
 	for (size_t i = 0; i < kb->num_keycodes; ++i) {
 		xkb_keycode_t keycode = kb->keycodes[i] + 8;
 		xkb_state_update_key(kb->xkb_state, keycode, XKB_KEY_DOWN);
@@ -241,10 +315,12 @@ void wlr_keyboard_set_keymap(struct wlr_keyboard *kb,
 err:
 	xkb_state_unref(kb->xkb_state);
 	kb->xkb_state = NULL;
-	xkb_keymap_unref(keymap);
+	xkb_keymap_unref(kb->keymap);
 	kb->keymap = NULL;
-	close(kb->keymap_fd);
-	free(keymap_str);
+	keymap_file_unref(kb->keymap_file);
+	kb->keymap_file = NULL;
+	kb->keymap_fd = -1;
+	kb->keymap_size = 0;
 }
 
 void wlr_keyboard_set_repeat_info(struct wlr_keyboard *kb, int32_t rate,
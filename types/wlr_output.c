@@ -261,9 +261,11 @@ void wlr_output_init(struct wlr_output *output, struct wlr_backend *backend,
 	wl_list_init(&output->cursors);
 	wl_list_init(&output->wl_resources);
 	wl_signal_init(&output->events.frame);
+	wl_signal_init(&output->events.present);
 	wl_signal_init(&output->events.needs_swap);
 	wl_signal_init(&output->events.swap_buffers);
 	wl_signal_init(&output->events.enable);
+	wl_signal_init(&output->events.dpms);
 	wl_signal_init(&output->events.mode);
 	wl_signal_init(&output->events.scale);
 	wl_signal_init(&output->events.transform);
@@ -299,6 +301,7 @@ void wlr_output_destroy(struct wlr_output *output) {
 	}
 
 	pixman_region32_fini(&output->damage);
+	free(output->gamma.r);
 
 	if (output->impl && output->impl->destroy) {
 		output->impl->destroy(output);
@@ -391,7 +394,8 @@ static void output_fullscreen_surface_render(struct wlr_output *output,
 	for (int i = 0; i < nrects; ++i) {
 		output_scissor(output, &rects[i]);
 		wlr_renderer_clear(renderer, &(float[]){0, 0, 0, 0});
-		wlr_render_with_matrix(surface->renderer, surface->texture, &matrix);
+		wlr_render_with_matrix(surface->renderer,
+			wlr_surface_get_texture(surface), &matrix);
 	}
 	wlr_renderer_scissor(renderer, NULL);
 
@@ -422,7 +426,7 @@ static void output_cursor_render(struct wlr_output_cursor *cursor,
 
 	struct wlr_texture *texture = cursor->texture;
 	if (cursor->surface != NULL) {
-		texture = cursor->surface->texture;
+		texture = wlr_surface_get_texture(cursor->surface);
 	}
 	if (texture == NULL) {
 		return;
@@ -528,9 +532,32 @@ bool wlr_output_swap_buffers(struct wlr_output *output, struct timespec *when,
 
 void wlr_output_send_frame(struct wlr_output *output) {
 	output->frame_pending = false;
+	if (output->dpms_mode != WLR_OUTPUT_DPMS_ON) {
+		// Rendering is suspended, a frame is scheduled when the output is
+		// turned back on
+		return;
+	}
 	wlr_signal_emit_safe(&output->events.frame, output);
 }
 
+void wlr_output_send_present(struct wlr_output *output, struct timespec *when,
+		unsigned seq, int32_t refresh) {
+	// Only follow changes of more than 1%, so that measured refresh rates
+	// don't trigger a mode event every frame
+	if (refresh > 0 &&
+			abs(refresh - output->refresh) > output->refresh / 100) {
+		wlr_output_update_custom_mode(output, output->width, output->height,
+			refresh);
+	}
+
+	struct wlr_output_event_present event = {
+		.output = output,
+		.when = when,
+		.seq = seq,
+	};
+	wlr_signal_emit_safe(&output->events.present, &event);
+}
+
 static void schedule_frame_handle_idle_timer(void *data) {
 	struct wlr_output *output = data;
 	output->idle_frame = NULL;
@@ -540,7 +567,8 @@ static void schedule_frame_handle_idle_timer(void *data) {
 }
 
 void wlr_output_schedule_frame(struct wlr_output *output) {
-	if (output->frame_pending || output->idle_frame != NULL) {
+	if (output->frame_pending || output->idle_frame != NULL ||
+			output->dpms_mode != WLR_OUTPUT_DPMS_ON) {
 		return;
 	}
 
@@ -550,20 +578,112 @@ void wlr_output_schedule_frame(struct wlr_output *output) {
 		wl_event_loop_add_idle(ev, schedule_frame_handle_idle_timer, output);
 }
 
-void wlr_output_set_gamma(struct wlr_output *output,
-	uint32_t size, uint16_t *r, uint16_t *g, uint16_t *b) {
-	if (output->impl->set_gamma) {
-		output->impl->set_gamma(output, size, r, g, b);
+bool wlr_output_set_dpms(struct wlr_output *output,
+		enum wlr_output_dpms_mode mode) {
+	if (output->dpms_mode == mode) {
+		return true;
+	}
+	if (output->impl->set_dpms && !output->impl->set_dpms(output, mode)) {
+		return false;
+	}
+
+	output->dpms_mode = mode;
+	if (mode != WLR_OUTPUT_DPMS_ON && output->idle_frame != NULL) {
+		wl_event_source_remove(output->idle_frame);
+		output->idle_frame = NULL;
 	}
+
+	wlr_signal_emit_safe(&output->events.dpms, output);
+
+	if (mode == WLR_OUTPUT_DPMS_ON) {
+		wlr_output_schedule_frame(output);
+	}
+	return true;
 }
 
-uint32_t wlr_output_get_gamma_size(struct wlr_output *output) {
-	if (!output->impl->get_gamma_size) {
+bool wlr_output_enable_adaptive_sync(struct wlr_output *output,
+		bool enabled) {
+	if (output->adaptive_sync == enabled) {
+		return true;
+	}
+	if (!output->impl->enable_adaptive_sync ||
+			!output->impl->enable_adaptive_sync(output, enabled)) {
+		return false;
+	}
+	output->adaptive_sync = enabled;
+	return true;
+}
+
+// Size of the ramps applied by the renderer
+#define SOFTWARE_GAMMA_SIZE 256
+
+static uint32_t output_get_hardware_gamma_size(struct wlr_output *output) {
+	if (!output->impl->set_gamma || !output->impl->get_gamma_size) {
 		return 0;
 	}
 	return output->impl->get_gamma_size(output);
 }
 
+static void output_damage_whole(struct wlr_output *output);
+
+void wlr_output_set_gamma(struct wlr_output *output,
+	uint32_t size, uint16_t *r, uint16_t *g, uint16_t *b) {
+	if (size == 0) {
+		return;
+	}
+
+	size_t len = size * sizeof(uint16_t);
+	if (size == output->gamma.size &&
+			memcmp(output->gamma.r, r, len) == 0 &&
+			memcmp(output->gamma.g, g, len) == 0 &&
+			memcmp(output->gamma.b, b, len) == 0) {
+		// Color tools often send the same ramps over and over
+		return;
+	}
+
+	bool software = output_get_hardware_gamma_size(output) == 0;
+	if (software && size != SOFTWARE_GAMMA_SIZE) {
+		wlr_log(L_ERROR, "Invalid gamma ramp size %u for output %s", size,
+			output->name);
+		return;
+	}
+	// Only cache ramps which have been accepted
+	if (!software && !output->impl->set_gamma(output, size, r, g, b)) {
+		wlr_log(L_ERROR, "Failed to set gamma for output %s", output->name);
+		output->gamma.size = 0;
+		return;
+	}
+
+	if (size != output->gamma.size) {
+		uint16_t *ramps = realloc(output->gamma.r, 3 * len);
+		if (ramps == NULL) {
+			wlr_log(L_ERROR, "Allocation failed");
+			output->gamma.size = 0;
+			return;
+		}
+		output->gamma.r = ramps;
+		output->gamma.g = ramps + size;
+		output->gamma.b = ramps + 2 * size;
+		output->gamma.size = size;
+	}
+	memcpy(output->gamma.r, r, len);
+	memcpy(output->gamma.g, g, len);
+	memcpy(output->gamma.b, b, len);
+
+	++output->gamma.serial;
+	output->gamma.software = software;
+
+	if (software) {
+		// Everything needs to be rendered again with the new ramps
+		output_damage_whole(output);
+	}
+}
+
+uint32_t wlr_output_get_gamma_size(struct wlr_output *output) {
+	uint32_t size = output_get_hardware_gamma_size(output);
+	return size > 0 ? size : SOFTWARE_GAMMA_SIZE;
+}
+
 void wlr_output_update_needs_swap(struct wlr_output *output) {
 	output->needs_swap = true;
 	wlr_signal_emit_safe(&output->events.needs_swap, output);
@@ -606,9 +726,9 @@ static void output_fullscreen_surface_handle_commit(
 
 	pixman_region32_t damage;
 	pixman_region32_init(&damage);
-	pixman_region32_copy(&damage, &surface->current->surface_damage);
-	wlr_region_scale(&damage, &damage, output->scale);
-	pixman_region32_translate(&damage, box.x, box.y);
+	wlr_surface_get_effective_damage(surface, &damage);
+	wlr_region_transform_scale(&damage, &damage, WL_OUTPUT_TRANSFORM_NORMAL,
+		0, 0, output->scale, box.x, box.y);
 	pixman_region32_union(&output->damage, &output->damage, &damage);
 	pixman_region32_fini(&damage);
 
@@ -700,6 +820,8 @@ bool wlr_output_cursor_set_image(struct wlr_output_cursor *cursor,
 			cursor->output->hardware_cursor = cursor;
 			return true;
 		}
+		// The backend can stop accepting a cursor it used to display
+		cursor->output->hardware_cursor = NULL;
 	}
 
 	wlr_log(L_DEBUG, "Falling back to software cursor");
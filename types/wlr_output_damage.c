@@ -1,9 +1,11 @@
+#define _POSIX_C_SOURCE 200112L
 #include <stddef.h>
 #include <stdlib.h>
 #include <time.h>
 #include <wayland-server.h>
 #include <wlr/types/wlr_box.h>
 #include <wlr/types/wlr_output_damage.h>
+#include <wlr/types/wlr_output_stats.h>
 #include <wlr/types/wlr_output.h>
 #include "util/signal.h"
 
@@ -31,6 +33,15 @@ static void output_handle_scale(struct wl_listener *listener, void *data) {
 	wlr_output_damage_add_whole(output_damage);
 }
 
+static void output_handle_dpms(struct wl_listener *listener, void *data) {
+	struct wlr_output_damage *output_damage =
+		wl_container_of(listener, output_damage, output_dpms);
+	if (output_damage->output->dpms_mode == WLR_OUTPUT_DPMS_ON) {
+		// The buffers may have been lost while the output was off
+		wlr_output_damage_add_whole(output_damage);
+	}
+}
+
 static void output_handle_needs_swap(struct wl_listener *listener, void *data) {
 	struct wlr_output_damage *output_damage =
 		wl_container_of(listener, output_damage, output_needs_swap);
@@ -74,6 +85,8 @@ struct wlr_output_damage *wlr_output_damage_create(struct wlr_output *output) {
 	output_damage->output_transform.notify = output_handle_transform;
 	wl_signal_add(&output->events.scale, &output_damage->output_scale);
 	output_damage->output_scale.notify = output_handle_scale;
+	wl_signal_add(&output->events.dpms, &output_damage->output_dpms);
+	output_damage->output_dpms.notify = output_handle_dpms;
 	wl_signal_add(&output->events.needs_swap, &output_damage->output_needs_swap);
 	output_damage->output_needs_swap.notify = output_handle_needs_swap;
 	wl_signal_add(&output->events.frame, &output_damage->output_frame);
@@ -91,6 +104,7 @@ void wlr_output_damage_destroy(struct wlr_output_damage *output_damage) {
 	wl_list_remove(&output_damage->output_mode.link);
 	wl_list_remove(&output_damage->output_transform.link);
 	wl_list_remove(&output_damage->output_scale.link);
+	wl_list_remove(&output_damage->output_dpms.link);
 	wl_list_remove(&output_damage->output_needs_swap.link);
 	wl_list_remove(&output_damage->output_frame.link);
 	pixman_region32_fini(&output_damage->current);
@@ -128,12 +142,23 @@ bool wlr_output_damage_make_current(struct wlr_output_damage *output_damage,
 	}
 
 	*needs_swap = output->needs_swap || pixman_region32_not_empty(damage);
+	if (output_damage->stats != NULL && *needs_swap) {
+		wlr_output_stats_begin_frame(output_damage->stats, damage);
+	}
 	return true;
 }
 
 bool wlr_output_damage_swap_buffers(struct wlr_output_damage *output_damage,
 		struct timespec *when, pixman_region32_t *damage) {
-	if (!wlr_output_swap_buffers(output_damage->output, when, damage)) {
+	struct timespec swap_start;
+	if (output_damage->stats != NULL) {
+		clock_gettime(CLOCK_MONOTONIC, &swap_start);
+	}
+	bool ok = wlr_output_swap_buffers(output_damage->output, when, damage);
+	if (output_damage->stats != NULL) {
+		wlr_output_stats_end_frame(output_damage->stats, &swap_start, ok);
+	}
+	if (!ok) {
 		return false;
 	}
 
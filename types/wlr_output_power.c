@@ -0,0 +1,218 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <wayland-server.h>
+#include <wlr/types/wlr_output.h>
+#include <wlr/types/wlr_output_power.h>
+#include <wlr/util/log.h>
+#include "output-power-protocol.h"
+#include "util/signal.h"
+
+static void resource_destroy(struct wl_client *client,
+		struct wl_resource *resource) {
+	wl_resource_destroy(resource);
+}
+
+static void output_power_destroy(struct wlr_output_power *output_power) {
+	if (output_power == NULL) {
+		return;
+	}
+	wlr_signal_emit_safe(&output_power->events.destroy, output_power);
+	wl_list_remove(&output_power->output_destroy_listener.link);
+	wl_list_remove(&output_power->output_dpms_listener.link);
+	wl_resource_set_user_data(output_power->resource, NULL);
+	wl_list_remove(&output_power->link);
+	free(output_power);
+}
+
+static const struct output_power_interface output_power_impl;
+
+static struct wlr_output_power *output_power_from_resource(
+		struct wl_resource *resource) {
+	assert(wl_resource_instance_of(resource, &output_power_interface,
+		&output_power_impl));
+	return wl_resource_get_user_data(resource);
+}
+
+static void output_power_destroy_resource(struct wl_resource *resource) {
+	struct wlr_output_power *output_power =
+		output_power_from_resource(resource);
+	output_power_destroy(output_power);
+}
+
+static void output_power_handle_output_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_output_power *output_power =
+		wl_container_of(listener, output_power, output_destroy_listener);
+	output_power_destroy(output_power);
+}
+
+static enum output_power_mode output_power_mode_from_dpms(
+		enum wlr_output_dpms_mode mode) {
+	switch (mode) {
+	case WLR_OUTPUT_DPMS_ON:
+		return OUTPUT_POWER_MODE_ON;
+	case WLR_OUTPUT_DPMS_STANDBY:
+		return OUTPUT_POWER_MODE_STANDBY;
+	case WLR_OUTPUT_DPMS_OFF:
+		return OUTPUT_POWER_MODE_OFF;
+	}
+	return OUTPUT_POWER_MODE_OFF;
+}
+
+static void output_power_handle_output_dpms(struct wl_listener *listener,
+		void *data) {
+	struct wlr_output_power *output_power =
+		wl_container_of(listener, output_power, output_dpms_listener);
+	output_power_send_mode(output_power->resource,
+		output_power_mode_from_dpms(output_power->output->dpms_mode));
+}
+
+static void output_power_set_mode(struct wl_client *client,
+		struct wl_resource *output_power_resource, uint32_t mode) {
+	struct wlr_output_power *output_power =
+		output_power_from_resource(output_power_resource);
+	if (output_power == NULL) {
+		return;
+	}
+
+	enum wlr_output_dpms_mode dpms_mode;
+	switch (mode) {
+	case OUTPUT_POWER_MODE_ON:
+		dpms_mode = WLR_OUTPUT_DPMS_ON;
+		break;
+	case OUTPUT_POWER_MODE_STANDBY:
+		dpms_mode = WLR_OUTPUT_DPMS_STANDBY;
+		break;
+	case OUTPUT_POWER_MODE_OFF:
+		dpms_mode = WLR_OUTPUT_DPMS_OFF;
+		break;
+	default:
+		wl_resource_post_error(output_power_resource,
+			OUTPUT_POWER_ERROR_INVALID_MODE, "Invalid power mode %u", mode);
+		return;
+	}
+
+	if (!wlr_output_set_dpms(output_power->output, dpms_mode)) {
+		wlr_log(L_ERROR, "Failed to set DPMS mode of output %s",
+			output_power->output->name);
+	}
+}
+
+static const struct output_power_interface output_power_impl = {
+	.destroy = resource_destroy,
+	.set_mode = output_power_set_mode,
+};
+
+static const struct output_power_manager_interface output_power_manager_impl;
+
+static struct wlr_output_power_manager *output_power_manager_from_resource(
+		struct wl_resource *resource) {
+	assert(wl_resource_instance_of(resource, &output_power_manager_interface,
+		&output_power_manager_impl));
+	return wl_resource_get_user_data(resource);
+}
+
+static void output_power_manager_get_output_power(struct wl_client *client,
+		struct wl_resource *manager_resource, uint32_t id,
+		struct wl_resource *output_resource) {
+	struct wlr_output_power_manager *manager =
+		output_power_manager_from_resource(manager_resource);
+	struct wlr_output *output = wlr_output_from_resource(output_resource);
+
+	struct wlr_output_power *output_power =
+		calloc(1, sizeof(struct wlr_output_power));
+	if (output_power == NULL) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+	output_power->output = output;
+
+	int version = wl_resource_get_version(manager_resource);
+	output_power->resource = wl_resource_create(client,
+		&output_power_interface, version, id);
+	if (output_power->resource == NULL) {
+		free(output_power);
+		wl_client_post_no_memory(client);
+		return;
+	}
+	wl_resource_set_implementation(output_power->resource,
+		&output_power_impl, output_power, output_power_destroy_resource);
+
+	wl_signal_init(&output_power->events.destroy);
+
+	wl_signal_add(&output->events.destroy,
+		&output_power->output_destroy_listener);
+	output_power->output_destroy_listener.notify =
+		output_power_handle_output_destroy;
+	wl_signal_add(&output->events.dpms, &output_power->output_dpms_listener);
+	output_power->output_dpms_listener.notify =
+		output_power_handle_output_dpms;
+
+	wl_list_insert(&manager->output_powers, &output_power->link);
+
+	output_power_send_mode(output_power->resource,
+		output_power_mode_from_dpms(output->dpms_mode));
+}
+
+static const struct output_power_manager_interface output_power_manager_impl = {
+	.destroy = resource_destroy,
+	.get_output_power = output_power_manager_get_output_power,
+};
+
+static void output_power_manager_bind(struct wl_client *client, void *data,
+		uint32_t version, uint32_t id) {
+	struct wlr_output_power_manager *manager = data;
+	assert(client && manager);
+
+	struct wl_resource *resource = wl_resource_create(client,
+		&output_power_manager_interface, version, id);
+	if (resource == NULL) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+	wl_resource_set_implementation(resource, &output_power_manager_impl,
+		manager, NULL);
+}
+
+void wlr_output_power_manager_destroy(
+		struct wlr_output_power_manager *manager) {
+	if (!manager) {
+		return;
+	}
+	wl_list_remove(&manager->display_destroy.link);
+	struct wlr_output_power *output_power, *tmp;
+	wl_list_for_each_safe(output_power, tmp, &manager->output_powers, link) {
+		output_power_destroy(output_power);
+	}
+	wl_global_destroy(manager->wl_global);
+	free(manager);
+}
+
+static void handle_display_destroy(struct wl_listener *listener, void *data) {
+	struct wlr_output_power_manager *manager =
+		wl_container_of(listener, manager, display_destroy);
+	wlr_output_power_manager_destroy(manager);
+}
+
+struct wlr_output_power_manager *wlr_output_power_manager_create(
+		struct wl_display *display) {
+	struct wlr_output_power_manager *manager =
+		calloc(1, sizeof(struct wlr_output_power_manager));
+	if (!manager) {
+		return NULL;
+	}
+	manager->wl_global = wl_global_create(display,
+		&output_power_manager_interface, 1, manager,
+		output_power_manager_bind);
+	if (!manager->wl_global) {
+		free(manager);
+		return NULL;
+	}
+
+	wl_list_init(&manager->output_powers);
+
+	manager->display_destroy.notify = handle_display_destroy;
+	wl_display_add_destroy_listener(display, &manager->display_destroy);
+
+	return manager;
+}
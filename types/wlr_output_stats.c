@@ -0,0 +1,129 @@
+#define _POSIX_C_SOURCE 200112L
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wayland-server.h>
+#include <wlr/types/wlr_output_damage.h>
+#include <wlr/types/wlr_output_stats.h>
+#include <wlr/types/wlr_output.h>
+
+static int64_t timespec_sub_nsec(const struct timespec *a,
+		const struct timespec *b) {
+	return (int64_t)(a->tv_sec - b->tv_sec) * 1000000000 +
+		(a->tv_nsec - b->tv_nsec);
+}
+
+static void handle_output_damage_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_output_stats *stats =
+		wl_container_of(listener, stats, output_damage_destroy);
+	wlr_output_stats_destroy(stats);
+}
+
+static void handle_output_present(struct wl_listener *listener, void *data) {
+	struct wlr_output_stats *stats =
+		wl_container_of(listener, stats, output_present);
+	struct wlr_output_event_present *event = data;
+	struct wlr_output_frame_stats *frame = stats->pending_present;
+	if (frame == NULL || event->when == NULL) {
+		return;
+	}
+	stats->pending_present = NULL;
+
+	frame->presented = true;
+	frame->present_nsec = timespec_sub_nsec(event->when, &frame->start);
+
+	// A frame which made it in time is displayed at most one refresh after
+	// rendering started
+	int32_t refresh = event->output->refresh;
+	if (refresh > 0) {
+		int64_t period = (int64_t)1000000000000 / refresh;
+		frame->missed_vblank = frame->present_nsec > period;
+	}
+}
+
+struct wlr_output_stats *wlr_output_stats_create(
+		struct wlr_output_damage *output_damage) {
+	if (output_damage->stats != NULL) {
+		return output_damage->stats;
+	}
+
+	struct wlr_output_stats *stats = calloc(1, sizeof(struct wlr_output_stats));
+	if (stats == NULL) {
+		return NULL;
+	}
+	stats->output_damage = output_damage;
+	output_damage->stats = stats;
+
+	stats->output_damage_destroy.notify = handle_output_damage_destroy;
+	wl_signal_add(&output_damage->events.destroy,
+		&stats->output_damage_destroy);
+	stats->output_present.notify = handle_output_present;
+	wl_signal_add(&output_damage->output->events.present,
+		&stats->output_present);
+
+	return stats;
+}
+
+void wlr_output_stats_destroy(struct wlr_output_stats *stats) {
+	if (stats == NULL) {
+		return;
+	}
+	stats->output_damage->stats = NULL;
+	wl_list_remove(&stats->output_damage_destroy.link);
+	wl_list_remove(&stats->output_present.link);
+	free(stats);
+}
+
+const struct wlr_output_frame_stats *wlr_output_stats_get_frame(
+		struct wlr_output_stats *stats, size_t age) {
+	if (age >= stats->frames_len) {
+		return NULL;
+	}
+	size_t idx = (stats->frames_idx + WLR_OUTPUT_STATS_LEN - 1 - age) %
+		WLR_OUTPUT_STATS_LEN;
+	return &stats->frames[idx];
+}
+
+void wlr_output_stats_begin_frame(struct wlr_output_stats *stats,
+		pixman_region32_t *damage) {
+	struct wlr_output_frame_stats *frame = &stats->frames[stats->frames_idx];
+	if (frame == stats->pending_present) {
+		stats->pending_present = NULL;
+	}
+	memset(frame, 0, sizeof(*frame));
+	clock_gettime(CLOCK_MONOTONIC, &frame->start);
+
+	int nrects;
+	pixman_box32_t *rects = pixman_region32_rectangles(damage, &nrects);
+	for (int i = 0; i < nrects; ++i) {
+		frame->damage_area += (uint32_t)(rects[i].x2 - rects[i].x1) *
+			(rects[i].y2 - rects[i].y1);
+	}
+	frame->damage_rects = nrects;
+
+	stats->current = frame;
+}
+
+void wlr_output_stats_end_frame(struct wlr_output_stats *stats,
+		const struct timespec *swap_start, bool swapped) {
+	struct wlr_output_frame_stats *frame = stats->current;
+	if (frame == NULL) {
+		return;
+	}
+	stats->current = NULL;
+	if (!swapped) {
+		return;
+	}
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	frame->render_nsec = timespec_sub_nsec(swap_start, &frame->start);
+	frame->swap_nsec = timespec_sub_nsec(&now, swap_start);
+
+	stats->pending_present = frame;
+	stats->frames_idx = (stats->frames_idx + 1) % WLR_OUTPUT_STATS_LEN;
+	if (stats->frames_len < WLR_OUTPUT_STATS_LEN) {
+		++stats->frames_len;
+	}
+}
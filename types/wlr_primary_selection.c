@@ -23,7 +23,11 @@ static void offer_handle_receive(struct wl_client *client,
 	struct wlr_primary_selection_offer *offer = offer_from_resource(resource);
 
 	if (offer->source && offer == offer->source->offer) {
-		offer->source->send(offer->source, mime_type, fd);
+		if (offer->source->cache != NULL) {
+			wlr_selection_cache_receive(offer->source->cache, mime_type, fd);
+		} else {
+			offer->source->send(offer->source, mime_type, fd);
+		}
 	} else {
 		close(fd);
 	}
@@ -198,12 +202,105 @@ void wlr_seat_client_send_primary_selection(
 	}
 }
 
+/**
+ * A compositor-side source serving the cached primary selection after the
+ * original source went away.
+ */
+struct cached_source {
+	struct wlr_primary_selection_source source;
+};
+
+static void cached_source_send(struct wlr_primary_selection_source *source,
+		const char *mime_type, int32_t fd) {
+	// Only reached once the cache has been detached from the seat
+	close(fd);
+}
+
+static void cached_source_cancel(
+		struct wlr_primary_selection_source *wlr_source) {
+	struct cached_source *source = (struct cached_source *)wlr_source;
+	wlr_primary_selection_source_finish(&source->source);
+	free(source);
+}
+
+static struct wlr_primary_selection_source *cached_source_create(
+		struct wlr_selection_cache *cache) {
+	if (!wlr_selection_cache_has_data(cache)) {
+		return NULL;
+	}
+
+	struct cached_source *source = calloc(1, sizeof(struct cached_source));
+	if (source == NULL) {
+		return NULL;
+	}
+	wlr_primary_selection_source_init(&source->source);
+	source->source.send = cached_source_send;
+	source->source.cancel = cached_source_cancel;
+
+	struct wlr_selection_cache_entry *entry;
+	wl_list_for_each(entry, &cache->entries, link) {
+		if (!entry->complete) {
+			continue;
+		}
+		char **p = wl_array_add(&source->source.mime_types, sizeof(*p));
+		if (p == NULL) {
+			break;
+		}
+		*p = strdup(entry->mime_type);
+		if (*p == NULL) {
+			source->source.mime_types.size -= sizeof(*p);
+			break;
+		}
+	}
+
+	return &source->source;
+}
+
+static void source_cache_send(void *data, const char *mime_type, int32_t fd) {
+	struct wlr_primary_selection_source *source = data;
+	source->send(source, mime_type, fd);
+}
+
+static void seat_primary_selection_cache_invalidate(struct wlr_seat *seat) {
+	struct wlr_primary_selection_source *source =
+		seat->primary_selection_source;
+	if (source != NULL) {
+		source->cache = seat->primary_selection_cache;
+	}
+	if (seat->primary_selection_cache == NULL ||
+			(source != NULL && source->send == cached_source_send)) {
+		return;
+	}
+	if (source != NULL) {
+		wlr_selection_cache_invalidate(seat->primary_selection_cache,
+			source_cache_send, source, &source->mime_types);
+	} else {
+		wlr_selection_cache_invalidate(seat->primary_selection_cache,
+			NULL, NULL, NULL);
+	}
+}
+
 static void seat_client_primary_selection_source_destroy(
 		struct wl_listener *listener, void *data) {
 	struct wlr_seat *seat =
 		wl_container_of(listener, seat, primary_selection_source_destroy);
 	struct wlr_seat_client *seat_client = seat->keyboard_state.focused_client;
 
+	wl_list_remove(&seat->primary_selection_source_destroy.link);
+	seat->primary_selection_source = NULL;
+
+	if (seat->primary_selection_cache != NULL) {
+		// Keep serving the data captured so far
+		wlr_selection_cache_detach(seat->primary_selection_cache);
+		struct wlr_primary_selection_source *cached =
+			cached_source_create(seat->primary_selection_cache);
+		if (cached != NULL) {
+			wlr_seat_set_primary_selection(seat, cached,
+				seat->primary_selection_serial);
+			return;
+		}
+	}
+
 	if (seat_client && seat->keyboard_state.focused_surface) {
 		struct wl_resource *resource;
 		wl_resource_for_each(resource, &seat_client->primary_selection_devices) {
@@ -211,7 +308,7 @@ static void seat_client_primary_selection_source_destroy(
 		}
 	}
 
-	seat->primary_selection_source = NULL;
+	seat_primary_selection_cache_invalidate(seat);
 
 	wlr_signal_emit_safe(&seat->events.primary_selection, seat);
 }
@@ -229,13 +326,18 @@ void wlr_seat_set_primary_selection(struct wlr_seat *seat,
 	}
 
 	if (seat->primary_selection_source) {
-		seat->primary_selection_source->cancel(seat->primary_selection_source);
-		seat->primary_selection_source = NULL;
+		// cancelling a cached source destroys it right away
+		struct wlr_primary_selection_source *old_source =
+			seat->primary_selection_source;
 		wl_list_remove(&seat->primary_selection_source_destroy.link);
+		seat->primary_selection_source = NULL;
+		old_source->cache = NULL;
+		old_source->cancel(old_source);
 	}
 
 	seat->primary_selection_source = source;
 	seat->primary_selection_serial = serial;
+	seat_primary_selection_cache_invalidate(seat);
 
 	struct wlr_seat_client *focused_client =
 		seat->keyboard_state.focused_client;
@@ -253,6 +355,62 @@ void wlr_seat_set_primary_selection(struct wlr_seat *seat,
 	}
 }
 
+/**
+ * Clears the primary selection if it is served from the cache, which is about
+ * to go away. The serial check of wlr_seat_set_primary_selection doesn't
+ * apply, nothing newer than the cached selection has been set.
+ */
+static void seat_clear_cached_primary_selection(struct wlr_seat *seat) {
+	struct wlr_primary_selection_source *source =
+		seat->primary_selection_source;
+	if (source == NULL || source->send != cached_source_send) {
+		return;
+	}
+
+	// cancelling a cached source destroys it right away
+	wl_list_remove(&seat->primary_selection_source_destroy.link);
+	seat->primary_selection_source = NULL;
+	source->cache = NULL;
+	source->cancel(source);
+
+	struct wlr_seat_client *focused_client =
+		seat->keyboard_state.focused_client;
+	if (focused_client) {
+		wlr_seat_client_send_primary_selection(focused_client);
+	}
+
+	wlr_signal_emit_safe(&seat->events.primary_selection, seat);
+}
+
+static void seat_handle_primary_selection_cache_destroy(
+		struct wl_listener *listener, void *data) {
+	struct wlr_seat *seat =
+		wl_container_of(listener, seat, primary_selection_cache_destroy);
+	wlr_seat_set_primary_selection_cache(seat, NULL);
+}
+
+void wlr_seat_set_primary_selection_cache(struct wlr_seat *seat,
+		struct wlr_selection_cache *cache) {
+	if (seat->primary_selection_cache == cache) {
+		return;
+	}
+
+	if (seat->primary_selection_cache != NULL) {
+		seat_clear_cached_primary_selection(seat);
+		wl_list_remove(&seat->primary_selection_cache_destroy.link);
+		wlr_selection_cache_invalidate(seat->primary_selection_cache,
+			NULL, NULL, NULL);
+	}
+
+	seat->primary_selection_cache = cache;
+	if (cache != NULL) {
+		seat->primary_selection_cache_destroy.notify =
+			seat_handle_primary_selection_cache_destroy;
+		wl_signal_add(&cache->events.destroy,
+			&seat->primary_selection_cache_destroy);
+	}
+	seat_primary_selection_cache_invalidate(seat);
+}
 
 static const struct gtk_primary_selection_device_interface device_impl;
 
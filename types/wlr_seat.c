@@ -365,15 +365,21 @@ void wlr_seat_destroy(struct wlr_seat *seat) {
 
 	wl_list_remove(&seat->display_destroy.link);
 
+	wlr_seat_set_selection_cache(seat, NULL);
+	wlr_seat_set_primary_selection_cache(seat, NULL);
+
 	if (seat->selection_data_source) {
-		seat->selection_data_source->cancel(seat->selection_data_source);
-		seat->selection_data_source = NULL;
+		struct wlr_data_source *source = seat->selection_data_source;
 		wl_list_remove(&seat->selection_data_source_destroy.link);
+		seat->selection_data_source = NULL;
+		source->cancel(source);
 	}
 	if (seat->primary_selection_source) {
-		seat->primary_selection_source->cancel(seat->primary_selection_source);
-		seat->primary_selection_source = NULL;
+		struct wlr_primary_selection_source *source =
+			seat->primary_selection_source;
 		wl_list_remove(&seat->primary_selection_source_destroy.link);
+		seat->primary_selection_source = NULL;
+		source->cancel(source);
 	}
 
 	struct wlr_seat_client *client, *tmp;
@@ -385,6 +391,7 @@ void wlr_seat_destroy(struct wlr_seat *seat) {
 	wl_global_destroy(seat->wl_global);
 	free(seat->pointer_state.default_grab);
 	free(seat->keyboard_state.default_grab);
+	xkb_keymap_unref(seat->keyboard_state.keymap);
 	free(seat->touch_state.default_grab);
 	free(seat->name);
 	free(seat);
@@ -742,15 +749,31 @@ void wlr_seat_keyboard_send_key(struct wlr_seat *wlr_seat, uint32_t time,
 	}
 }
 
+/**
+ * Sends the keymap of the seat keyboard to all clients, unless it's the one
+ * they already have.
+ */
+static void seat_update_keymap(struct wlr_seat *seat) {
+	struct wlr_keyboard *keyboard = seat->keyboard_state.keyboard;
+	if (keyboard->keymap == NULL ||
+			keyboard->keymap == seat->keyboard_state.keymap) {
+		return;
+	}
+	xkb_keymap_unref(seat->keyboard_state.keymap);
+	seat->keyboard_state.keymap = xkb_keymap_ref(keyboard->keymap);
+
+	struct wlr_seat_client *client;
+	wl_list_for_each(client, &seat->clients, link) {
+		seat_client_send_keymap(client, keyboard);
+	}
+}
+
 static void handle_keyboard_keymap(struct wl_listener *listener, void *data) {
 	struct wlr_seat_keyboard_state *state =
 		wl_container_of(listener, state, keyboard_keymap);
-	struct wlr_seat_client *client;
 	struct wlr_keyboard *keyboard = data;
 	if (keyboard == state->keyboard) {
-		wl_list_for_each(client, &state->seat->clients, link) {
-			seat_client_send_keymap(client, state->keyboard);
-		}
+		seat_update_keymap(state->seat);
 	}
 }
 
@@ -802,9 +825,9 @@ void wlr_seat_set_keyboard(struct wlr_seat *seat,
 		seat->keyboard_state.keyboard_repeat_info.notify =
 			handle_keyboard_repeat_info;
 
+		seat_update_keymap(seat);
 		struct wlr_seat_client *client;
 		wl_list_for_each(client, &seat->clients, link) {
-			seat_client_send_keymap(client, keyboard);
 			seat_client_send_repeat_info(client, keyboard);
 		}
 
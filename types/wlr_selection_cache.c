@@ -0,0 +1,508 @@
+#define _POSIX_C_SOURCE 200809L
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+#include <wayland-server.h>
+#include <wlr/types/wlr_selection_cache.h>
+#include <wlr/util/log.h>
+#include "util/os-compatibility.h"
+#include "util/signal.h"
+
+static void transfer_destroy(struct wlr_selection_cache_transfer *transfer) {
+	if (transfer->event_source != NULL) {
+		wl_event_source_remove(transfer->event_source);
+	}
+	if (transfer->data_fd >= 0) {
+		close(transfer->data_fd);
+	}
+	close(transfer->fd);
+	wl_list_remove(&transfer->link);
+	free(transfer);
+}
+
+static int transfer_handle_writable(int fd, uint32_t mask, void *data) {
+	struct wlr_selection_cache_transfer *transfer = data;
+
+	if (mask & (WL_EVENT_ERROR | WL_EVENT_HANGUP)) {
+		transfer_destroy(transfer);
+		return 0;
+	}
+
+	while ((size_t)transfer->offset < transfer->size) {
+		size_t len = transfer->size - transfer->offset;
+		ssize_t n;
+#ifdef __linux__
+		n = sendfile(transfer->fd, transfer->data_fd, &transfer->offset, len);
+#else
+		char buf[4096];
+		if (len > sizeof(buf)) {
+			len = sizeof(buf);
+		}
+		n = pread(transfer->data_fd, buf, len, transfer->offset);
+		if (n > 0) {
+			n = write(transfer->fd, buf, n);
+			if (n > 0) {
+				transfer->offset += n;
+			}
+		}
+#endif
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n < 0 && errno == EAGAIN) {
+			return 0;
+		}
+		if (n <= 0) {
+			wlr_log_errno(L_DEBUG, "Failed to send cached selection");
+			break;
+		}
+	}
+
+	transfer_destroy(transfer);
+	return 0;
+}
+
+static void transfer_start(struct wlr_selection_cache_transfer *transfer,
+		struct wlr_selection_cache_entry *entry) {
+	struct wlr_selection_cache *cache = transfer->cache;
+
+	transfer->size = entry->size;
+	transfer->offset = 0;
+	transfer->data_fd = fcntl(entry->fd, F_DUPFD_CLOEXEC, 0);
+	if (transfer->data_fd < 0) {
+		wlr_log_errno(L_ERROR, "Failed to duplicate cache file descriptor");
+		transfer_destroy(transfer);
+		return;
+	}
+
+	int flags = fcntl(transfer->fd, F_GETFL);
+	if (flags < 0 ||
+			fcntl(transfer->fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+		transfer_destroy(transfer);
+		return;
+	}
+
+	transfer->event_source = wl_event_loop_add_fd(cache->event_loop,
+		transfer->fd, WL_EVENT_WRITABLE, transfer_handle_writable, transfer);
+	if (transfer->event_source == NULL) {
+		transfer_destroy(transfer);
+		return;
+	}
+
+	wl_list_remove(&transfer->link);
+	wl_list_insert(&cache->transfers, &transfer->link);
+}
+
+static void entry_stop_capture(struct wlr_selection_cache_entry *entry) {
+	if (entry->pipe_source != NULL) {
+		wl_event_source_remove(entry->pipe_source);
+		entry->pipe_source = NULL;
+	}
+	if (entry->pipe_fd >= 0) {
+		close(entry->pipe_fd);
+		entry->pipe_fd = -1;
+	}
+}
+
+static void entry_destroy(struct wlr_selection_cache_entry *entry) {
+	struct wlr_selection_cache *cache = entry->cache;
+
+	// Requests waiting for this entry are handed back to the source if it's
+	// still around
+	struct wlr_selection_cache_transfer *transfer, *tmp;
+	wl_list_for_each_safe(transfer, tmp, &entry->waiting, link) {
+		if (cache->send != NULL) {
+			cache->send(cache->send_data, entry->mime_type, transfer->fd);
+			transfer->fd = -1;
+		}
+		if (transfer->fd >= 0) {
+			close(transfer->fd);
+		}
+		wl_list_remove(&transfer->link);
+		free(transfer);
+	}
+
+	entry_stop_capture(entry);
+	cache->size -= entry->size;
+	close(entry->fd);
+	wl_list_remove(&entry->link);
+	free(entry->mime_type);
+	free(entry);
+}
+
+static void entry_evict(struct wlr_selection_cache_entry *entry) {
+	wlr_signal_emit_safe(&entry->cache->events.evict, entry);
+	entry_destroy(entry);
+}
+
+static bool cache_is_uncacheable(struct wlr_selection_cache *cache,
+		const char *mime_type) {
+	char **p;
+	wl_array_for_each(p, &cache->uncacheable) {
+		if (strcmp(*p, mime_type) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void cache_set_uncacheable(struct wlr_selection_cache *cache,
+		const char *mime_type) {
+	char *dup = strdup(mime_type);
+	if (dup == NULL) {
+		return;
+	}
+	char **p = wl_array_add(&cache->uncacheable, sizeof(char *));
+	if (p == NULL) {
+		free(dup);
+		return;
+	}
+	*p = dup;
+}
+
+static void cache_clear_uncacheable(struct wlr_selection_cache *cache) {
+	char **p;
+	wl_array_for_each(p, &cache->uncacheable) {
+		free(*p);
+	}
+	cache->uncacheable.size = 0;
+}
+
+/**
+ * Makes room for `len` more bytes in the entry, evicting least recently used
+ * complete entries as needed.
+ */
+static bool entry_reserve(struct wlr_selection_cache_entry *entry,
+		size_t len) {
+	struct wlr_selection_cache *cache = entry->cache;
+	if (entry->size + len > cache->max_entry_size) {
+		return false;
+	}
+
+	while (cache->size + len > cache->max_size) {
+		struct wlr_selection_cache_entry *lru = NULL, *iter;
+		wl_list_for_each_reverse(iter, &cache->entries, link) {
+			if (iter->complete && iter != entry) {
+				lru = iter;
+				break;
+			}
+		}
+		if (lru == NULL) {
+			return false;
+		}
+		entry_evict(lru);
+	}
+	return true;
+}
+
+static void entry_complete(struct wlr_selection_cache_entry *entry) {
+	entry_stop_capture(entry);
+	entry->complete = true;
+
+	struct wlr_selection_cache_transfer *transfer, *tmp;
+	wl_list_for_each_safe(transfer, tmp, &entry->waiting, link) {
+		transfer_start(transfer, entry);
+	}
+}
+
+static int entry_handle_readable(int fd, uint32_t mask, void *data) {
+	struct wlr_selection_cache_entry *entry = data;
+
+	char buf[4096];
+	while (true) {
+		ssize_t n = read(fd, buf, sizeof(buf));
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n < 0 && errno == EAGAIN) {
+			break;
+		}
+		if (n < 0) {
+			wlr_log_errno(L_DEBUG, "Failed to read selection data");
+			entry_destroy(entry);
+			return 0;
+		}
+		if (n == 0) {
+			entry_complete(entry);
+			return 0;
+		}
+
+		if (!entry_reserve(entry, n)) {
+			wlr_log(L_DEBUG, "Selection data for %s exceeds the cache budget",
+				entry->mime_type);
+			if (entry->size + n > entry->cache->max_entry_size) {
+				// Don't make the source serialize it again on each paste
+				cache_set_uncacheable(entry->cache, entry->mime_type);
+			}
+			entry_destroy(entry);
+			return 0;
+		}
+
+		ssize_t written = 0;
+		while (written < n) {
+			ssize_t ret = write(entry->fd, buf + written, n - written);
+			if (ret < 0 && errno == EINTR) {
+				continue;
+			}
+			if (ret <= 0) {
+				wlr_log_errno(L_ERROR, "Failed to write to selection cache");
+				entry_destroy(entry);
+				return 0;
+			}
+			written += ret;
+		}
+		entry->size += n;
+		entry->cache->size += n;
+	}
+
+	if (mask & WL_EVENT_ERROR) {
+		entry_destroy(entry);
+	}
+	return 0;
+}
+
+static struct wlr_selection_cache_entry *cache_find_entry(
+		struct wlr_selection_cache *cache, const char *mime_type) {
+	struct wlr_selection_cache_entry *entry;
+	wl_list_for_each(entry, &cache->entries, link) {
+		if (strcmp(entry->mime_type, mime_type) == 0) {
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+static struct wlr_selection_cache_entry *cache_capture(
+		struct wlr_selection_cache *cache, const char *mime_type) {
+	if (cache->send == NULL || cache->max_size == 0 ||
+			cache_is_uncacheable(cache, mime_type)) {
+		return NULL;
+	}
+
+	struct wlr_selection_cache_entry *entry =
+		calloc(1, sizeof(struct wlr_selection_cache_entry));
+	if (entry == NULL) {
+		return NULL;
+	}
+	entry->cache = cache;
+	entry->pipe_fd = -1;
+	wl_list_init(&entry->waiting);
+
+	entry->mime_type = strdup(mime_type);
+	if (entry->mime_type == NULL) {
+		goto error_entry;
+	}
+
+	entry->fd = os_create_anonymous_file(0);
+	if (entry->fd < 0) {
+		wlr_log_errno(L_ERROR, "Failed to create selection cache file");
+		goto error_mime_type;
+	}
+
+	int fds[2];
+	if (pipe(fds) < 0) {
+		wlr_log_errno(L_ERROR, "Failed to create pipe");
+		goto error_fd;
+	}
+	if (os_fd_set_cloexec(fds[0]) < 0 || os_fd_set_cloexec(fds[1]) < 0) {
+		goto error_pipe;
+	}
+	int flags = fcntl(fds[0], F_GETFL);
+	if (flags < 0 || fcntl(fds[0], F_SETFL, flags | O_NONBLOCK) < 0) {
+		goto error_pipe;
+	}
+
+	entry->pipe_fd = fds[0];
+	entry->pipe_source = wl_event_loop_add_fd(cache->event_loop, fds[0],
+		WL_EVENT_READABLE, entry_handle_readable, entry);
+	if (entry->pipe_source == NULL) {
+		goto error_pipe;
+	}
+
+	wl_list_insert(&cache->entries, &entry->link);
+
+	// the source takes ownership of the write end
+	cache->send(cache->send_data, mime_type, fds[1]);
+	return entry;
+
+error_pipe:
+	close(fds[0]);
+	close(fds[1]);
+error_fd:
+	close(entry->fd);
+error_mime_type:
+	free(entry->mime_type);
+error_entry:
+	free(entry);
+	return NULL;
+}
+
+static void cache_clear(struct wlr_selection_cache *cache) {
+	struct wlr_selection_cache_entry *entry, *tmp;
+	wl_list_for_each_safe(entry, tmp, &cache->entries, link) {
+		entry_destroy(entry);
+	}
+}
+
+void wlr_selection_cache_invalidate(struct wlr_selection_cache *cache,
+		wlr_selection_cache_send_func_t send, void *send_data,
+		struct wl_array *mime_types) {
+	cache->send = NULL;
+	cache->send_data = NULL;
+	cache_clear(cache);
+	cache_clear_uncacheable(cache);
+	wlr_signal_emit_safe(&cache->events.invalidate, cache);
+
+	cache->send = send;
+	cache->send_data = send_data;
+	if (send == NULL || !cache->eager || mime_types == NULL) {
+		return;
+	}
+
+	char **p;
+	wl_array_for_each(p, mime_types) {
+		if (cache_find_entry(cache, *p) == NULL) {
+			cache_capture(cache, *p);
+		}
+	}
+}
+
+void wlr_selection_cache_detach(struct wlr_selection_cache *cache) {
+	cache->send = NULL;
+	cache->send_data = NULL;
+
+	struct wlr_selection_cache_entry *entry, *tmp;
+	wl_list_for_each_safe(entry, tmp, &cache->entries, link) {
+		if (!entry->complete) {
+			entry_destroy(entry);
+		}
+	}
+}
+
+bool wlr_selection_cache_evict(struct wlr_selection_cache *cache,
+		const char *mime_type) {
+	struct wlr_selection_cache_entry *entry =
+		cache_find_entry(cache, mime_type);
+	if (entry == NULL) {
+		return false;
+	}
+	entry_evict(entry);
+	return true;
+}
+
+void wlr_selection_cache_receive(struct wlr_selection_cache *cache,
+		const char *mime_type, int32_t fd) {
+	struct wlr_selection_cache_entry *entry =
+		cache_find_entry(cache, mime_type);
+	if (entry == NULL) {
+		entry = cache_capture(cache, mime_type);
+	}
+	if (entry == NULL) {
+		if (cache->send != NULL) {
+			cache->send(cache->send_data, mime_type, fd);
+		} else {
+			close(fd);
+		}
+		return;
+	}
+
+	struct wlr_selection_cache_transfer *transfer =
+		calloc(1, sizeof(struct wlr_selection_cache_transfer));
+	if (transfer == NULL) {
+		close(fd);
+		return;
+	}
+	transfer->cache = cache;
+	transfer->fd = fd;
+	transfer->data_fd = -1;
+	wl_list_insert(&entry->waiting, &transfer->link);
+
+	// keep the most recently used entries at the front
+	wl_list_remove(&entry->link);
+	wl_list_insert(&cache->entries, &entry->link);
+
+	if (entry->complete) {
+		transfer_start(transfer, entry);
+	}
+}
+
+bool wlr_selection_cache_has_data(struct wlr_selection_cache *cache) {
+	struct wlr_selection_cache_entry *entry;
+	wl_list_for_each(entry, &cache->entries, link) {
+		if (entry->complete) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void wlr_selection_cache_set_max_size(struct wlr_selection_cache *cache,
+		size_t max_size, size_t max_entry_size) {
+	cache->max_size = max_size;
+	cache->max_entry_size = max_entry_size;
+	// Data which was too large may fit now
+	cache_clear_uncacheable(cache);
+
+	struct wlr_selection_cache_entry *entry, *tmp;
+	wl_list_for_each_reverse_safe(entry, tmp, &cache->entries, link) {
+		if (cache->size <= max_size && entry->size <= max_entry_size) {
+			continue;
+		}
+		entry_evict(entry);
+	}
+}
+
+static void handle_display_destroy(struct wl_listener *listener, void *data) {
+	struct wlr_selection_cache *cache =
+		wl_container_of(listener, cache, display_destroy);
+	wlr_selection_cache_destroy(cache);
+}
+
+struct wlr_selection_cache *wlr_selection_cache_create(
+		struct wl_display *display, size_t max_size) {
+	struct wlr_selection_cache *cache =
+		calloc(1, sizeof(struct wlr_selection_cache));
+	if (cache == NULL) {
+		return NULL;
+	}
+	cache->event_loop = wl_display_get_event_loop(display);
+	cache->max_size = max_size;
+	cache->max_entry_size = max_size;
+	wl_list_init(&cache->entries);
+	wl_list_init(&cache->transfers);
+	wl_array_init(&cache->uncacheable);
+	wl_signal_init(&cache->events.invalidate);
+	wl_signal_init(&cache->events.evict);
+	wl_signal_init(&cache->events.destroy);
+
+	cache->display_destroy.notify = handle_display_destroy;
+	wl_display_add_destroy_listener(display, &cache->display_destroy);
+
+	return cache;
+}
+
+void wlr_selection_cache_destroy(struct wlr_selection_cache *cache) {
+	if (cache == NULL) {
+		return;
+	}
+	wlr_signal_emit_safe(&cache->events.destroy, cache);
+
+	cache->send = NULL;
+	cache_clear(cache);
+	struct wlr_selection_cache_transfer *transfer, *tmp;
+	wl_list_for_each_safe(transfer, tmp, &cache->transfers, link) {
+		transfer_destroy(transfer);
+	}
+
+	cache_clear_uncacheable(cache);
+	wl_array_release(&cache->uncacheable);
+	wl_list_remove(&cache->display_destroy.link);
+	free(cache);
+}
@@ -1,5 +1,6 @@
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 #include <wayland-server.h>
 #include <wlr/render/egl.h>
 #include <wlr/render/interface.h>
@@ -137,19 +138,18 @@ static void surface_set_input_region(struct wl_client *client,
 		pixman_region32_t *region = wlr_region_from_resource(region_resource);
 		pixman_region32_copy(&surface->pending->input, region);
 	} else {
+		pixman_region32_fini(&surface->pending->input);
 		pixman_region32_init_rect(&surface->pending->input,
 			INT32_MIN, INT32_MIN, UINT32_MAX, UINT32_MAX);
 	}
 }
 
-static bool wlr_surface_update_size(struct wlr_surface *surface,
+static void wlr_surface_update_size(struct wlr_surface *surface,
 		struct wlr_surface_state *state) {
 	if (!state->buffer) {
-		pixman_region32_union_rect(&state->surface_damage,
-			&state->surface_damage, 0, 0, state->width, state->height);
 		state->height = 0;
 		state->width = 0;
-		return true;
+		return;
 	}
 
 	int scale = state->scale;
@@ -170,123 +170,164 @@ static bool wlr_surface_update_size(struct wlr_surface *surface,
 		height = tmp;
 	}
 
-	bool update_damage = false;
-	if (width != state->width || height != state->height) {
-		// Damage the whole surface on resize
-		// This isn't in the spec, but Weston does it and QT expects it
-		pixman_region32_union_rect(&state->surface_damage,
-			&state->surface_damage, 0, 0, state->width, state->height);
-		pixman_region32_union_rect(&state->surface_damage,
-			&state->surface_damage, 0, 0, width, height);
-		update_damage = true;
-	}
-
 	state->width = width;
 	state->height = height;
+}
+
+static void pixman_region32_swap(pixman_region32_t *a, pixman_region32_t *b) {
+	pixman_region32_t tmp = *a;
+	*a = *b;
+	*b = tmp;
+}
 
-	return update_damage;
+static void wlr_surface_state_move_buffer(struct wlr_surface_state *state,
+		struct wlr_surface_state *next) {
+	struct wl_resource *buffer = next->buffer;
+	wlr_surface_state_reset_buffer(next);
+	wlr_surface_state_set_buffer(state, buffer);
+	state->sx = next->sx;
+	state->sy = next->sy;
 }
 
 /**
- * Append pending state to current state and clear pending state.
+ * Make `*next` the current state. The fields which haven't been committed are
+ * carried over from the current state, then the states are swapped and the
+ * previous current state is reset and stored in `*next` to be reused.
  */
-static void wlr_surface_move_state(struct wlr_surface *surface,
-		struct wlr_surface_state *next, struct wlr_surface_state *state) {
-	bool update_damage = false;
+static void wlr_surface_swap_state(struct wlr_surface *surface,
+		struct wlr_surface_state **next_ptr) {
+	struct wlr_surface_state *state = surface->current;
+	struct wlr_surface_state *next = *next_ptr;
 	bool update_size = false;
 
 	int oldw = state->width;
 	int oldh = state->height;
 
+	next->width = state->width;
+	next->height = state->height;
+	next->buffer_width = state->buffer_width;
+	next->buffer_height = state->buffer_height;
+
 	if ((next->invalid & WLR_SURFACE_INVALID_SCALE)) {
-		state->scale = next->scale;
 		update_size = true;
+	} else {
+		next->scale = state->scale;
 	}
 	if ((next->invalid & WLR_SURFACE_INVALID_TRANSFORM)) {
-		state->transform = next->transform;
 		update_size = true;
+	} else {
+		next->transform = state->transform;
 	}
 	if ((next->invalid & WLR_SURFACE_INVALID_BUFFER)) {
 		wlr_surface_state_release_buffer(state);
-		wlr_surface_state_set_buffer(state, next->buffer);
-		wlr_surface_state_reset_buffer(next);
-		state->sx = next->sx;
-		state->sy = next->sy;
 		update_size = true;
+	} else {
+		wlr_surface_state_move_buffer(next, state);
 	}
 	if (update_size) {
-		update_damage = wlr_surface_update_size(surface, state);
+		wlr_surface_update_size(surface, next);
 	}
+
 	if ((next->invalid & WLR_SURFACE_INVALID_SURFACE_DAMAGE)) {
 		pixman_region32_intersect_rect(&next->surface_damage,
-			&next->surface_damage, 0, 0, state->width, state->height);
+			&next->surface_damage, 0, 0, next->width, next->height);
+	}
+	if ((next->invalid & WLR_SURFACE_INVALID_BUFFER_DAMAGE)) {
+		pixman_region32_intersect_rect(&next->buffer_damage,
+			&next->buffer_damage, 0, 0, next->buffer_width,
+			next->buffer_height);
+	}
+	// Damage added to the current state since the last commit
+	if (pixman_region32_not_empty(&state->surface_damage)) {
+		pixman_region32_union(&next->surface_damage, &next->surface_damage,
+			&state->surface_damage);
+	}
+	if (pixman_region32_not_empty(&state->buffer_damage)) {
+		pixman_region32_union(&next->buffer_damage, &next->buffer_damage,
+			&state->buffer_damage);
+	}
+	if (oldw != next->width || oldh != next->height) {
+		// Damage the whole surface on resize
+		// This isn't in the spec, but Weston does it and QT expects it
+		pixman_region32_union_rect(&next->surface_damage,
+			&next->surface_damage, 0, 0, oldw, oldh);
+		pixman_region32_union_rect(&next->surface_damage,
+			&next->surface_damage, 0, 0, next->width, next->height);
+	}
+
+	if (!(next->invalid & WLR_SURFACE_INVALID_OPAQUE_REGION)) {
+		pixman_region32_swap(&next->opaque, &state->opaque);
+	}
+	if (!(next->invalid & WLR_SURFACE_INVALID_INPUT_REGION)) {
+		pixman_region32_swap(&next->input, &state->input);
+	}
+	if ((next->invalid & WLR_SURFACE_INVALID_SUBSURFACE_POSITION)) {
+		// Subsurface has moved
+		int dx = state->subsurface_position.x - next->subsurface_position.x;
+		int dy = state->subsurface_position.y - next->subsurface_position.y;
+
+		if (dx != 0 || dy != 0) {
+			pixman_region32_union_rect(&next->surface_damage,
+				&next->surface_damage, dx, dy, oldw, oldh);
+			pixman_region32_union_rect(&next->surface_damage,
+				&next->surface_damage, 0, 0, next->width, next->height);
+		}
+	} else {
+		next->subsurface_position.x = state->subsurface_position.x;
+		next->subsurface_position.y = state->subsurface_position.y;
+	}
+
+	// Callbacks which haven't been sent yet go first
+	wl_list_insert_list(&next->frame_callback_list,
+		&state->frame_callback_list);
+	wl_list_init(&state->frame_callback_list);
+
+	surface->current = next;
+
+	// The previous state becomes the next pending state
+	state->invalid = 0;
+	pixman_region32_clear(&state->surface_damage);
+	pixman_region32_clear(&state->buffer_damage);
+	*next_ptr = state;
+}
+
+/**
+ * Merge the pending state into the cached state of a synchronized subsurface.
+ */
+static void wlr_surface_state_merge(struct wlr_surface_state *state,
+		struct wlr_surface_state *next) {
+	if ((next->invalid & WLR_SURFACE_INVALID_SCALE)) {
+		state->scale = next->scale;
+	}
+	if ((next->invalid & WLR_SURFACE_INVALID_TRANSFORM)) {
+		state->transform = next->transform;
+	}
+	if ((next->invalid & WLR_SURFACE_INVALID_BUFFER)) {
+		wlr_surface_state_release_buffer(state);
+		wlr_surface_state_move_buffer(state, next);
+	}
+	if ((next->invalid & WLR_SURFACE_INVALID_SURFACE_DAMAGE)) {
 		pixman_region32_union(&state->surface_damage, &state->surface_damage,
 			&next->surface_damage);
 		pixman_region32_clear(&next->surface_damage);
-		update_damage = true;
 	}
 	if ((next->invalid & WLR_SURFACE_INVALID_BUFFER_DAMAGE)) {
-		pixman_region32_intersect_rect(&next->buffer_damage,
-			&next->buffer_damage, 0, 0, state->buffer_width,
-			state->buffer_height);
 		pixman_region32_union(&state->buffer_damage, &state->buffer_damage,
 			&next->buffer_damage);
 		pixman_region32_clear(&next->buffer_damage);
-		update_damage = true;
-	}
-	if (update_damage) {
-		pixman_region32_t buffer_damage, surface_damage;
-		pixman_region32_init(&buffer_damage);
-		pixman_region32_init(&surface_damage);
-
-		// Surface to buffer damage
-		pixman_region32_copy(&buffer_damage, &state->surface_damage);
-		wlr_region_transform(&buffer_damage, &buffer_damage,
-			wlr_output_transform_invert(state->transform),
-			state->width, state->height);
-		wlr_region_scale(&buffer_damage, &buffer_damage, state->scale);
-
-		// Buffer to surface damage
-		pixman_region32_copy(&surface_damage, &state->buffer_damage);
-		wlr_region_transform(&surface_damage, &surface_damage, state->transform,
-			state->buffer_width, state->buffer_height);
-		wlr_region_scale(&surface_damage, &surface_damage, 1.0f/state->scale);
-
-		pixman_region32_union(&state->buffer_damage, &state->buffer_damage,
-			&buffer_damage);
-		pixman_region32_union(&state->surface_damage, &state->surface_damage,
-			&surface_damage);
-
-		pixman_region32_fini(&buffer_damage);
-		pixman_region32_fini(&surface_damage);
 	}
 	if ((next->invalid & WLR_SURFACE_INVALID_OPAQUE_REGION)) {
-		// TODO: process buffer
-		pixman_region32_clear(&next->opaque);
+		pixman_region32_swap(&state->opaque, &next->opaque);
 	}
 	if ((next->invalid & WLR_SURFACE_INVALID_INPUT_REGION)) {
-		// TODO: process buffer
-		pixman_region32_copy(&state->input, &next->input);
+		pixman_region32_swap(&state->input, &next->input);
 	}
 	if ((next->invalid & WLR_SURFACE_INVALID_SUBSURFACE_POSITION)) {
-		// Subsurface has moved
-		int dx = state->subsurface_position.x - next->subsurface_position.x;
-		int dy = state->subsurface_position.y - next->subsurface_position.y;
-
 		state->subsurface_position.x = next->subsurface_position.x;
 		state->subsurface_position.y = next->subsurface_position.y;
-		next->subsurface_position.x = 0;
-		next->subsurface_position.y = 0;
-
-		if (dx != 0 || dy != 0) {
-			pixman_region32_union_rect(&state->surface_damage,
-				&state->surface_damage, dx, dy, oldw, oldh);
-			pixman_region32_union_rect(&state->surface_damage,
-				&state->surface_damage, 0, 0, state->width, state->height);
-		}
 	}
 	if ((next->invalid & WLR_SURFACE_INVALID_FRAME_CALLBACK_LIST)) {
-		wl_list_insert_list(&state->frame_callback_list,
+		wl_list_insert_list(state->frame_callback_list.prev,
 			&next->frame_callback_list);
 		wl_list_init(&next->frame_callback_list);
 	}
@@ -314,70 +355,316 @@ static void wlr_surface_damage_subsurfaces(struct wlr_subsurface *subsurface) {
 	}
 }
 
-static void wlr_surface_apply_damage(struct wlr_surface *surface,
-		bool reupload_buffer) {
-	if (!surface->current->buffer) {
-		return;
-	}
-	struct wl_shm_buffer *buffer = wl_shm_buffer_get(surface->current->buffer);
+/**
+ * Uploads `damage` (in buffer coordinates) from `buffer` to the surface
+ * texture, or the whole buffer if `damage` is NULL. Returns false if the
+ * buffer type is unknown.
+ */
+static bool wlr_surface_upload_buffer(struct wlr_surface *surface,
+		struct wl_resource *resource, pixman_region32_t *damage) {
+	struct wl_shm_buffer *buffer = wl_shm_buffer_get(resource);
 	if (!buffer) {
-		if (wlr_renderer_buffer_is_drm(surface->renderer,
-					surface->current->buffer)) {
-			wlr_texture_upload_drm(surface->texture, surface->current->buffer);
-			goto release;
+		if (wlr_renderer_buffer_is_drm(surface->renderer, resource)) {
+			wlr_texture_upload_drm(surface->texture, resource);
+			return true;
 		} else {
 			wlr_log(L_INFO, "Unknown buffer handle attached");
-			return;
+			return false;
 		}
 	}
 
 	uint32_t format = wl_shm_buffer_get_format(buffer);
-	if (reupload_buffer) {
+	int32_t stride = wl_shm_buffer_get_stride(buffer);
+	int32_t width = wl_shm_buffer_get_width(buffer);
+	if (damage == NULL) {
 		wlr_texture_upload_shm(surface->texture, format, buffer);
+		surface->upload_bytes +=
+			(uint64_t)stride * wl_shm_buffer_get_height(buffer);
+		return true;
+	}
+
+	int n;
+	pixman_box32_t *rects = pixman_region32_rectangles(damage, &n);
+	for (int i = 0; i < n; ++i) {
+		pixman_box32_t rect = rects[i];
+		if (!wlr_texture_update_shm(surface->texture, format,
+				rect.x1, rect.y1,
+				rect.x2 - rect.x1,
+				rect.y2 - rect.y1,
+				buffer)) {
+			break;
+		}
+		if (width > 0) {
+			surface->upload_bytes += (uint64_t)(rect.x2 - rect.x1) *
+				(rect.y2 - rect.y1) * (stride / width);
+		}
+	}
+	return true;
+}
+
+static void wlr_surface_apply_damage(struct wlr_surface *surface,
+		bool reupload_buffer) {
+	if (!surface->current->buffer) {
+		return;
+	}
+
+	if (reupload_buffer) {
+		if (!wlr_surface_upload_buffer(surface, surface->current->buffer,
+				NULL)) {
+			return;
+		}
 	} else {
 		pixman_region32_t damage;
 		pixman_region32_init(&damage);
-		pixman_region32_copy(&damage, &surface->current->buffer_damage);
+		wlr_surface_get_buffer_damage(surface, &damage);
 		pixman_region32_intersect_rect(&damage, &damage, 0, 0,
 			surface->current->buffer_width, surface->current->buffer_height);
+		bool ok = wlr_surface_upload_buffer(surface, surface->current->buffer,
+			&damage);
+		pixman_region32_fini(&damage);
+		if (!ok) {
+			return;
+		}
+	}
+
+	wlr_surface_state_release_buffer(surface->current);
+}
+
+static void wlr_surface_release_upload(struct wlr_surface *surface) {
+	if (surface->upload.buffer) {
+		wl_resource_post_event(surface->upload.buffer, WL_BUFFER_RELEASE);
+		wl_list_remove(&surface->upload.buffer_destroy.link);
+		surface->upload.buffer = NULL;
+	}
+	pixman_region32_clear(&surface->upload.damage);
+	surface->upload.full = false;
+}
+
+static void upload_buffer_destroy(struct wl_listener *listener, void *data) {
+	struct wlr_surface *surface =
+		wl_container_of(listener, surface, upload.buffer_destroy);
+	wl_list_remove(&surface->upload.buffer_destroy.link);
+	surface->upload.buffer = NULL;
+}
+
+/**
+ * Keeps the committed buffer instead of uploading it, and accumulates its
+ * damage until the texture is needed.
+ */
+static void wlr_surface_defer_damage(struct wlr_surface *surface,
+		bool reupload_buffer) {
+	struct wl_resource *buffer = surface->current->buffer;
+	if (!buffer) {
+		return;
+	}
+
+	if (surface->upload.buffer != buffer) {
+		// The previous buffer hasn't been uploaded yet, but the new one has
+		// all of its contents
+		if (surface->upload.buffer) {
+			wl_resource_post_event(surface->upload.buffer, WL_BUFFER_RELEASE);
+			wl_list_remove(&surface->upload.buffer_destroy.link);
+		}
+		surface->upload.buffer = buffer;
+		surface->upload.buffer_destroy.notify = upload_buffer_destroy;
+		wl_resource_add_destroy_listener(buffer,
+			&surface->upload.buffer_destroy);
+	}
+	wlr_surface_state_reset_buffer(surface->current);
+
+	if (reupload_buffer) {
+		surface->upload.full = true;
+		pixman_region32_clear(&surface->upload.damage);
+	} else if (!surface->upload.full) {
+		pixman_region32_t damage;
+		pixman_region32_init(&damage);
+		wlr_surface_get_buffer_damage(surface, &damage);
+		pixman_region32_union(&surface->upload.damage,
+			&surface->upload.damage, &damage);
+		pixman_region32_intersect_rect(&surface->upload.damage,
+			&surface->upload.damage, 0, 0, surface->current->buffer_width,
+			surface->current->buffer_height);
+		pixman_region32_fini(&damage);
+	}
+}
+
+struct wlr_texture *wlr_surface_get_texture(struct wlr_surface *surface) {
+	if (surface->upload.buffer) {
+		wlr_surface_upload_buffer(surface, surface->upload.buffer,
+			surface->upload.full ? NULL : &surface->upload.damage);
+		wlr_surface_release_upload(surface);
+	}
+	return surface->texture;
+}
+
+#define DAMAGE_CHECK_TILE_SIZE 32
+
+static uint64_t region_area(pixman_region32_t *region) {
+	uint64_t area = 0;
+	int n;
+	pixman_box32_t *rects = pixman_region32_rectangles(region, &n);
+	for (int i = 0; i < n; ++i) {
+		area += (uint64_t)(rects[i].x2 - rects[i].x1) *
+			(rects[i].y2 - rects[i].y1);
+	}
+	return area;
+}
+
+/**
+ * Compares a box of `data` with the surface shadow copy, and updates the copy
+ * if it changed. Pixels are 4 bytes wide.
+ */
+static bool wlr_surface_shadow_update_box(struct wlr_surface *surface,
+		const uint8_t *data, int x1, int y1, int x2, int y2) {
+	size_t stride = surface->shadow.stride;
+	size_t offset = y1 * stride + x1 * 4;
+	size_t len = (x2 - x1) * 4;
+
+	int y = y1;
+	while (y < y2 && memcmp(surface->shadow.data + offset, data + offset,
+			len) == 0) {
+		++y;
+		offset += stride;
+	}
+	if (y == y2) {
+		return false;
+	}
+	for (; y < y2; ++y) {
+		memcpy(surface->shadow.data + offset, data + offset, len);
+		offset += stride;
+	}
+	return true;
+}
+
+/**
+ * Finds which tiles of the damage of the committed shm buffer actually
+ * changed since the previous buffer, and records it in the surface damage
+ * statistics. If `shrink` is set, the damage of unchanged tiles is dropped.
+ */
+static void wlr_surface_check_damage(struct wlr_surface *surface,
+		bool shrink) {
+	struct wlr_surface_state *state = surface->current;
+	if (!(state->invalid & WLR_SURFACE_INVALID_BUFFER) ||
+			state->buffer == NULL) {
+		return;
+	}
 
+	struct wl_shm_buffer *buffer = wl_shm_buffer_get(state->buffer);
+	uint32_t format = buffer != NULL ? wl_shm_buffer_get_format(buffer) : 0;
+	if (buffer == NULL || (format != WL_SHM_FORMAT_ARGB8888 &&
+			format != WL_SHM_FORMAT_XRGB8888)) {
+		free(surface->shadow.data);
+		surface->shadow.data = NULL;
+		return;
+	}
+
+	int32_t width = wl_shm_buffer_get_width(buffer);
+	int32_t height = wl_shm_buffer_get_height(buffer);
+	int32_t stride = wl_shm_buffer_get_stride(buffer);
+	bool shadow_valid = surface->shadow.data != NULL &&
+		surface->shadow.width == width && surface->shadow.height == height &&
+		surface->shadow.stride == stride;
+	if (!shadow_valid) {
+		free(surface->shadow.data);
+		surface->shadow.data = malloc((size_t)stride * height);
+		if (surface->shadow.data == NULL) {
+			wlr_log(L_ERROR, "Allocation failed");
+			return;
+		}
+		surface->shadow.width = width;
+		surface->shadow.height = height;
+		surface->shadow.stride = stride;
+	}
+
+	pixman_region32_t damage, changed;
+	pixman_region32_init(&damage);
+	pixman_region32_init(&changed);
+	wlr_surface_get_buffer_damage(surface, &damage);
+	pixman_region32_intersect_rect(&damage, &damage, 0, 0, width, height);
+
+	wl_shm_buffer_begin_access(buffer);
+	const uint8_t *data = wl_shm_buffer_get_data(buffer);
+	if (!shadow_valid) {
+		memcpy(surface->shadow.data, data, (size_t)stride * height);
+		pixman_region32_copy(&changed, &damage);
+	} else {
 		int n;
 		pixman_box32_t *rects = pixman_region32_rectangles(&damage, &n);
 		for (int i = 0; i < n; ++i) {
-			pixman_box32_t rect = rects[i];
-			if (!wlr_texture_update_shm(surface->texture, format,
-					rect.x1, rect.y1,
-					rect.x2 - rect.x1,
-					rect.y2 - rect.y1,
-					buffer)) {
-				break;
+			pixman_box32_t *rect = &rects[i];
+			int ty = rect->y1 - rect->y1 % DAMAGE_CHECK_TILE_SIZE;
+			for (; ty < rect->y2; ty += DAMAGE_CHECK_TILE_SIZE) {
+				int y1 = ty > rect->y1 ? ty : rect->y1;
+				int y2 = ty + DAMAGE_CHECK_TILE_SIZE < rect->y2 ?
+					ty + DAMAGE_CHECK_TILE_SIZE : rect->y2;
+				int tx = rect->x1 - rect->x1 % DAMAGE_CHECK_TILE_SIZE;
+				for (; tx < rect->x2; tx += DAMAGE_CHECK_TILE_SIZE) {
+					int x1 = tx > rect->x1 ? tx : rect->x1;
+					int x2 = tx + DAMAGE_CHECK_TILE_SIZE < rect->x2 ?
+						tx + DAMAGE_CHECK_TILE_SIZE : rect->x2;
+					if (wlr_surface_shadow_update_box(surface, data,
+							x1, y1, x2, y2)) {
+						pixman_region32_union_rect(&changed, &changed,
+							x1, y1, x2 - x1, y2 - y1);
+					}
+				}
 			}
 		}
+	}
+	wl_shm_buffer_end_access(buffer);
 
-		pixman_region32_fini(&damage);
+	surface->damage_stats.claimed += region_area(&damage);
+	surface->damage_stats.changed += region_area(&changed);
+
+	// Without a previous buffer to compare with, all damage is kept
+	if (shrink && shadow_valid) {
+		pixman_region32_copy(&state->buffer_damage, &changed);
+		pixman_region32_clear(&state->surface_damage);
 	}
 
-release:
-	wlr_surface_state_release_buffer(surface->current);
+	pixman_region32_fini(&damage);
+	pixman_region32_fini(&changed);
 }
 
-static void wlr_surface_commit_pending(struct wlr_surface *surface) {
+/**
+ * Commit `*next`, which is either the pending state or the cached state of a
+ * subsurface.
+ */
+static void wlr_surface_commit_state(struct wlr_surface *surface,
+		struct wlr_surface_state **next) {
 	int32_t oldw = surface->current->buffer_width;
 	int32_t oldh = surface->current->buffer_height;
 
 	bool null_buffer_commit =
-		(surface->pending->invalid & WLR_SURFACE_INVALID_BUFFER &&
-		 surface->pending->buffer == NULL);
-
-	wlr_surface_move_state(surface, surface->pending, surface->current);
+		((*next)->invalid & WLR_SURFACE_INVALID_BUFFER &&
+		 (*next)->buffer == NULL);
+	// Damage can only be shrunk if it all comes from the client, and not
+	// from a geometry change or from the compositor
+	bool damage_from_client = !((*next)->invalid &
+		(WLR_SURFACE_INVALID_SCALE | WLR_SURFACE_INVALID_TRANSFORM |
+		WLR_SURFACE_INVALID_SUBSURFACE_POSITION)) &&
+		!pixman_region32_not_empty(&surface->current->surface_damage) &&
+		!pixman_region32_not_empty(&surface->current->buffer_damage);
+
+	wlr_surface_swap_state(surface, next);
 
 	if (null_buffer_commit) {
 		surface->texture->valid = false;
+		wlr_surface_release_upload(surface);
 	}
 
 	bool reupload_buffer = oldw != surface->current->buffer_width ||
 		oldh != surface->current->buffer_height;
-	wlr_surface_apply_damage(surface, reupload_buffer);
+	if (surface->damage_check != WLR_SURFACE_DAMAGE_CHECK_NONE) {
+		wlr_surface_check_damage(surface,
+			surface->damage_check == WLR_SURFACE_DAMAGE_CHECK_SHRINK &&
+			damage_from_client && !reupload_buffer);
+	}
+	if (surface->defer_upload) {
+		wlr_surface_defer_damage(surface, reupload_buffer);
+	} else {
+		wlr_surface_apply_damage(surface, reupload_buffer);
+	}
 
 	// commit subsurface order
 	struct wlr_subsurface *subsurface;
@@ -424,13 +711,11 @@ static bool wlr_subsurface_is_synchronized(struct wlr_subsurface *subsurface) {
  */
 static void wlr_subsurface_parent_commit(struct wlr_subsurface *subsurface,
 		bool synchronized) {
-		struct wlr_surface *surface = subsurface->surface;
+	struct wlr_surface *surface = subsurface->surface;
 	if (synchronized || subsurface->synchronized) {
 		if (subsurface->has_cache) {
-			wlr_surface_move_state(surface, subsurface->cached, surface->pending);
-			wlr_surface_commit_pending(surface);
+			wlr_surface_commit_state(surface, &subsurface->cached);
 			subsurface->has_cache = false;
-			subsurface->cached->invalid = 0;
 		}
 
 		struct wlr_subsurface *tmp;
@@ -444,16 +729,22 @@ static void wlr_subsurface_commit(struct wlr_subsurface *subsurface) {
 	struct wlr_surface *surface = subsurface->surface;
 
 	if (wlr_subsurface_is_synchronized(subsurface)) {
-		wlr_surface_move_state(surface, surface->pending, subsurface->cached);
-		subsurface->has_cache = true;
+		if (subsurface->has_cache) {
+			wlr_surface_state_merge(subsurface->cached, surface->pending);
+		} else {
+			// The cached state is empty, take the pending state as is
+			struct wlr_surface_state *cached = subsurface->cached;
+			subsurface->cached = surface->pending;
+			surface->pending = cached;
+			subsurface->has_cache = true;
+		}
 	} else {
 		if (subsurface->has_cache) {
-			wlr_surface_move_state(surface, subsurface->cached, surface->pending);
-			wlr_surface_commit_pending(surface);
+			wlr_surface_state_merge(subsurface->cached, surface->pending);
+			wlr_surface_commit_state(surface, &subsurface->cached);
 			subsurface->has_cache = false;
-
 		} else {
-			wlr_surface_commit_pending(surface);
+			wlr_surface_commit_state(surface, &surface->pending);
 		}
 
 		struct wlr_subsurface *tmp;
@@ -461,7 +752,6 @@ static void wlr_subsurface_commit(struct wlr_subsurface *subsurface) {
 			wlr_subsurface_parent_commit(tmp, false);
 		}
 	}
-
 }
 
 static void surface_commit(struct wl_client *client,
@@ -474,7 +764,7 @@ static void surface_commit(struct wl_client *client,
 		return;
 	}
 
-	wlr_surface_commit_pending(surface);
+	wlr_surface_commit_state(surface, &surface->pending);
 
 	struct wlr_subsurface *tmp;
 	wl_list_for_each(tmp, &surface->subsurface_list, parent_link) {
@@ -592,6 +882,9 @@ static void destroy_surface(struct wl_resource *resource) {
 		wlr_subsurface_destroy(surface->subsurface);
 	}
 
+	wlr_surface_release_upload(surface);
+	pixman_region32_fini(&surface->upload.damage);
+	free(surface->shadow.data);
 	wlr_texture_destroy(surface->texture);
 	wlr_surface_state_destroy(surface->pending);
 	wlr_surface_state_destroy(surface->current);
@@ -613,6 +906,7 @@ struct wlr_surface *wlr_surface_create(struct wl_resource *res,
 
 	surface->current = wlr_surface_state_create();
 	surface->pending = wlr_surface_state_create();
+	pixman_region32_init(&surface->upload.damage);
 
 	wl_signal_init(&surface->events.commit);
 	wl_signal_init(&surface->events.destroy);
@@ -628,8 +922,9 @@ void wlr_surface_get_matrix(struct wlr_surface *surface,
 		float (*matrix)[16],
 		const float (*projection)[16],
 		const float (*transform)[16]) {
-	int width = surface->texture->width;
-	int height = surface->texture->height;
+	// The texture might not have been uploaded yet
+	int width = surface->current->buffer_width;
+	int height = surface->current->buffer_height;
 	float scale[16];
 	wlr_matrix_identity(matrix);
 	if (transform) {
@@ -640,8 +935,53 @@ void wlr_surface_get_matrix(struct wlr_surface *surface,
 	wlr_matrix_mul(projection, matrix, matrix);
 }
 
+void wlr_surface_get_effective_damage(struct wlr_surface *surface,
+		pixman_region32_t *damage) {
+	struct wlr_surface_state *state = surface->current;
+	pixman_region32_copy(damage, &state->surface_damage);
+	if (!pixman_region32_not_empty(&state->buffer_damage)) {
+		return;
+	}
+
+	if (state->transform == WL_OUTPUT_TRANSFORM_NORMAL && state->scale == 1) {
+		pixman_region32_union(damage, damage, &state->buffer_damage);
+		return;
+	}
+
+	pixman_region32_t surface_damage;
+	pixman_region32_init(&surface_damage);
+	wlr_region_transform_scale(&surface_damage, &state->buffer_damage,
+		state->transform, state->buffer_width, state->buffer_height,
+		1.0f/state->scale, 0, 0);
+	pixman_region32_union(damage, damage, &surface_damage);
+	pixman_region32_fini(&surface_damage);
+}
+
+void wlr_surface_get_buffer_damage(struct wlr_surface *surface,
+		pixman_region32_t *damage) {
+	struct wlr_surface_state *state = surface->current;
+	pixman_region32_copy(damage, &state->buffer_damage);
+	if (!pixman_region32_not_empty(&state->surface_damage)) {
+		return;
+	}
+
+	if (state->transform == WL_OUTPUT_TRANSFORM_NORMAL && state->scale == 1) {
+		pixman_region32_union(damage, damage, &state->surface_damage);
+		return;
+	}
+
+	pixman_region32_t buffer_damage;
+	pixman_region32_init(&buffer_damage);
+	wlr_region_transform_scale(&buffer_damage, &state->surface_damage,
+		wlr_output_transform_invert(state->transform),
+		state->width, state->height, state->scale, 0, 0);
+	pixman_region32_union(damage, damage, &buffer_damage);
+	pixman_region32_fini(&buffer_damage);
+}
+
 bool wlr_surface_has_buffer(struct wlr_surface *surface) {
-	return surface->texture && surface->texture->valid;
+	return surface->upload.buffer != NULL ||
+		(surface->texture && surface->texture->valid);
 }
 
 int wlr_surface_set_role(struct wlr_surface *surface, const char *role,
@@ -46,7 +46,15 @@ int wlr_xcursor_manager_load(struct wlr_xcursor_manager *manager,
 		return 1;
 	}
 	theme->scale = scale;
-	theme->theme = wlr_xcursor_theme_load(manager->name, manager->size * scale);
+	// Share the cursor index and decoded images with already loaded scales
+	int size = manager->size * scale;
+	if (wl_list_empty(&manager->scaled_themes)) {
+		theme->theme = wlr_xcursor_theme_load(manager->name, size);
+	} else {
+		struct wlr_xcursor_manager_theme *sibling = wl_container_of(
+			manager->scaled_themes.next, sibling, link);
+		theme->theme = wlr_xcursor_theme_load_sibling(sibling->theme, size);
+	}
 	if (theme->theme == NULL) {
 		free(theme);
 		return 1;
@@ -171,6 +171,10 @@ static void xdg_surface_destroy(struct wlr_xdg_surface_v6 *surface) {
 	wl_list_for_each_safe(configure, tmp, &surface->configure_list, link) {
 		free(configure);
 	}
+	wl_list_for_each_safe(configure, tmp, &surface->configure_free_list,
+			link) {
+		free(configure);
+	}
 
 	if (surface->role == WLR_XDG_SURFACE_V6_ROLE_TOPLEVEL) {
 		wl_resource_set_user_data(surface->toplevel_state->resource, NULL);
@@ -834,10 +838,15 @@ static void wlr_xdg_toplevel_v6_ack_configure(
 		struct wlr_xdg_surface_v6_configure *configure) {
 	assert(surface->role == WLR_XDG_SURFACE_V6_ROLE_TOPLEVEL);
 	surface->toplevel_state->next = configure->state;
-	surface->toplevel_state->pending.width = 0;
-	surface->toplevel_state->pending.height = 0;
+	if (!surface->configure_throttled) {
+		// Keep the size requested while waiting for this ack
+		surface->toplevel_state->pending.width = 0;
+		surface->toplevel_state->pending.height = 0;
+	}
 }
 
+static void wlr_xdg_surface_send_configure(void *user_data);
+
 static void xdg_surface_ack_configure(struct wl_client *client,
 		struct wl_resource *resource, uint32_t serial) {
 	struct wlr_xdg_surface_v6 *surface = xdg_surface_from_resource(resource);
@@ -854,7 +863,7 @@ static void xdg_surface_ack_configure(struct wl_client *client,
 	wl_list_for_each_safe(configure, tmp, &surface->configure_list, link) {
 		if (configure->serial < serial) {
 			wl_list_remove(&configure->link);
-			free(configure);
+			wl_list_insert(&surface->configure_free_list, &configure->link);
 		} else if (configure->serial == serial) {
 			wl_list_remove(&configure->link);
 			found = true;
@@ -884,7 +893,18 @@ static void xdg_surface_ack_configure(struct wl_client *client,
 	surface->configured = true;
 	surface->configure_serial = serial;
 
-	free(configure);
+	wl_list_insert(&surface->configure_free_list, &configure->link);
+
+	if (surface->configure_throttled &&
+			wl_list_empty(&surface->configure_list)) {
+		// Send the configure which was held back until the client caught up
+		surface->configure_throttled = false;
+		struct wl_display *display =
+			wl_client_get_display(surface->client->client);
+		struct wl_event_loop *loop = wl_display_get_event_loop(display);
+		surface->configure_idle = wl_event_loop_add_idle(loop,
+			wlr_xdg_surface_send_configure, surface);
+	}
 }
 
 static void xdg_surface_set_window_geometry(struct wl_client *client,
@@ -1032,11 +1052,18 @@ static void wlr_xdg_surface_send_configure(void *user_data) {
 
 	surface->configure_idle = NULL;
 
-	struct wlr_xdg_surface_v6_configure *configure =
-		calloc(1, sizeof(struct wlr_xdg_surface_v6_configure));
-	if (configure == NULL) {
-		wl_client_post_no_memory(surface->client->client);
-		return;
+	struct wlr_xdg_surface_v6_configure *configure;
+	if (!wl_list_empty(&surface->configure_free_list)) {
+		configure = wl_container_of(surface->configure_free_list.next,
+			configure, link);
+		wl_list_remove(&configure->link);
+		memset(configure, 0, sizeof(struct wlr_xdg_surface_v6_configure));
+	} else {
+		configure = calloc(1, sizeof(struct wlr_xdg_surface_v6_configure));
+		if (configure == NULL) {
+			wl_client_post_no_memory(surface->client->client);
+			return;
+		}
 	}
 
 	wl_list_insert(surface->configure_list.prev, &configure->link);
@@ -1079,15 +1106,19 @@ static uint32_t wlr_xdg_surface_v6_schedule_configure(
 		break;
 	}
 
-	if (surface->configure_idle != NULL) {
+	if (surface->configure_idle != NULL || surface->configure_throttled) {
 		if (!pending_same) {
-			// configure request already scheduled
+			// configure request already scheduled, it will be sent with the
+			// latest pending state
 			return surface->configure_next_serial;
 		}
 
 		// configure request not necessary anymore
-		wl_event_source_remove(surface->configure_idle);
-		surface->configure_idle = NULL;
+		if (surface->configure_idle != NULL) {
+			wl_event_source_remove(surface->configure_idle);
+			surface->configure_idle = NULL;
+		}
+		surface->configure_throttled = false;
 		return 0;
 	} else {
 		if (pending_same) {
@@ -1096,6 +1127,12 @@ static uint32_t wlr_xdg_surface_v6_schedule_configure(
 		}
 
 		surface->configure_next_serial = wl_display_next_serial(display);
+		if (!wl_list_empty(&surface->configure_list)) {
+			// The client hasn't acked the last configure yet, wait until it
+			// does instead of flooding it
+			surface->configure_throttled = true;
+			return surface->configure_next_serial;
+		}
 		surface->configure_idle = wl_event_loop_add_idle(loop,
 			wlr_xdg_surface_send_configure, surface);
 		return surface->configure_next_serial;
@@ -1238,6 +1275,7 @@ static void xdg_shell_get_xdg_surface(struct wl_client *wl_client,
 	}
 
 	wl_list_init(&surface->configure_list);
+	wl_list_init(&surface->configure_free_list);
 	wl_list_init(&surface->popups);
 
 	wl_signal_init(&surface->events.request_maximize);
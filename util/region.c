@@ -2,104 +2,142 @@
 #include <stdlib.h>
 #include <wlr/util/region.h>
 
-void wlr_region_scale(pixman_region32_t *dst, pixman_region32_t *src,
-		float scale) {
-	if (scale == 1) {
+// Regions with up to this many rectangles are processed on the stack
+#define REGION_SCRATCH_RECTS 32
+
+static pixman_box32_t *region_alloc_rects(pixman_box32_t *scratch,
+		int nrects) {
+	if (nrects <= REGION_SCRATCH_RECTS) {
+		return scratch;
+	}
+	return malloc(nrects * sizeof(pixman_box32_t));
+}
+
+static void region_finish_rects(pixman_region32_t *dst,
+		pixman_box32_t *scratch, pixman_box32_t *rects, int nrects) {
+	pixman_region32_fini(dst);
+	pixman_region32_init_rects(dst, rects, nrects);
+	if (rects != scratch) {
+		free(rects);
+	}
+}
+
+static void box_transform(pixman_box32_t *dst, const pixman_box32_t *src,
+		enum wl_output_transform transform, int width, int height) {
+	switch (transform) {
+	case WL_OUTPUT_TRANSFORM_NORMAL:
+		dst->x1 = src->x1;
+		dst->y1 = src->y1;
+		dst->x2 = src->x2;
+		dst->y2 = src->y2;
+		break;
+	case WL_OUTPUT_TRANSFORM_90:
+		dst->x1 = src->y1;
+		dst->y1 = width - src->x2;
+		dst->x2 = src->y2;
+		dst->y2 = width - src->x1;
+		break;
+	case WL_OUTPUT_TRANSFORM_180:
+		dst->x1 = width - src->x2;
+		dst->y1 = height - src->y2;
+		dst->x2 = width - src->x1;
+		dst->y2 = height - src->y1;
+		break;
+	case WL_OUTPUT_TRANSFORM_270:
+		dst->x1 = height - src->y2;
+		dst->y1 = src->x1;
+		dst->x2 = height - src->y1;
+		dst->y2 = src->x2;
+		break;
+	case WL_OUTPUT_TRANSFORM_FLIPPED:
+		dst->x1 = width - src->x2;
+		dst->y1 = src->y1;
+		dst->x2 = width - src->x1;
+		dst->y2 = src->y2;
+		break;
+	case WL_OUTPUT_TRANSFORM_FLIPPED_90:
+		dst->x1 = height - src->y2;
+		dst->y1 = width - src->x2;
+		dst->x2 = height - src->y1;
+		dst->y2 = width - src->x1;
+		break;
+	case WL_OUTPUT_TRANSFORM_FLIPPED_180:
+		dst->x1 = src->x1;
+		dst->y1 = height - src->y2;
+		dst->x2 = src->x2;
+		dst->y2 = height - src->y1;
+		break;
+	case WL_OUTPUT_TRANSFORM_FLIPPED_270:
+		dst->x1 = src->y1;
+		dst->y1 = src->x1;
+		dst->x2 = src->y2;
+		dst->y2 = src->x2;
+		break;
+	}
+}
+
+void wlr_region_transform_scale(pixman_region32_t *dst,
+		pixman_region32_t *src, enum wl_output_transform transform,
+		int width, int height, float scale, int dx, int dy) {
+	if (transform == WL_OUTPUT_TRANSFORM_NORMAL && scale == 1) {
 		pixman_region32_copy(dst, src);
+		pixman_region32_translate(dst, dx, dy);
 		return;
 	}
 
 	int nrects;
 	pixman_box32_t *src_rects = pixman_region32_rectangles(src, &nrects);
+	if (nrects == 0) {
+		pixman_region32_clear(dst);
+		return;
+	}
 
-	pixman_box32_t *dst_rects = malloc(nrects * sizeof(pixman_box32_t));
+	pixman_box32_t scratch[REGION_SCRATCH_RECTS];
+	pixman_box32_t *dst_rects = region_alloc_rects(scratch, nrects);
 	if (dst_rects == NULL) {
 		return;
 	}
 
+	int int_scale = (int)scale;
 	for (int i = 0; i < nrects; ++i) {
-		dst_rects[i].x1 = floor(src_rects[i].x1 * scale);
-		dst_rects[i].x2 = ceil(src_rects[i].x2 * scale);
-		dst_rects[i].y1 = floor(src_rects[i].y1 * scale);
-		dst_rects[i].y2 = ceil(src_rects[i].y2 * scale);
+		pixman_box32_t box;
+		box_transform(&box, &src_rects[i], transform, width, height);
+
+		if (scale == int_scale) {
+			dst_rects[i].x1 = box.x1 * int_scale + dx;
+			dst_rects[i].x2 = box.x2 * int_scale + dx;
+			dst_rects[i].y1 = box.y1 * int_scale + dy;
+			dst_rects[i].y2 = box.y2 * int_scale + dy;
+		} else {
+			dst_rects[i].x1 = floor(box.x1 * scale) + dx;
+			dst_rects[i].x2 = ceil(box.x2 * scale) + dx;
+			dst_rects[i].y1 = floor(box.y1 * scale) + dy;
+			dst_rects[i].y2 = ceil(box.y2 * scale) + dy;
+		}
 	}
 
-	pixman_region32_fini(dst);
-	pixman_region32_init_rects(dst, dst_rects, nrects);
-	free(dst_rects);
+	region_finish_rects(dst, scratch, dst_rects, nrects);
 }
 
-void wlr_region_transform(pixman_region32_t *dst, pixman_region32_t *src,
-		enum wl_output_transform transform, int width, int height) {
-	if (transform == WL_OUTPUT_TRANSFORM_NORMAL) {
+void wlr_region_scale(pixman_region32_t *dst, pixman_region32_t *src,
+		float scale) {
+	if (scale == 1) {
 		pixman_region32_copy(dst, src);
 		return;
 	}
 
-	int nrects;
-	pixman_box32_t *src_rects = pixman_region32_rectangles(src, &nrects);
+	wlr_region_transform_scale(dst, src, WL_OUTPUT_TRANSFORM_NORMAL, 0, 0,
+		scale, 0, 0);
+}
 
-	pixman_box32_t *dst_rects = malloc(nrects * sizeof(pixman_box32_t));
-	if (dst_rects == NULL) {
+void wlr_region_transform(pixman_region32_t *dst, pixman_region32_t *src,
+		enum wl_output_transform transform, int width, int height) {
+	if (transform == WL_OUTPUT_TRANSFORM_NORMAL) {
+		pixman_region32_copy(dst, src);
 		return;
 	}
 
-	for (int i = 0; i < nrects; ++i) {
-		switch (transform) {
-		case WL_OUTPUT_TRANSFORM_NORMAL:
-			dst_rects[i].x1 = src_rects[i].x1;
-			dst_rects[i].y1 = src_rects[i].y1;
-			dst_rects[i].x2 = src_rects[i].x2;
-			dst_rects[i].y2 = src_rects[i].y2;
-			break;
-		case WL_OUTPUT_TRANSFORM_90:
-			dst_rects[i].x1 = src_rects[i].y1;
-			dst_rects[i].y1 = width - src_rects[i].x2;
-			dst_rects[i].x2 = src_rects[i].y2;
-			dst_rects[i].y2 = width - src_rects[i].x1;
-			break;
-		case WL_OUTPUT_TRANSFORM_180:
-			dst_rects[i].x1 = width - src_rects[i].x2;
-			dst_rects[i].y1 = height - src_rects[i].y2;
-			dst_rects[i].x2 = width - src_rects[i].x1;
-			dst_rects[i].y2 = height - src_rects[i].y1;
-			break;
-		case WL_OUTPUT_TRANSFORM_270:
-			dst_rects[i].x1 = height - src_rects[i].y2;
-			dst_rects[i].y1 = src_rects[i].x1;
-			dst_rects[i].x2 = height - src_rects[i].y1;
-			dst_rects[i].y2 = src_rects[i].x2;
-			break;
-		case WL_OUTPUT_TRANSFORM_FLIPPED:
-			dst_rects[i].x1 = width - src_rects[i].x2;
-			dst_rects[i].y1 = src_rects[i].y1;
-			dst_rects[i].x2 = width - src_rects[i].x1;
-			dst_rects[i].y2 = src_rects[i].y2;
-			break;
-		case WL_OUTPUT_TRANSFORM_FLIPPED_90:
-			dst_rects[i].x1 = height - src_rects[i].y2;
-			dst_rects[i].y1 = width - src_rects[i].x2;
-			dst_rects[i].x2 = height - src_rects[i].y1;
-			dst_rects[i].y2 = width - src_rects[i].x1;
-			break;
-		case WL_OUTPUT_TRANSFORM_FLIPPED_180:
-			dst_rects[i].x1 = src_rects[i].x1;
-			dst_rects[i].y1 = height - src_rects[i].y2;
-			dst_rects[i].x2 = src_rects[i].x2;
-			dst_rects[i].y2 = height - src_rects[i].y1;
-			break;
-		case WL_OUTPUT_TRANSFORM_FLIPPED_270:
-			dst_rects[i].x1 = src_rects[i].y1;
-			dst_rects[i].y1 = src_rects[i].x1;
-			dst_rects[i].x2 = src_rects[i].y2;
-			dst_rects[i].y2 = src_rects[i].x2;
-			break;
-		}
-	}
-
-	pixman_region32_fini(dst);
-	pixman_region32_init_rects(dst, dst_rects, nrects);
-	free(dst_rects);
+	wlr_region_transform_scale(dst, src, transform, width, height, 1, 0, 0);
 }
 
 void wlr_region_expand(pixman_region32_t *dst, pixman_region32_t *src,
@@ -111,8 +149,13 @@ void wlr_region_expand(pixman_region32_t *dst, pixman_region32_t *src,
 
 	int nrects;
 	pixman_box32_t *src_rects = pixman_region32_rectangles(src, &nrects);
+	if (nrects == 0) {
+		pixman_region32_clear(dst);
+		return;
+	}
 
-	pixman_box32_t *dst_rects = malloc(nrects * sizeof(pixman_box32_t));
+	pixman_box32_t scratch[REGION_SCRATCH_RECTS];
+	pixman_box32_t *dst_rects = region_alloc_rects(scratch, nrects);
 	if (dst_rects == NULL) {
 		return;
 	}
@@ -124,7 +167,5 @@ void wlr_region_expand(pixman_region32_t *dst, pixman_region32_t *src,
 		dst_rects[i].y2 = src_rects[i].y2 + distance;
 	}
 
-	pixman_region32_fini(dst);
-	pixman_region32_init_rects(dst, dst_rects, nrects);
-	free(dst_rects);
+	region_finish_rects(dst, scratch, dst_rects, nrects);
 }
@@ -24,6 +24,8 @@
  */
 
 #define _XOPEN_SOURCE 500
+#include <assert.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -32,6 +34,36 @@
 #include <wlr/xcursor.h>
 #include "xcursor/xcursor.h"
 
+/**
+ * A cursor decoded at a particular nominal size.
+ */
+struct wlr_xcursor_index_image {
+	unsigned int nominal_size;
+	struct wlr_xcursor *cursor;
+};
+
+struct wlr_xcursor_index_entry {
+	char *name;
+	char *path; // NULL for built-in cursors
+	size_t order; // position in the theme inheritance chain
+	struct xcursor_mapped_file file; // mapped on first use
+	bool broken; // the file couldn't be mapped or contains no images
+
+	size_t decoded_count;
+	struct wlr_xcursor_index_image *decoded;
+};
+
+/**
+ * The cursors available in a theme, shared by all the sizes it is loaded at.
+ */
+struct wlr_xcursor_theme_index {
+	size_t ref_count;
+	bool builtin; // no theme files were found
+
+	size_t entry_count, entry_cap;
+	struct wlr_xcursor_index_entry *entries; // sorted by name, then order
+};
+
 static void wlr_xcursor_destroy(struct wlr_xcursor *cursor) {
 	for (size_t i = 0; i < cursor->image_count; i++) {
 		free(cursor->images[i]->buffer);
@@ -46,7 +78,7 @@ static void wlr_xcursor_destroy(struct wlr_xcursor *cursor) {
 #include "xcursor/cursor_data.h"
 
 static struct wlr_xcursor *wlr_xcursor_create_from_data(
-		struct cursor_metadata *metadata, struct wlr_xcursor_theme *theme) {
+		struct cursor_metadata *metadata) {
 	struct wlr_xcursor *cursor;
 	struct wlr_xcursor_image *image;
 	int size;
@@ -101,33 +133,8 @@ err_free_cursor:
 	return NULL;
 }
 
-static void load_default_theme(struct wlr_xcursor_theme *theme) {
-	uint32_t i;
-
-	free(theme->name);
-	theme->name = strdup("default");
-
-	theme->cursor_count = sizeof(cursor_metadata) / sizeof(cursor_metadata[0]);
-	theme->cursors = malloc(theme->cursor_count * sizeof(*theme->cursors));
-
-	if (theme->cursors == NULL) {
-		theme->cursor_count = 0;
-		return;
-	}
-
-	for (i = 0; i < theme->cursor_count; ++i) {
-		theme->cursors[i] =
-			wlr_xcursor_create_from_data(&cursor_metadata[i], theme);
-
-		if (theme->cursors[i] == NULL) {
-			break;
-		}
-	}
-	theme->cursor_count = i;
-}
-
 static struct wlr_xcursor *wlr_xcursor_create_from_xcursor_images(
-		XcursorImages *images, struct wlr_xcursor_theme *theme) {
+		XcursorImages *images) {
 	struct wlr_xcursor *cursor;
 	struct wlr_xcursor_image *image;
 	int i, size;
@@ -184,84 +191,249 @@ static struct wlr_xcursor *wlr_xcursor_create_from_xcursor_images(
 	return cursor;
 }
 
-static void load_callback(XcursorImages *images, void *data) {
-	struct wlr_xcursor_theme *theme = data;
-	struct wlr_xcursor *cursor;
+static struct wlr_xcursor_index_entry *index_add_entry(
+		struct wlr_xcursor_theme_index *index, const char *name,
+		const char *path) {
+	if (index->entry_count == index->entry_cap) {
+		size_t cap = index->entry_cap ? index->entry_cap * 2 : 64;
+		struct wlr_xcursor_index_entry *entries =
+			realloc(index->entries, cap * sizeof(*entries));
+		if (entries == NULL) {
+			return NULL;
+		}
+		index->entries = entries;
+		index->entry_cap = cap;
+	}
 
-	if (wlr_xcursor_theme_get_cursor(theme, images->name)) {
-		XcursorImagesDestroy(images);
+	struct wlr_xcursor_index_entry *entry =
+		&index->entries[index->entry_count];
+	memset(entry, 0, sizeof(*entry));
+	entry->name = strdup(name);
+	if (entry->name == NULL) {
+		return NULL;
+	}
+	if (path != NULL) {
+		entry->path = strdup(path);
+		if (entry->path == NULL) {
+			free(entry->name);
+			return NULL;
+		}
+	}
+	entry->order = index->entry_count;
+	index->entry_count++;
+	return entry;
+}
+
+static void index_callback(const char *name, const char *path, void *data) {
+	struct wlr_xcursor_theme_index *index = data;
+	index_add_entry(index, name, path);
+}
+
+static int entry_cmp(const void *_a, const void *_b) {
+	const struct wlr_xcursor_index_entry *a = _a, *b = _b;
+	int cmp = strcmp(a->name, b->name);
+	if (cmp != 0) {
+		return cmp;
+	}
+	return a->order < b->order ? -1 : a->order > b->order;
+}
+
+static int entry_name_cmp(const void *name, const void *_entry) {
+	const struct wlr_xcursor_index_entry *entry = _entry;
+	return strcmp(name, entry->name);
+}
+
+static void index_entry_finish(struct wlr_xcursor_index_entry *entry) {
+	for (size_t i = 0; i < entry->decoded_count; ++i) {
+		wlr_xcursor_destroy(entry->decoded[i].cursor);
+	}
+	free(entry->decoded);
+	xcursor_mapped_file_close(&entry->file);
+	free(entry->name);
+	free(entry->path);
+}
+
+/**
+ * Sorts the index by name. Cursors with the same name stay in the order of the
+ * theme inheritance chain, so that lookups can fall back to the next one if a
+ * file can't be loaded.
+ */
+static void index_sort(struct wlr_xcursor_theme_index *index) {
+	if (index->entry_count == 0) {
 		return;
 	}
 
-	cursor = wlr_xcursor_create_from_xcursor_images(images, theme);
+	qsort(index->entries, index->entry_count, sizeof(index->entries[0]),
+		entry_cmp);
+}
+
+static bool index_entry_add_decoded(struct wlr_xcursor_index_entry *entry,
+		unsigned int nominal_size, struct wlr_xcursor *cursor) {
+	struct wlr_xcursor_index_image *decoded = realloc(entry->decoded,
+		(entry->decoded_count + 1) * sizeof(*decoded));
+	if (decoded == NULL) {
+		return false;
+	}
+	entry->decoded = decoded;
+	entry->decoded[entry->decoded_count].nominal_size = nominal_size;
+	entry->decoded[entry->decoded_count].cursor = cursor;
+	entry->decoded_count++;
+	return true;
+}
 
-	if (cursor) {
-		theme->cursor_count++;
-		theme->cursors =
-			realloc(theme->cursors,
-				theme->cursor_count * sizeof(theme->cursors[0]));
+static void index_load_builtin(struct wlr_xcursor_theme_index *index) {
+	size_t count = sizeof(cursor_metadata) / sizeof(cursor_metadata[0]);
+	for (size_t i = 0; i < count; ++i) {
+		struct wlr_xcursor_index_entry *entry =
+			index_add_entry(index, cursor_metadata[i].name, NULL);
+		if (entry == NULL) {
+			break;
+		}
 
-		if (theme->cursors == NULL) {
-			theme->cursor_count--;
-			free(cursor);
-		} else {
-			theme->cursors[theme->cursor_count - 1] = cursor;
+		struct wlr_xcursor *cursor =
+			wlr_xcursor_create_from_data(&cursor_metadata[i]);
+		if (cursor == NULL || !index_entry_add_decoded(entry, 0, cursor)) {
+			if (cursor != NULL) {
+				wlr_xcursor_destroy(cursor);
+			}
+			index->entry_count--;
+			index_entry_finish(entry);
+			break;
 		}
 	}
+}
 
-	XcursorImagesDestroy(images);
+static void index_unref(struct wlr_xcursor_theme_index *index) {
+	if (index == NULL) {
+		return;
+	}
+	assert(index->ref_count > 0);
+	if (--index->ref_count > 0) {
+		return;
+	}
+
+	for (size_t i = 0; i < index->entry_count; ++i) {
+		index_entry_finish(&index->entries[i]);
+	}
+	free(index->entries);
+	free(index);
 }
 
-struct wlr_xcursor_theme *wlr_xcursor_theme_load(const char *name, int size) {
-	struct wlr_xcursor_theme *theme;
+static struct wlr_xcursor *index_entry_get_cursor(
+		struct wlr_xcursor_index_entry *entry, int size) {
+	if (entry->path == NULL) {
+		// Built-in cursors only exist at one size
+		return entry->decoded_count > 0 ? entry->decoded[0].cursor : NULL;
+	}
 
-	theme = malloc(sizeof(*theme));
-	if (!theme) {
+	if (entry->broken) {
 		return NULL;
 	}
 
-	if (!name) {
-		name = "default";
+	// The mapping is kept for the lifetime of the index, other sizes are
+	// decoded from it
+	if (entry->file.data == NULL &&
+			xcursor_mapped_file_open(&entry->file, entry->path) != 0) {
+		wlr_log(L_DEBUG, "Failed to open cursor file %s", entry->path);
+		entry->broken = true;
+		return NULL;
 	}
 
-	theme->name = strdup(name);
-	if (!theme->name) {
-		goto out_error_name;
+	unsigned int nominal_size =
+		xcursor_mapped_file_best_size(&entry->file, size);
+	if (nominal_size == 0) {
+		wlr_log(L_DEBUG, "Cursor file %s contains no images", entry->path);
+		xcursor_mapped_file_close(&entry->file);
+		entry->broken = true;
+		return NULL;
+	}
+
+	for (size_t i = 0; i < entry->decoded_count; ++i) {
+		if (entry->decoded[i].nominal_size == nominal_size) {
+			return entry->decoded[i].cursor;
+		}
+	}
+
+	XcursorImages *images =
+		xcursor_mapped_file_load_images(&entry->file, nominal_size);
+	if (images == NULL) {
+		wlr_log(L_DEBUG, "Failed to load cursor file %s at size %u",
+			entry->path, nominal_size);
+		return NULL;
 	}
-	theme->size = size;
-	theme->cursor_count = 0;
-	theme->cursors = NULL;
 
-	xcursor_load_theme(name, size, load_callback, theme);
+	struct wlr_xcursor *cursor = NULL;
+	images->name = strdup(entry->name);
+	if (images->name != NULL) {
+		cursor = wlr_xcursor_create_from_xcursor_images(images);
+	}
+	XcursorImagesDestroy(images);
 
-	if (theme->cursor_count == 0) {
-		load_default_theme(theme);
+	if (cursor != NULL && !index_entry_add_decoded(entry, nominal_size,
+			cursor)) {
+		wlr_xcursor_destroy(cursor);
+		cursor = NULL;
 	}
+	return cursor;
+}
 
-	wlr_log(L_DEBUG, "Loaded cursor theme '%s', available cursors:",
-			theme->name);
-	for (size_t i = 0; i < theme->cursor_count; ++i) {
-		struct wlr_xcursor *c = theme->cursors[i];
-		struct wlr_xcursor_image *i = c->images[0];
-		wlr_log(L_DEBUG, "%s (%u images) %dx%d+%d,%d",
-				c->name, c->image_count,
-				i->width, i->height, i->hotspot_x, i->hotspot_y);
+static struct wlr_xcursor_theme *theme_create(const char *name, int size,
+		struct wlr_xcursor_theme_index *index) {
+	struct wlr_xcursor_theme *theme = calloc(1, sizeof(*theme));
+	if (!theme) {
+		return NULL;
 	}
 
+	theme->name = strdup(index->builtin ? "default" : name);
+	if (!theme->name) {
+		free(theme);
+		return NULL;
+	}
+	theme->size = size;
+	theme->index = index;
+	index->ref_count++;
 	return theme;
+}
 
-out_error_name:
-	free(theme);
-	return NULL;
+struct wlr_xcursor_theme *wlr_xcursor_theme_load(const char *name, int size) {
+	if (!name) {
+		name = "default";
+	}
+
+	struct wlr_xcursor_theme_index *index = calloc(1, sizeof(*index));
+	if (!index) {
+		return NULL;
+	}
+	index->ref_count = 1;
+
+	xcursor_index_theme(name, index_callback, index);
+	index->builtin = index->entry_count == 0;
+	// The built-in cursors come last in the inheritance chain, they are used
+	// when no theme file for a cursor can be loaded
+	index_load_builtin(index);
+	index_sort(index);
+
+	struct wlr_xcursor_theme *theme = theme_create(name, size, index);
+	if (theme) {
+		wlr_log(L_DEBUG, "Loaded cursor theme '%s', %zu cursor files indexed",
+			theme->name, index->entry_count);
+	}
+	index_unref(index);
+	return theme;
 }
 
-void wlr_xcursor_theme_destroy(struct wlr_xcursor_theme *theme) {
-	unsigned int i;
+struct wlr_xcursor_theme *wlr_xcursor_theme_load_sibling(
+		struct wlr_xcursor_theme *theme, int size) {
+	return theme_create(theme->name, size, theme->index);
+}
 
-	for (i = 0; i < theme->cursor_count; i++) {
-		wlr_xcursor_destroy(theme->cursors[i]);
+void wlr_xcursor_theme_destroy(struct wlr_xcursor_theme *theme) {
+	if (theme == NULL) {
+		return;
 	}
 
+	// Cursors are owned by the index
+	index_unref(theme->index);
 	free(theme->name);
 	free(theme->cursors);
 	free(theme);
@@ -277,7 +449,43 @@ struct wlr_xcursor *wlr_xcursor_theme_get_cursor(struct wlr_xcursor_theme *theme
 		}
 	}
 
-	return NULL;
+	struct wlr_xcursor_theme_index *index = theme->index;
+	struct wlr_xcursor_index_entry *entry = bsearch(name, index->entries,
+		index->entry_count, sizeof(index->entries[0]), entry_name_cmp);
+	if (entry == NULL) {
+		return NULL;
+	}
+
+	// bsearch can return any of the entries for this name, walk the
+	// inheritance chain from its start
+	while (entry > index->entries && strcmp(entry[-1].name, name) == 0) {
+		entry--;
+	}
+	struct wlr_xcursor_index_entry *end = index->entries + index->entry_count;
+	struct wlr_xcursor *cursor = NULL;
+	for (; entry < end && strcmp(entry->name, name) == 0; ++entry) {
+		cursor = index_entry_get_cursor(entry, theme->size);
+		if (cursor != NULL) {
+			break;
+		}
+	}
+	if (cursor == NULL) {
+		return NULL;
+	}
+
+	struct wlr_xcursor **cursors = realloc(theme->cursors,
+		(theme->cursor_count + 1) * sizeof(theme->cursors[0]));
+	if (cursors == NULL) {
+		return cursor;
+	}
+	theme->cursors = cursors;
+	theme->cursors[theme->cursor_count++] = cursor;
+
+	struct wlr_xcursor_image *image = cursor->images[0];
+	wlr_log(L_DEBUG, "Loaded cursor %s (%u images) %dx%d+%d,%d", cursor->name,
+		cursor->image_count, image->width, image->height, image->hotspot_x,
+		image->hotspot_y);
+	return cursor;
 }
 
 static int wlr_xcursor_frame_and_duration(struct wlr_xcursor *cursor,
@@ -25,9 +25,13 @@
 
 #define _DEFAULT_SOURCE
 #include <dirent.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "xcursor/xcursor.h"
 
 /*
@@ -515,35 +519,21 @@ _XcursorReadImage (XcursorFile		*file,
 }
 
 static XcursorImages *
-XcursorXcFileLoadImages (XcursorFile *file, int size)
+_XcursorXcFileLoadImagesOfSize (XcursorFile		*file,
+				XcursorFileHeader	*fileHeader,
+				XcursorDim		size,
+				int			nsize)
 {
-    XcursorFileHeader	*fileHeader;
-    XcursorDim		bestSize;
-    int			nsize;
     XcursorImages	*images;
     int			n;
     int			toc;
 
-    if (!file || size < 0)
-	return NULL;
-    fileHeader = _XcursorReadFileHeader (file);
-    if (!fileHeader)
-	return NULL;
-    bestSize = _XcursorFindBestSize (fileHeader, (XcursorDim) size, &nsize);
-    if (!bestSize)
-    {
-        _XcursorFileHeaderDestroy (fileHeader);
-	return NULL;
-    }
     images = XcursorImagesCreate (nsize);
     if (!images)
-    {
-        _XcursorFileHeaderDestroy (fileHeader);
 	return NULL;
-    }
     for (n = 0; n < nsize; n++)
     {
-	toc = _XcursorFindImageToc (fileHeader, bestSize, n);
+	toc = _XcursorFindImageToc (fileHeader, size, n);
 	if (toc < 0)
 	    break;
 	images->images[images->nimage] = _XcursorReadImage (file, fileHeader,
@@ -552,7 +542,6 @@ XcursorXcFileLoadImages (XcursorFile *file, int size)
 	    break;
 	images->nimage++;
     }
-    _XcursorFileHeaderDestroy (fileHeader);
     if (images->nimage != nsize)
     {
 	XcursorImagesDestroy (images);
@@ -561,6 +550,31 @@ XcursorXcFileLoadImages (XcursorFile *file, int size)
     return images;
 }
 
+static XcursorImages *
+XcursorXcFileLoadImages (XcursorFile *file, int size)
+{
+    XcursorFileHeader	*fileHeader;
+    XcursorDim		bestSize;
+    int			nsize;
+    XcursorImages	*images;
+
+    if (!file || size < 0)
+	return NULL;
+    fileHeader = _XcursorReadFileHeader (file);
+    if (!fileHeader)
+	return NULL;
+    bestSize = _XcursorFindBestSize (fileHeader, (XcursorDim) size, &nsize);
+    if (!bestSize)
+    {
+        _XcursorFileHeaderDestroy (fileHeader);
+	return NULL;
+    }
+    images = _XcursorXcFileLoadImagesOfSize (file, fileHeader, bestSize,
+					     nsize);
+    _XcursorFileHeaderDestroy (fileHeader);
+    return images;
+}
+
 static int
 _XcursorStdioFileRead (XcursorFile *file, unsigned char *buf, int len)
 {
@@ -603,6 +617,63 @@ XcursorFileLoadImages (FILE *file, int size)
     return XcursorXcFileLoadImages (&f, size);
 }
 
+static int
+_XcursorMappedFileRead (XcursorFile *file, unsigned char *buf, int len)
+{
+    struct xcursor_mapped_file *mapped = file->closure;
+    size_t avail = mapped->size - mapped->pos;
+
+    if (len < 0)
+	return 0;
+    if ((size_t) len > avail)
+	len = avail;
+    memcpy (buf, mapped->data + mapped->pos, len);
+    mapped->pos += len;
+    return len;
+}
+
+static int
+_XcursorMappedFileWrite (XcursorFile *file, unsigned char *buf, int len)
+{
+    return 0;
+}
+
+static int
+_XcursorMappedFileSeek (XcursorFile *file, long offset, int whence)
+{
+    struct xcursor_mapped_file *mapped = file->closure;
+    long pos;
+
+    switch (whence)
+    {
+    case SEEK_SET:
+	pos = offset;
+	break;
+    case SEEK_CUR:
+	pos = (long) mapped->pos + offset;
+	break;
+    case SEEK_END:
+	pos = (long) mapped->size + offset;
+	break;
+    default:
+	return EOF;
+    }
+    if (pos < 0 || (size_t) pos > mapped->size)
+	return EOF;
+    mapped->pos = pos;
+    return 0;
+}
+
+static void
+_XcursorMappedFileInitialize (struct xcursor_mapped_file *mapped,
+			      XcursorFile *file)
+{
+    file->closure = mapped;
+    file->read = _XcursorMappedFileRead;
+    file->write = _XcursorMappedFileWrite;
+    file->seek = _XcursorMappedFileSeek;
+}
+
 /*
  * From libXcursor/src/library.c
  */
@@ -862,16 +933,111 @@ XcursorLibraryLoadImages (const char *file, const char *theme, int size)
     return images;
 }
 
+/** Map a cursor file into memory
+ *
+ * Only the file header and table of contents are parsed, the image chunks
+ * are left untouched until xcursor_mapped_file_load_images() is called.
+ *
+ * \param file The mapped file to initialize
+ * \param path The full path of the cursor file
+ * \return 0 on success, -1 on failure
+ */
+int
+xcursor_mapped_file_open(struct xcursor_mapped_file *file, const char *path)
+{
+	struct stat st;
+	XcursorFile f;
+	void *data;
+	int fd;
+
+	memset(file, 0, sizeof(*file));
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -1;
+
+	if (fstat(fd, &st) < 0 || st.st_size < XCURSOR_FILE_HEADER_LEN) {
+		close(fd);
+		return -1;
+	}
+
+	data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return -1;
+
+	file->data = data;
+	file->size = st.st_size;
+
+	_XcursorMappedFileInitialize(file, &f);
+	file->header = _XcursorReadFileHeader(&f);
+	if (!file->header) {
+		xcursor_mapped_file_close(file);
+		return -1;
+	}
+
+	return 0;
+}
+
+void
+xcursor_mapped_file_close(struct xcursor_mapped_file *file)
+{
+	if (file->header)
+		_XcursorFileHeaderDestroy(file->header);
+	if (file->data)
+		munmap((void *)file->data, file->size);
+	memset(file, 0, sizeof(*file));
+}
+
+/** Find the nominal size which best matches the requested size
+ *
+ * Themes usually only ship a handful of nominal sizes, so different
+ * requested sizes often resolve to the same images.
+ *
+ * \return The nominal size, or 0 if the file contains no images
+ */
+XcursorDim
+xcursor_mapped_file_best_size(struct xcursor_mapped_file *file, int size)
+{
+	int nsize;
+
+	if (size < 0)
+		return 0;
+
+	return _XcursorFindBestSize(file->header, (XcursorDim)size, &nsize);
+}
+
+/** Decode the images of a mapped file at the given nominal size
+ *
+ * \param nominal_size A size previously returned by
+ * xcursor_mapped_file_best_size()
+ * \return The decoded images, to be destroyed with XcursorImagesDestroy()
+ */
+XcursorImages *
+xcursor_mapped_file_load_images(struct xcursor_mapped_file *file,
+		XcursorDim nominal_size)
+{
+	XcursorFile f;
+	XcursorDim size;
+	int nsize;
+
+	size = _XcursorFindBestSize(file->header, nominal_size, &nsize);
+	if (!size || size != nominal_size)
+		return NULL;
+
+	_XcursorMappedFileInitialize(file, &f);
+	return _XcursorXcFileLoadImagesOfSize(&f, file->header, size, nsize);
+}
+
 static void
-load_all_cursors_from_dir(const char *path, int size,
-			  void (*load_callback)(XcursorImages *, void *),
-			  void *user_data)
+index_cursors_from_dir(const char *path,
+		       void (*index_callback)(const char *, const char *,
+					      void *),
+		       void *user_data)
 {
-	FILE *f;
 	DIR *dir = opendir(path);
 	struct dirent *ent;
 	char *full;
-	XcursorImages *images;
 
 	if (!dir)
 		return;
@@ -881,52 +1047,39 @@ load_all_cursors_from_dir(const char *path, int size,
 		    (ent->d_type != DT_REG && ent->d_type != DT_LNK))
 			continue;
 
-		full = _XcursorBuildFullname(path, "", ent->d_name);
-		if (!full)
+		if (ent->d_name[0] == '.')
 			continue;
 
-		f = fopen(full, "r");
-		if (!f) {
-			free(full);
+		full = _XcursorBuildFullname(path, "", ent->d_name);
+		if (!full)
 			continue;
-		}
-
-		images = XcursorFileLoadImages(f, size);
-
-		if (images) {
-			XcursorImagesSetName(images, ent->d_name);
-			load_callback(images, user_data);
-		}
 
-		fclose (f);
+		index_callback(ent->d_name, full, user_data);
 		free(full);
 	}
 
 	closedir(dir);
 }
 
-/** Load all the cursor of a theme
+/** Index all the cursors of a theme
  *
- * This function loads all the cursor images of a given theme and its
- * inherited themes. Each cursor is loaded into an XcursorImages object
- * which is passed to the caller's load callback. If a cursor appears
- * more than once across all the inherited themes, the load callback
- * will be called multiple times, with possibly different XcursorImages
- * object which have the same name. The user is expected to destroy the
- * XcursorImages objects passed to the callback with
- * XcursorImagesDestroy().
+ * This function walks the cursor directories of a given theme and its
+ * inherited themes without reading any cursor file. The index callback
+ * is called once per file found, with the cursor name and the full path
+ * of the file. If a cursor appears more than once across all the
+ * inherited themes, the index callback will be called multiple times
+ * with the same name, in order of precedence: the first call wins.
  *
- * \param theme The name of theme that should be loaded
- * \param size The desired size of the cursor images
- * \param load_callback A callback function that will be called
- * for each cursor loaded. The first parameter is the XcursorImages
- * object representing the loaded cursor and the second is a pointer
- * to data provided by the user.
- * \param user_data The data that should be passed to the load callback
+ * \param theme The name of theme that should be indexed
+ * \param index_callback A callback function that will be called
+ * for each cursor file found. The first parameter is the cursor name,
+ * the second is the full path of the file (only valid for the duration
+ * of the call) and the third is a pointer to data provided by the user.
+ * \param user_data The data that should be passed to the index callback
  */
 void
-xcursor_load_theme(const char *theme, int size,
-		    void (*load_callback)(XcursorImages *, void *),
+xcursor_index_theme(const char *theme,
+		    void (*index_callback)(const char *, const char *, void *),
 		    void *user_data)
 {
 	char *full, *dir;
@@ -946,8 +1099,7 @@ xcursor_load_theme(const char *theme, int size,
 		full = _XcursorBuildFullname(dir, "cursors", "");
 
 		if (full) {
-			load_all_cursors_from_dir(full, size, load_callback,
-						  user_data);
+			index_cursors_from_dir(full, index_callback, user_data);
 			free(full);
 		}
 
@@ -963,7 +1115,7 @@ xcursor_load_theme(const char *theme, int size,
 	}
 
 	for (i = inherits; i; i = _XcursorNextPath(i))
-		xcursor_load_theme(i, size, load_callback, user_data);
+		xcursor_index_theme(i, index_callback, user_data);
 
 	if (inherits)
 		free(inherits);